@@ -0,0 +1,233 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+#include "Camera.h"
+#include "MathHelpers.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+
+using namespace dae;
+
+namespace
+{
+	//Nearest-rank percentile of sorted values
+	double GetPercentile(const std::vector<double>& sortedValues, double percentile)
+	{
+		const size_t rank{ size_t(std::ceil(percentile * double(sortedValues.size()))) };
+		return sortedValues[std::clamp(rank, size_t(1), sortedValues.size()) - 1];
+	}
+
+	void WriteJsonString(std::ostream& stream, const std::string& string)
+	{
+		stream << '"';
+		for (const char character : string)
+		{
+			if (character == '"' || character == '\\')
+				stream << '\\' << character;
+			else if (static_cast<unsigned char>(character) < 0x20)
+				stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(character) << std::dec << std::setfill(' ');
+			else
+				stream << character;
+		}
+		stream << '"';
+	}
+}
+
+#pragma region CameraPath
+CameraPath CameraPath::CreateDefault(Camera& camera)
+{
+	camera.CalculateCameraToWorld();
+	const Vector3 right{ camera.right };
+	const Vector3 forward{ camera.forward };
+	const CameraKeyframe start{ camera.origin, camera.totalPitch, camera.totalYaw, camera.fovAngle };
+
+	CameraPath path{};
+	path.AddKeyframe(start);
+	path.AddKeyframe({ start.origin + right * 1.5f + forward, start.pitch, start.yaw - 0.25f, start.fovAngle });
+	path.AddKeyframe({ start.origin + forward * 2.f, start.pitch - 0.1f, start.yaw, start.fovAngle - 5.f });
+	path.AddKeyframe({ start.origin - right * 1.5f + forward, start.pitch, start.yaw + 0.25f, start.fovAngle });
+	path.AddKeyframe(start);
+	return path;
+}
+
+void CameraPath::Apply(float progress, Camera& camera) const
+{
+	if (m_Keyframes.empty())
+		return;
+
+	const float position{ std::clamp(progress, 0.f, 1.f) * float(m_Keyframes.size() - 1) };
+	const size_t index{ std::min(size_t(position), m_Keyframes.size() - 1) };
+	const CameraKeyframe& from{ m_Keyframes[index] };
+	const CameraKeyframe& to{ m_Keyframes[std::min(index + 1, m_Keyframes.size() - 1)] };
+	const float factor{ position - float(index) };
+
+	camera.origin = from.origin + (to.origin - from.origin) * factor;
+	camera.fovAngle = Lerpf(from.fovAngle, to.fovAngle, factor);
+	camera.SetOrientation(Lerpf(from.pitch, to.pitch, factor), Lerpf(from.yaw, to.yaw, factor));
+}
+#pragma endregion
+
+#pragma region Benchmark
+Benchmark::Benchmark(const BenchmarkSettings& settings) :
+	m_Settings{ settings }
+{
+	m_Settings.frameCount = std::max(m_Settings.frameCount, 1u);
+}
+
+BenchmarkResult Benchmark::Run(const std::string& sceneName, Scene* pScene, Renderer* pRenderer, double loadTime,
+	const std::function<void()>& onFrameRendered) const
+{
+	Camera& camera{ pScene->GetCamera() };
+	const CameraKeyframe start{ camera.origin, camera.totalPitch, camera.totalYaw, camera.fovAngle };
+	const CameraPath path{ CameraPath::CreateDefault(camera) };
+
+	Timer timer{};
+	timer.SetFixedTimeStep(m_Settings.timeStep);
+	timer.Start();
+	pRenderer->ResetHistory();
+
+	BenchmarkResult result{};
+	result.sceneName = sceneName;
+	result.width = pRenderer->GetWidth();
+	result.height = pRenderer->GetHeight();
+	result.sphereCount = pScene->GetSphereGeometries().size();
+	result.triangleMeshCount = pScene->GetTriangleMeshCount();
+	result.triangleCount = pScene->GetTriangleCount();
+	result.lightCount = pScene->GetLights().size();
+	result.loadTime = loadTime;
+	result.workerCount = pRenderer->GetWorkerCount();
+	result.workerIdleTimes.resize(result.workerCount);
+	result.frameTimes.reserve(m_Settings.frameCount);
+
+	uint64_t primaryRayCount{};
+	for (uint32_t frame{}; frame < m_Settings.warmupFrameCount + m_Settings.frameCount; ++frame)
+	{
+		//Warm-up frames stay at the start of the path
+		const uint32_t measuredFrame{ frame < m_Settings.warmupFrameCount ? 0 : frame - m_Settings.warmupFrameCount };
+		const float progress{ m_Settings.frameCount > 1 ? float(measuredFrame) / float(m_Settings.frameCount - 1) : 0.f };
+
+		const auto frameStart{ std::chrono::steady_clock::now() };
+		pScene->Update(&timer);
+		path.Apply(progress, camera);
+		pRenderer->Render(pScene);
+		const double frameTime{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count() };
+		timer.Update();
+
+		if (onFrameRendered)
+			onFrameRendered();
+
+		if (frame < m_Settings.warmupFrameCount)
+			continue;
+		result.frameTimes.push_back(frameTime);
+		primaryRayCount += pRenderer->GetPrimaryRayCount();
+
+		const ParallelStats& workerStats{ pRenderer->GetWorkerStats() };
+		result.parallelTime += double(workerStats.wallTime) / 1e6;
+		for (size_t worker{}; worker < std::min(workerStats.idleTimes.size(), result.workerIdleTimes.size()); ++worker)
+			result.workerIdleTimes[worker] += double(workerStats.idleTimes[worker]) / 1e6;
+	}
+
+	camera.origin = start.origin;
+	camera.fovAngle = start.fovAngle;
+	camera.SetOrientation(start.pitch, start.yaw);
+	pRenderer->ResetHistory();
+
+	std::vector<double> sortedFrameTimes{ result.frameTimes };
+	std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+	const double totalTime{ std::accumulate(sortedFrameTimes.begin(), sortedFrameTimes.end(), 0.0) };
+	result.averageFrameTime = totalTime / double(sortedFrameTimes.size());
+	result.minFrameTime = sortedFrameTimes.front();
+	result.medianFrameTime = GetPercentile(sortedFrameTimes, 0.5);
+	result.p95FrameTime = GetPercentile(sortedFrameTimes, 0.95);
+	result.p99FrameTime = GetPercentile(sortedFrameTimes, 0.99);
+	result.maxFrameTime = sortedFrameTimes.back();
+	result.primaryRaysPerSecond = totalTime > 0.0 ? double(primaryRayCount) / (totalTime / 1000.0) : 0.0;
+	result.parallelTime /= double(result.frameTimes.size());
+	for (double& idleTime : result.workerIdleTimes)
+		idleTime /= double(result.frameTimes.size());
+	return result;
+}
+
+void Benchmark::PrintResult(const BenchmarkResult& result)
+{
+	std::cout << "**BENCHMARK " << result.sceneName << "** " << result.frameTimes.size() << " frames at " << result.width << "x" << result.height << "\n"
+		<< ">> SCENE = " << result.sphereCount << " spheres, " << result.triangleMeshCount << " meshes, " << result.triangleCount << " triangles, "
+		<< result.lightCount << " lights\n"
+		<< ">> MIN = " << result.minFrameTime << " ms\n"
+		<< ">> MEDIAN = " << result.medianFrameTime << " ms\n"
+		<< ">> P95 = " << result.p95FrameTime << " ms\n"
+		<< ">> P99 = " << result.p99FrameTime << " ms\n"
+		<< ">> MAX = " << result.maxFrameTime << " ms\n"
+		<< ">> PRIMARY RAYS = " << result.primaryRaysPerSecond / 1e6 << " M/s" << std::endl;
+}
+
+bool Benchmark::WriteJson(const std::string& filename, const std::vector<BenchmarkResult>& results) const
+{
+	std::ofstream file{ filename, std::ios::trunc };
+	if (!file)
+		return false;
+
+	const std::time_t now{ std::time(nullptr) };
+	char timestamp[32]{};
+	std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+	file << std::setprecision(9);
+	file << "{\n";
+	file << "\t\"version\": 2,\n";
+	file << "\t\"timestamp\": \"" << timestamp << "\",\n";
+#if defined(NDEBUG)
+	file << "\t\"configuration\": \"Release\",\n";
+#else
+	file << "\t\"configuration\": \"Debug\",\n";
+#endif
+	file << "\t\"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n";
+	file << "\t\"frames\": " << m_Settings.frameCount << ",\n";
+	file << "\t\"warmupFrames\": " << m_Settings.warmupFrameCount << ",\n";
+	file << "\t\"timeStep\": " << m_Settings.timeStep << ",\n";
+	file << "\t\"scenes\": [";
+	for (size_t resultIndex{}; resultIndex < results.size(); ++resultIndex)
+	{
+		const BenchmarkResult& result{ results[resultIndex] };
+		file << (resultIndex > 0 ? "," : "") << "\n\t\t{\n";
+		file << "\t\t\t\"name\": ";
+		WriteJsonString(file, result.sceneName);
+		file << ",\n";
+		file << "\t\t\t\"width\": " << result.width << ",\n";
+		file << "\t\t\t\"height\": " << result.height << ",\n";
+		file << "\t\t\t\"spheres\": " << result.sphereCount << ",\n";
+		file << "\t\t\t\"meshes\": " << result.triangleMeshCount << ",\n";
+		file << "\t\t\t\"triangles\": " << result.triangleCount << ",\n";
+		file << "\t\t\t\"lights\": " << result.lightCount << ",\n";
+		file << "\t\t\t\"loadMs\": " << result.loadTime << ",\n";
+		file << "\t\t\t\"avgMs\": " << result.averageFrameTime << ",\n";
+		file << "\t\t\t\"minMs\": " << result.minFrameTime << ",\n";
+		file << "\t\t\t\"medianMs\": " << result.medianFrameTime << ",\n";
+		file << "\t\t\t\"p95Ms\": " << result.p95FrameTime << ",\n";
+		file << "\t\t\t\"p99Ms\": " << result.p99FrameTime << ",\n";
+		file << "\t\t\t\"maxMs\": " << result.maxFrameTime << ",\n";
+		file << "\t\t\t\"primaryRaysPerSecond\": " << result.primaryRaysPerSecond << ",\n";
+		file << "\t\t\t\"workerThreads\": " << result.workerCount << ",\n";
+		file << "\t\t\t\"parallelMs\": " << result.parallelTime << ",\n";
+		file << "\t\t\t\"workerIdleMs\": [";
+		for (size_t worker{}; worker < result.workerIdleTimes.size(); ++worker)
+			file << (worker > 0 ? ", " : "") << result.workerIdleTimes[worker];
+		file << "],\n";
+		file << "\t\t\t\"frameMs\": [";
+		for (size_t frame{}; frame < result.frameTimes.size(); ++frame)
+			file << (frame > 0 ? ", " : "") << result.frameTimes[frame];
+		file << "]\n\t\t}";
+	}
+	file << "\n\t]\n}\n";
+	return bool(file);
+}
+#pragma endregion
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	class Scene;
+	class Renderer;
+	struct Camera;
+
+	struct CameraKeyframe
+	{
+		Vector3 origin{};
+		float pitch{};
+		float yaw{};
+		float fovAngle{};
+	};
+
+	//Camera positions visited at evenly spaced times, linearly interpolated in between
+	class CameraPath final
+	{
+	public:
+		//Sweeps around the current camera: strafes right, moves in, strafes left and returns to the start
+		static CameraPath CreateDefault(Camera& camera);
+
+		void AddKeyframe(const CameraKeyframe& keyframe) { m_Keyframes.push_back(keyframe); };
+		//progress runs from 0 (first keyframe) to 1 (last keyframe)
+		void Apply(float progress, Camera& camera) const;
+
+	private:
+		std::vector<CameraKeyframe> m_Keyframes{};
+	};
+
+	struct BenchmarkSettings
+	{
+		uint32_t frameCount{ 30 };
+		uint32_t warmupFrameCount{ 3 };
+		//Scene time between frames, animations only depend on the frame index
+		float timeStep{ 1.f / 30.f };
+	};
+
+	struct BenchmarkResult
+	{
+		std::string sceneName{};
+		uint32_t width{};
+		uint32_t height{};
+		//Scene size, so throughput can be plotted against it
+		size_t sphereCount{};
+		size_t triangleMeshCount{};
+		size_t triangleCount{};
+		size_t lightCount{};
+		double loadTime{};
+		std::vector<double> frameTimes{};
+		double averageFrameTime{};
+		double minFrameTime{};
+		double medianFrameTime{};
+		double p95FrameTime{};
+		double p99FrameTime{};
+		double maxFrameTime{};
+		double primaryRaysPerSecond{};
+		uint32_t workerCount{};
+		//Per frame: time spent in parallel loops and how much of it every worker sat idle, the rendering thread first, then each pool thread
+		double parallelTime{};
+		std::vector<double> workerIdleTimes{};
+	};
+
+	//Renders a fixed number of frames along a scripted camera path, so results only depend on the code and the machine.
+	//Times are in milliseconds
+	class Benchmark final
+	{
+	public:
+		explicit Benchmark(const BenchmarkSettings& settings);
+
+		/**
+		 * \brief Renders the warm-up and measured frames, the camera of the scene is restored afterwards
+		 * \param loadTime time it took to load the scene, only reported
+		 * \param onFrameRendered called after every frame, e.g. to show it in a window
+		 */
+		BenchmarkResult Run(const std::string& sceneName, Scene* pScene, Renderer* pRenderer, double loadTime = 0.0,
+			const std::function<void()>& onFrameRendered = {}) const;
+
+		static void PrintResult(const BenchmarkResult& result);
+		//Writes the settings, the machine and every result as one JSON document
+		bool WriteJson(const std::string& filename, const std::vector<BenchmarkResult>& results) const;
+
+	private:
+		BenchmarkSettings m_Settings{};
+	};
+}
@@ -1,13 +1,29 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
-#include <SDL_keyboard.h>
-#include <SDL_mouse.h>
 
 #include "Math.h"
-#include "Timer.h"
 
 namespace dae
 {
+	//Camera controls of one frame, filled in by whichever front end owns the input devices
+	struct CameraInput
+	{
+		bool moveForward{};
+		bool moveBackward{};
+		bool moveRight{};
+		bool moveLeft{};
+		bool narrowFov{};
+		bool widenFov{};
+		bool sprint{};
+
+		//Relative mouse motion since the previous frame
+		int mouseX{};
+		int mouseY{};
+		bool leftMouseButton{};
+		bool rightMouseButton{};
+	};
+
 	struct Camera
 	{
 		Camera() = default;
@@ -45,71 +61,67 @@ namespace dae
 			return Matrix{ right, up, forward, origin };
 		}
 
-		void Update(Timer* pTimer)
+		void Update(float deltaTime, const CameraInput& input)
 		{
-			const float deltaTime = pTimer->GetElapsed();
-
-			//Keyboard Input
-			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
-
-			//Mouse Input
-			int mouseX{}, mouseY{};
-			const uint32_t mouseState = SDL_GetRelativeMouseState(&mouseX, &mouseY);
-
 			float moveSpeed{ movementSpeed * deltaTime };
 			const float rotSpeed{ rotationSpeed * deltaTime };
 			const float speedMultiplier{ 4.f };
 
-			if (pKeyboardState[SDL_SCANCODE_LSHIFT])
+			if (input.sprint)
 			{
 				moveSpeed *= speedMultiplier;
 			}
-			if (pKeyboardState[SDL_SCANCODE_W] || pKeyboardState[SDL_SCANCODE_UP])
+			if (input.moveForward)
 			{
 				origin += forward * moveSpeed;
 			}
-			if (pKeyboardState[SDL_SCANCODE_S] || pKeyboardState[SDL_SCANCODE_DOWN])
+			if (input.moveBackward)
 			{
 				origin -= forward * moveSpeed;
 			}
-			if (pKeyboardState[SDL_SCANCODE_D] || pKeyboardState[SDL_SCANCODE_RIGHT])
+			if (input.moveRight)
 			{
 				origin += right * moveSpeed;
 			}
-			if (pKeyboardState[SDL_SCANCODE_A] || pKeyboardState[SDL_SCANCODE_LEFT])
+			if (input.moveLeft)
 			{
 				origin -= right * moveSpeed;
 			}
 
-			if (pKeyboardState[SDL_SCANCODE_LEFT] && fovAngle > minFov)
+			if (input.narrowFov && fovAngle > minFov)
 			{
 				fovAngle -= fovSpeed * deltaTime;
 			}
-			if (pKeyboardState[SDL_SCANCODE_RIGHT] && fovAngle < maxFov)
+			if (input.widenFov && fovAngle < maxFov)
 			{
 				fovAngle += fovSpeed * deltaTime;
 			}
 
 			float pitch{}; 
 			float yaw{};
-			if (mouseState == SDL_BUTTON(1))
+			if (input.leftMouseButton && !input.rightMouseButton)
 			{
-				yaw = mouseX * rotSpeed;
-				origin += (float)std::max(-5, std::min(5, -mouseY)) * forward * moveSpeed;
+				yaw = input.mouseX * rotSpeed;
+				origin += (float)std::max(-5, std::min(5, -input.mouseY)) * forward * moveSpeed;
 			}
-			if (mouseState == SDL_BUTTON(3))
+			if (input.rightMouseButton && !input.leftMouseButton)
 			{
-				yaw = mouseX * rotSpeed;
-				pitch = -mouseY * rotSpeed;
+				yaw = input.mouseX * rotSpeed;
+				pitch = -input.mouseY * rotSpeed;
 			}
-			if (mouseState == (SDL_BUTTON(1) | SDL_BUTTON(3)))
+			if (input.leftMouseButton && input.rightMouseButton)
 			{
-				origin += (float)std::max(-5, std::min(5, -mouseY))* Vector3::UnitY * moveSpeed;
+				origin += (float)std::max(-5, std::min(5, -input.mouseY))* Vector3::UnitY * moveSpeed;
 			}
 			
-			totalPitch += pitch;
-			totalPitch = std::max(std::min(totalPitch, PI_DIV_2 - 0.01f), -PI_DIV_2 + 0.01f);
-			totalYaw += yaw;
+			SetOrientation(totalPitch + pitch, totalYaw + yaw);
+		}
+
+		//Absolute orientation in radians, the pitch stops just short of looking straight up or down
+		void SetOrientation(float pitch, float yaw)
+		{
+			totalPitch = std::max(std::min(pitch, PI_DIV_2 - 0.01f), -PI_DIV_2 + 0.01f);
+			totalYaw = yaw;
 
 			const Matrix& rotationMatrix{ Matrix::CreateRotationX(totalPitch) * Matrix::CreateRotationY(totalYaw) };
 			forward = rotationMatrix.TransformVector(Vector3::UnitZ).Normalized();
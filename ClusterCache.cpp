@@ -0,0 +1,557 @@
+#include "ClusterCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "ThreadPool.h"
+#include "Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr char CLUSTER_FILE_MAGIC[8]{ 'R', 'T', 'C', 'L', 'U', 'S', 'T', '\0' };
+	//Bump whenever the layout of the file, the blocks or the compact mesh encoding changes
+	constexpr uint32_t CLUSTER_FILE_VERSION{ 1 };
+	constexpr uint64_t CLUSTER_FILE_ALIGNMENT{ 64 };
+
+	thread_local bool t_IsDeferring{ false };
+	thread_local bool t_HasSkippedCluster{ false };
+
+	//Followed by the top level nodes, the cluster records and the aligned cluster blocks
+	struct ClusterFileHeader
+	{
+		char magic[8]{};
+		uint32_t version{};
+		uint32_t clusterCount{};
+		uint64_t sourceSize{};
+		int64_t sourceWriteTime{};
+
+		float minAABB[3]{};
+		float maxAABB[3]{};
+		uint32_t topNodeCount{};
+		uint32_t reserved{};
+	};
+
+	//Start of every cluster block, followed by the arrays of the compact mesh in the order of the counts
+	struct ClusterBlockHeader
+	{
+		float minAABB[3]{};
+		float quantizationStep[3]{};
+		uint32_t nodeCount{};
+		uint32_t vertexCount{};
+		uint32_t triangleCount{};
+		uint32_t overflowCount{};
+	};
+
+	std::string GetClusterFilePath(const std::string& filename)
+	{
+		return filename + ".clusters";
+	}
+
+	uint64_t AlignOffset(uint64_t offset)
+	{
+		return (offset + CLUSTER_FILE_ALIGNMENT - 1) / CLUSTER_FILE_ALIGNMENT * CLUSTER_FILE_ALIGNMENT;
+	}
+
+	uint64_t GetBlockSize(const ClusterBlockHeader& header)
+	{
+		return sizeof(ClusterBlockHeader) + uint64_t(header.nodeCount) * (sizeof(BVHNode) + sizeof(int))
+			+ uint64_t(header.triangleCount) * (sizeof(uint32_t) + 3 * sizeof(uint16_t))
+			+ uint64_t(header.overflowCount) * sizeof(int) + uint64_t(header.vertexCount) * 3 * sizeof(uint16_t);
+	}
+
+	//Triangle range covered by every subtree, children always split the range of their parent
+	void CalculateSubtreeRanges(const std::vector<BVHNode>& nodes, std::vector<int>& firsts, std::vector<int>& counts)
+	{
+		firsts.assign(nodes.size(), 0);
+		counts.assign(nodes.size(), 0);
+		for (int nodeIndex{ static_cast<int>(nodes.size()) - 1 }; nodeIndex >= 0; --nodeIndex)
+		{
+			const BVHNode& node{ nodes[nodeIndex] };
+			counts[nodeIndex] = node.IsLeaf() ? node.triangleCount : counts[node.leftFirst] + counts[node.leftFirst + 1];
+		}
+		for (size_t nodeIndex{}; nodeIndex < nodes.size(); ++nodeIndex)
+		{
+			const BVHNode& node{ nodes[nodeIndex] };
+			if (node.IsLeaf())
+			{
+				firsts[nodeIndex] = node.leftFirst;
+				continue;
+			}
+			firsts[node.leftFirst] = firsts[nodeIndex];
+			firsts[node.leftFirst + 1] = firsts[nodeIndex] + counts[node.leftFirst];
+		}
+	}
+
+	//Copies the subtree below rootIndex into a mesh of its own, compacted against its own bounds
+	TriangleMesh CreateCluster(const TriangleMesh& mesh, int rootIndex, int firstTriangle, int triangleCount, std::vector<int>& vertexMap)
+	{
+		TriangleMesh cluster{};
+
+		std::vector<std::pair<int, int>> nodeStack{ { rootIndex, 0 } };
+		cluster.bvhNodes.push_back(mesh.bvhNodes[rootIndex]);
+		while (!nodeStack.empty())
+		{
+			const auto [sourceIndex, clusterIndex] { nodeStack.back() };
+			nodeStack.pop_back();
+
+			const BVHNode& sourceNode{ mesh.bvhNodes[sourceIndex] };
+			if (sourceNode.IsLeaf())
+			{
+				cluster.bvhNodes[clusterIndex].leftFirst = sourceNode.leftFirst - firstTriangle;
+				continue;
+			}
+
+			const int childIndex{ static_cast<int>(cluster.bvhNodes.size()) };
+			cluster.bvhNodes[clusterIndex].leftFirst = childIndex;
+			cluster.bvhNodes.push_back(mesh.bvhNodes[sourceNode.leftFirst]);
+			cluster.bvhNodes.push_back(mesh.bvhNodes[sourceNode.leftFirst + 1]);
+			nodeStack.push_back({ sourceNode.leftFirst + 1, childIndex + 1 });
+			nodeStack.push_back({ sourceNode.leftFirst, childIndex });
+		}
+
+		for (int i{ firstTriangle * 3 }; i < (firstTriangle + triangleCount) * 3; ++i)
+		{
+			int& clusterVertex{ vertexMap[mesh.indices[i]] };
+			if (clusterVertex < 0)
+			{
+				clusterVertex = static_cast<int>(cluster.positions.size());
+				cluster.positions.push_back(mesh.positions[mesh.indices[i]]);
+			}
+			cluster.indices.push_back(clusterVertex);
+		}
+		cluster.normals.assign(mesh.normals.begin() + firstTriangle, mesh.normals.begin() + firstTriangle + triangleCount);
+
+		//The map is shared by all clusters, only reset what this one used
+		for (int i{ firstTriangle * 3 }; i < (firstTriangle + triangleCount) * 3; ++i)
+			vertexMap[mesh.indices[i]] = -1;
+
+		cluster.Compact();
+		return cluster;
+	}
+
+	//Splits the hierarchy of a loaded mesh into clusters of at most maxClusterTriangles and writes them behind the top of the tree
+	bool WriteClusterFile(const std::string& filename, const TriangleMesh& mesh)
+	{
+		ClusterFileHeader header{};
+		std::memcpy(header.magic, CLUSTER_FILE_MAGIC, sizeof(header.magic));
+		header.version = CLUSTER_FILE_VERSION;
+		if (mesh.bvhNodes.empty() || !Utils::GetSourceStamp(filename, header.sourceSize, header.sourceWriteTime))
+			return false;
+
+		std::vector<int> firsts{}, counts{};
+		CalculateSubtreeRanges(mesh.bvhNodes, firsts, counts);
+
+		//The top of the tree keeps the node layout of BuildBVH, children next to each other and after their parent
+		std::vector<BVHNode> topNodes{ mesh.bvhNodes[0] };
+		std::vector<TriangleMesh> clusters{};
+		std::vector<int> vertexMap(mesh.positions.size(), -1);
+		std::vector<std::pair<int, int>> nodeStack{ { 0, 0 } };
+		while (!nodeStack.empty())
+		{
+			const auto [sourceIndex, topIndex] { nodeStack.back() };
+			nodeStack.pop_back();
+
+			if (counts[sourceIndex] <= static_cast<int>(ClusterCache::maxClusterTriangles))
+			{
+				clusters.emplace_back(CreateCluster(mesh, sourceIndex, firsts[sourceIndex], counts[sourceIndex], vertexMap));
+				topNodes[topIndex].leftFirst = static_cast<int>(clusters.size()) - 1;
+				topNodes[topIndex].triangleCount = counts[sourceIndex];
+				continue;
+			}
+
+			const int leftIndex{ mesh.bvhNodes[sourceIndex].leftFirst };
+			const int childIndex{ static_cast<int>(topNodes.size()) };
+			topNodes[topIndex].leftFirst = childIndex;
+			topNodes.push_back(mesh.bvhNodes[leftIndex]);
+			topNodes.push_back(mesh.bvhNodes[leftIndex + 1]);
+			nodeStack.push_back({ leftIndex + 1, childIndex + 1 });
+			nodeStack.push_back({ leftIndex, childIndex });
+		}
+
+		//Quantization can grow a cluster slightly, refit the top levels to the compacted roots
+		for (int nodeIndex{ static_cast<int>(topNodes.size()) - 1 }; nodeIndex >= 0; --nodeIndex)
+		{
+			BVHNode& node{ topNodes[nodeIndex] };
+			const BVHNode& minNode{ node.IsLeaf() ? clusters[node.leftFirst].bvhNodes[0] : topNodes[node.leftFirst] };
+			const BVHNode& maxNode{ node.IsLeaf() ? clusters[node.leftFirst].bvhNodes[0] : topNodes[node.leftFirst + 1] };
+			node.minAABB = Vector3::Min(minNode.minAABB, maxNode.minAABB);
+			node.maxAABB = Vector3::Max(minNode.maxAABB, maxNode.maxAABB);
+		}
+
+		header.clusterCount = static_cast<uint32_t>(clusters.size());
+		header.topNodeCount = static_cast<uint32_t>(topNodes.size());
+		for (int axis{}; axis < 3; ++axis)
+		{
+			header.minAABB[axis] = topNodes[0].minAABB[axis];
+			header.maxAABB[axis] = topNodes[0].maxAABB[axis];
+		}
+
+		std::vector<ClusterRecord> records(clusters.size());
+		uint64_t offset{ sizeof(ClusterFileHeader) + topNodes.size() * sizeof(BVHNode) + records.size() * sizeof(ClusterRecord) };
+		std::vector<ClusterBlockHeader> blockHeaders(clusters.size());
+		for (size_t clusterIndex{}; clusterIndex < clusters.size(); ++clusterIndex)
+		{
+			const TriangleMesh& cluster{ clusters[clusterIndex] };
+			ClusterBlockHeader& blockHeader{ blockHeaders[clusterIndex] };
+			for (int axis{}; axis < 3; ++axis)
+			{
+				blockHeader.minAABB[axis] = cluster.minAABB[axis];
+				blockHeader.quantizationStep[axis] = cluster.quantizationStep[axis];
+			}
+			blockHeader.nodeCount = static_cast<uint32_t>(cluster.bvhNodes.size());
+			blockHeader.vertexCount = static_cast<uint32_t>(cluster.quantizedPositions.size() / 3);
+			blockHeader.triangleCount = static_cast<uint32_t>(cluster.packedNormals.size());
+			blockHeader.overflowCount = static_cast<uint32_t>(cluster.overflowIndices.size());
+
+			offset = AlignOffset(offset);
+			records[clusterIndex] = { offset, GetBlockSize(blockHeader) };
+			offset += records[clusterIndex].size;
+		}
+
+		//Written under a temporary name so a crash never leaves a truncated file behind
+		const std::string clusterPath{ GetClusterFilePath(filename) };
+		const std::string temporaryPath{ clusterPath + ".tmp" };
+		{
+			std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+			if (!file)
+				return false;
+
+			auto writeArray = [&](const auto& elements)
+			{
+				file.write(reinterpret_cast<const char*>(elements.data()), std::streamsize(elements.size() * sizeof(elements[0])));
+			};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(ClusterFileHeader));
+			writeArray(topNodes);
+			writeArray(records);
+			for (size_t clusterIndex{}; clusterIndex < clusters.size(); ++clusterIndex)
+			{
+				const TriangleMesh& cluster{ clusters[clusterIndex] };
+				const char padding[CLUSTER_FILE_ALIGNMENT]{};
+				file.write(padding, std::streamsize(records[clusterIndex].offset - uint64_t(file.tellp())));
+				file.write(reinterpret_cast<const char*>(&blockHeaders[clusterIndex]), sizeof(ClusterBlockHeader));
+				writeArray(cluster.bvhNodes);
+				writeArray(cluster.leafVertexBases);
+				writeArray(cluster.packedNormals);
+				writeArray(cluster.overflowIndices);
+				writeArray(cluster.quantizedPositions);
+				writeArray(cluster.compactIndices);
+			}
+			if (!file)
+				return false;
+		}
+
+		std::error_code error{};
+		std::filesystem::rename(temporaryPath, clusterPath, error);
+		return !error;
+	}
+
+	//Reads the header, the top level nodes and the cluster records, checking they belong to the current source
+	bool ReadClusterFile(const std::string& filename, ClusterFileHeader& header, std::vector<BVHNode>& topNodes, std::vector<ClusterRecord>& records)
+	{
+		uint64_t sourceSize{};
+		int64_t sourceWriteTime{};
+		std::ifstream file{ GetClusterFilePath(filename), std::ios::binary };
+		if (!file || !Utils::GetSourceStamp(filename, sourceSize, sourceWriteTime))
+			return false;
+
+		file.read(reinterpret_cast<char*>(&header), sizeof(ClusterFileHeader));
+		if (!file || std::memcmp(header.magic, CLUSTER_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != CLUSTER_FILE_VERSION
+			|| header.sourceSize != sourceSize || header.sourceWriteTime != sourceWriteTime || header.topNodeCount == 0)
+			return false;
+
+		topNodes.resize(header.topNodeCount);
+		records.resize(header.clusterCount);
+		file.read(reinterpret_cast<char*>(topNodes.data()), std::streamsize(topNodes.size() * sizeof(BVHNode)));
+		file.read(reinterpret_cast<char*>(records.data()), std::streamsize(records.size() * sizeof(ClusterRecord)));
+		if (!file)
+			return false;
+
+		//Leaves must reference existing clusters and children must come after their parent
+		for (size_t nodeIndex{}; nodeIndex < topNodes.size(); ++nodeIndex)
+		{
+			const BVHNode& node{ topNodes[nodeIndex] };
+			const bool isValid{ node.IsLeaf() ? node.leftFirst >= 0 && uint32_t(node.leftFirst) < header.clusterCount
+				: node.leftFirst > int(nodeIndex) && uint32_t(node.leftFirst) + 1 < header.topNodeCount };
+			if (!isValid)
+				return false;
+		}
+		return true;
+	}
+
+	//Decodes a cluster block, returns an empty cluster when the block is damaged
+	TriangleMesh DecodeCluster(const std::vector<char>& block)
+	{
+		TriangleMesh cluster{};
+		ClusterBlockHeader header{};
+		if (block.size() < sizeof(ClusterBlockHeader))
+			return cluster;
+		std::memcpy(&header, block.data(), sizeof(ClusterBlockHeader));
+		if (GetBlockSize(header) != block.size() || header.nodeCount == 0)
+			return cluster;
+
+		const char* pData{ block.data() + sizeof(ClusterBlockHeader) };
+		auto readArray = [&](auto& elements, size_t count)
+		{
+			elements.resize(count);
+			std::memcpy(elements.data(), pData, count * sizeof(elements[0]));
+			pData += count * sizeof(elements[0]);
+		};
+		readArray(cluster.bvhNodes, header.nodeCount);
+		readArray(cluster.leafVertexBases, header.nodeCount);
+		readArray(cluster.packedNormals, header.triangleCount);
+		readArray(cluster.overflowIndices, header.overflowCount);
+		readArray(cluster.quantizedPositions, size_t(header.vertexCount) * 3);
+		readArray(cluster.compactIndices, size_t(header.triangleCount) * 3);
+
+		//Every index a hit test can follow has to stay inside the arrays
+		bool isValid{ true };
+		for (int nodeIndex{}; nodeIndex < static_cast<int>(cluster.bvhNodes.size()) && isValid; ++nodeIndex)
+		{
+			const BVHNode& node{ cluster.bvhNodes[nodeIndex] };
+			if (!node.IsLeaf())
+			{
+				isValid = node.leftFirst > nodeIndex && uint32_t(node.leftFirst) + 1 < header.nodeCount;
+				continue;
+			}
+
+			const int vertexBase{ cluster.leafVertexBases[nodeIndex] };
+			isValid = node.leftFirst >= 0 && uint32_t(node.leftFirst + node.triangleCount) <= header.triangleCount
+				&& (vertexBase >= 0 || uint32_t(-1 - vertexBase) + uint32_t(node.triangleCount) * 3 <= header.overflowCount);
+			for (int i{ node.leftFirst * 3 }; i < (node.leftFirst + node.triangleCount) * 3 && isValid; ++i)
+			{
+				const int vertex{ vertexBase >= 0 ? vertexBase + cluster.compactIndices[i] : cluster.overflowIndices[-1 - vertexBase + i - node.leftFirst * 3] };
+				isValid = vertex >= 0 && uint32_t(vertex) < header.vertexCount;
+			}
+		}
+		if (!isValid)
+			return {};
+
+		for (int axis{}; axis < 3; ++axis)
+		{
+			cluster.minAABB[axis] = header.minAABB[axis];
+			cluster.quantizationStep[axis] = header.quantizationStep[axis];
+		}
+		cluster.maxAABB = cluster.minAABB + Vector3{ cluster.quantizationStep.x, cluster.quantizationStep.y, cluster.quantizationStep.z } * 65535.f;
+		cluster.isCompact = true;
+		return cluster;
+	}
+}
+
+ClusterCache::ClusterCache(size_t capacityBytes, uint32_t ioThreadCount) :
+	m_pThreadPool{ new ThreadPool(ioThreadCount) },
+	m_CapacityBytes{ capacityBytes }
+{
+}
+
+ClusterCache::~ClusterCache()
+{
+	//Finishes queued loads, they still insert into the files
+	delete m_pThreadPool;
+	m_pThreadPool = nullptr;
+
+	for (ClusterFile* pFile : m_pFiles)
+		delete pFile;
+	m_pFiles.clear();
+}
+
+bool ClusterCache::OpenMesh(const std::string& filename, TriangleMesh& mesh)
+{
+	ClusterFileHeader header{};
+	std::vector<BVHNode> topNodes{};
+	std::vector<ClusterRecord> records{};
+	if (!ReadClusterFile(filename, header, topNodes, records))
+	{
+		//Splitting needs the whole mesh once, afterwards only the clusters in use are
+		TriangleMesh source{};
+		if (!Utils::LoadMesh(filename, source))
+			return false;
+		if (!WriteClusterFile(filename, source) || !ReadClusterFile(filename, header, topNodes, records))
+		{
+			std::cout << "Failed to write " << GetClusterFilePath(filename) << std::endl;
+			return false;
+		}
+	}
+
+	ClusterFile* pFile{ new ClusterFile{} };
+	pFile->filename = GetClusterFilePath(filename);
+	pFile->records = std::move(records);
+	pFile->slots = std::vector<ClusterSlot>(pFile->records.size());
+
+	uint32_t fileIndex{};
+	{
+		const std::unique_lock<std::shared_mutex> lock{ m_Mutex };
+		fileIndex = static_cast<uint32_t>(m_pFiles.size());
+		m_pFiles.push_back(pFile);
+	}
+
+	mesh = {};
+	mesh.bvhNodes = std::move(topNodes);
+	mesh.minAABB = { header.minAABB[0], header.minAABB[1], header.minAABB[2] };
+	mesh.maxAABB = { header.maxAABB[0], header.maxAABB[1], header.maxAABB[2] };
+	mesh.isCompact = true;
+	mesh.pClusterCache = this;
+	mesh.clusterFileIndex = fileIndex;
+	mesh.UpdateTransforms();
+
+	std::cout << "Opened " << pFile->filename << ": " << pFile->records.size() << " clusters, " << mesh.bvhNodes.size() << " resident nodes" << std::endl;
+	return true;
+}
+
+std::shared_ptr<const TriangleMesh> ClusterCache::Acquire(uint32_t fileIndex, uint32_t clusterIndex)
+{
+	{
+		const std::shared_lock<std::shared_mutex> lock{ m_Mutex };
+		ClusterSlot& slot{ m_pFiles[fileIndex]->slots[clusterIndex] };
+		if (slot.pCluster)
+		{
+			Touch(slot);
+			return slot.pCluster;
+		}
+	}
+
+	std::shared_future<std::shared_ptr<const TriangleMesh>> load{};
+	{
+		const std::unique_lock<std::shared_mutex> lock{ m_Mutex };
+		ClusterSlot& slot{ m_pFiles[fileIndex]->slots[clusterIndex] };
+		if (slot.pCluster)
+		{
+			Touch(slot);
+			return slot.pCluster;
+		}
+
+		//Every ray missing the same cluster shares one read
+		if (!slot.pendingLoad.valid())
+			slot.pendingLoad = m_pThreadPool->Enqueue([this, fileIndex, clusterIndex]() { return LoadCluster(fileIndex, clusterIndex); }).share();
+		load = slot.pendingLoad;
+	}
+
+	if (t_IsDeferring)
+	{
+		t_HasSkippedCluster = true;
+		m_DeferredCount.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	//The loaded cluster is returned even if it got evicted again in the meantime
+	return load.get();
+}
+
+void ClusterCache::WaitForPendingLoads() const
+{
+	std::vector<std::shared_future<std::shared_ptr<const TriangleMesh>>> loads{};
+	{
+		const std::shared_lock<std::shared_mutex> lock{ m_Mutex };
+		for (const ClusterFile* pFile : m_pFiles)
+		{
+			for (const ClusterSlot& slot : pFile->slots)
+			{
+				if (slot.pendingLoad.valid())
+					loads.push_back(slot.pendingLoad);
+			}
+		}
+	}
+
+	for (const auto& load : loads)
+		load.wait();
+}
+
+ClusterCacheStats ClusterCache::GetStats() const
+{
+	const std::shared_lock<std::shared_mutex> lock{ m_Mutex };
+
+	ClusterCacheStats stats{};
+	stats.loadCount = m_LoadCount;
+	stats.evictionCount = m_EvictionCount;
+	stats.deferredCount = m_DeferredCount.load(std::memory_order_relaxed);
+	stats.residentBytes = m_ResidentBytes;
+	stats.capacityBytes = m_CapacityBytes;
+	return stats;
+}
+
+void ClusterCache::BeginDeferring()
+{
+	t_IsDeferring = true;
+	t_HasSkippedCluster = false;
+}
+
+bool ClusterCache::EndDeferring()
+{
+	t_IsDeferring = false;
+	return t_HasSkippedCluster;
+}
+
+std::shared_ptr<const TriangleMesh> ClusterCache::LoadCluster(uint32_t fileIndex, uint32_t clusterIndex)
+{
+	std::string filename{};
+	ClusterRecord record{};
+	{
+		const std::shared_lock<std::shared_mutex> lock{ m_Mutex };
+		filename = m_pFiles[fileIndex]->filename;
+		record = m_pFiles[fileIndex]->records[clusterIndex];
+	}
+
+	std::vector<char> block(record.size);
+	std::ifstream file{ filename, std::ios::binary };
+	file.seekg(std::streamoff(record.offset));
+	file.read(block.data(), std::streamsize(block.size()));
+
+	std::shared_ptr<TriangleMesh> pCluster{ std::make_shared<TriangleMesh>(file ? DecodeCluster(block) : TriangleMesh{}) };
+	if (pCluster->bvhNodes.empty())
+		std::cout << "Failed to read cluster " << clusterIndex << " of " << filename << std::endl;
+
+	const std::unique_lock<std::shared_mutex> lock{ m_Mutex };
+	ClusterSlot& slot{ m_pFiles[fileIndex]->slots[clusterIndex] };
+	slot.pCluster = pCluster;
+	slot.pendingLoad = {};
+	slot.bytes = pCluster->GetMemoryUsage();
+	slot.lastUse.store(m_UseClock.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	m_ResidentBytes += slot.bytes;
+	m_ResidentClusters.emplace_back(fileIndex, clusterIndex);
+	++m_LoadCount;
+	EvictLeastRecentlyUsed();
+	return pCluster;
+}
+
+void ClusterCache::EvictLeastRecentlyUsed()
+{
+	//The cluster loaded last is never evicted, rays still traversing an evicted cluster keep it alive until they are done
+	while (m_ResidentBytes > m_CapacityBytes && m_ResidentClusters.size() > 1)
+	{
+		size_t oldestIndex{};
+		uint64_t oldestUse{ UINT64_MAX };
+		for (size_t index{}; index + 1 < m_ResidentClusters.size(); ++index)
+		{
+			const auto [fileIndex, clusterIndex] { m_ResidentClusters[index] };
+			const uint64_t lastUse{ m_pFiles[fileIndex]->slots[clusterIndex].lastUse.load(std::memory_order_relaxed) };
+			if (lastUse < oldestUse)
+			{
+				oldestUse = lastUse;
+				oldestIndex = index;
+			}
+		}
+
+		const auto [fileIndex, clusterIndex] { m_ResidentClusters[oldestIndex] };
+		ClusterSlot& slot{ m_pFiles[fileIndex]->slots[clusterIndex] };
+		m_ResidentBytes -= slot.bytes;
+		slot.pCluster.reset();
+		slot.bytes = 0;
+
+		//Keep the newest cluster last
+		m_ResidentClusters.erase(m_ResidentClusters.begin() + oldestIndex);
+		++m_EvictionCount;
+	}
+}
+
+void ClusterCache::Touch(ClusterSlot& slot) const
+{
+	//Only writes when the clock moved, so hot clusters do not bounce their cache line between threads
+	const uint64_t useClock{ m_UseClock.load(std::memory_order_relaxed) };
+	if (slot.lastUse.load(std::memory_order_relaxed) != useClock)
+		slot.lastUse.store(useClock, std::memory_order_relaxed);
+}
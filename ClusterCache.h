@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	struct ClusterCacheStats
+	{
+		uint64_t loadCount{};
+		uint64_t evictionCount{};
+		uint64_t deferredCount{};
+		size_t residentBytes{};
+		size_t capacityBytes{};
+	};
+
+	//Location of a cluster block inside a .clusters file
+	struct ClusterRecord
+	{
+		uint64_t offset{};
+		uint64_t size{};
+	};
+
+	//Pages the clusters (compact BVH subtrees) of out of core meshes in from .clusters files on demand.
+	//At most capacityBytes of clusters stay resident, the least recently used cluster is evicted first
+	class ClusterCache final
+	{
+	public:
+		explicit ClusterCache(size_t capacityBytes, uint32_t ioThreadCount = 2);
+		~ClusterCache();
+
+		ClusterCache(const ClusterCache&) = delete;
+		ClusterCache(ClusterCache&&) noexcept = delete;
+		ClusterCache& operator=(const ClusterCache&) = delete;
+		ClusterCache& operator=(ClusterCache&&) noexcept = delete;
+
+		/**
+		 * \brief Turns a mesh into an out of core mesh, only the top of its hierarchy stays in memory
+		 * Writes <filename>.clusters from the source when it is missing or older than the source
+		 * \param filename path to the OBJ or PLY file
+		 * \param mesh receives the top level hierarchy and object space bounds
+		 * \return false when neither the cluster file nor the source could be read
+		 */
+		bool OpenMesh(const std::string& filename, TriangleMesh& mesh);
+
+		/**
+		 * \brief Returns a resident cluster, loading it first when needed
+		 * While the calling thread defers, a missing cluster is only queued and nullptr is returned
+		 */
+		std::shared_ptr<const TriangleMesh> Acquire(uint32_t fileIndex, uint32_t clusterIndex);
+
+		//Blocks until every queued load finished
+		void WaitForPendingLoads() const;
+		ClusterCacheStats GetStats() const;
+
+		//Deferring only applies to the calling thread, EndDeferring returns true when a cluster was skipped
+		static void BeginDeferring();
+		static bool EndDeferring();
+
+		static constexpr uint32_t maxClusterTriangles{ 4096 };
+
+	private:
+		struct ClusterSlot
+		{
+			std::shared_ptr<const TriangleMesh> pCluster{};
+			std::shared_future<std::shared_ptr<const TriangleMesh>> pendingLoad{};
+			std::atomic<uint64_t> lastUse{};
+			size_t bytes{};
+		};
+
+		struct ClusterFile
+		{
+			std::string filename{};
+			std::vector<ClusterRecord> records{};
+			std::vector<ClusterSlot> slots{};
+		};
+
+		ThreadPool* m_pThreadPool{ nullptr };
+		std::vector<ClusterFile*> m_pFiles{};
+		//(file, cluster) of every resident cluster, scanned for the least recently used one on eviction
+		std::vector<std::pair<uint32_t, uint32_t>> m_ResidentClusters{};
+		mutable std::shared_mutex m_Mutex{};
+
+		size_t m_CapacityBytes{};
+		size_t m_ResidentBytes{};
+		//Advances on every load, so clusters touched since the last load compare as most recently used
+		std::atomic<uint64_t> m_UseClock{};
+		uint64_t m_LoadCount{};
+		uint64_t m_EvictionCount{};
+		std::atomic<uint64_t> m_DeferredCount{};
+
+		std::shared_ptr<const TriangleMesh> LoadCluster(uint32_t fileIndex, uint32_t clusterIndex);
+		void EvictLeastRecentlyUsed();
+		void Touch(ClusterSlot& slot) const;
+	};
+}
@@ -166,6 +166,11 @@ namespace dae
 				*this /= maxValue;
 		}
 
+		float Luminance() const
+		{
+			return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+		}
+
 		static ColorRGB Lerp(const ColorRGB& c1, const ColorRGB& c2, float factor)
 		{
 			return { Lerpf(c1.r, c2.r, factor), Lerpf(c1.g, c2.g, factor), Lerpf(c1.b, c2.b, factor) };
@@ -1,7 +1,13 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
 
 #include "Math.h"
+#include "Profiler.h"
 #include "vector"
 
 namespace dae
@@ -54,6 +60,30 @@ namespace dae
 		unsigned char materialIndex{};
 	};
 
+	//Pointer-free so a whole hierarchy can be written to and read from disk as one block
+	struct BVHNode
+	{
+		Vector3 minAABB{};
+		int leftFirst{}; //Left child index for interior nodes, first triangle for leaves (right child is leftFirst + 1)
+		Vector3 maxAABB{};
+		int triangleCount{};
+
+		bool IsLeaf() const { return triangleCount > 0; }
+	};
+
+	class ClusterCache;
+
+	//Result of TriangleMesh::Optimize
+	struct MeshOptimizationStats
+	{
+		size_t vertexCountBefore{};
+		size_t vertexCountAfter{};
+		size_t triangleCountBefore{};
+		size_t triangleCountAfter{};
+		size_t bytesBefore{};
+		size_t bytesAfter{};
+	};
+
 	struct TriangleMesh
 	{
 		TriangleMesh() = default;
@@ -93,6 +123,27 @@ namespace dae
 		std::vector<Vector3> transformedPositions{};
 		std::vector<Vector3> transformedNormals{};
 
+		//Built in object space, refitted to the transformed positions
+		std::vector<BVHNode> bvhNodes{};
+		std::vector<BVHNode> transformedBVHNodes{};
+		static constexpr int maxLeafTriangles{ 4 };
+		//Entries of the traversal stack, median splits keep the depth near log2 of the triangle count
+		static constexpr int bvhStackSize{ 64 };
+
+		//Compact storage (see Compact), replaces positions, normals, indices and the transformed copies
+		bool isCompact{ false };
+		std::vector<uint16_t> quantizedPositions{};
+		std::vector<uint32_t> packedNormals{};
+		std::vector<uint16_t> compactIndices{};
+		std::vector<int> overflowIndices{};
+		std::vector<int> leafVertexBases{};
+		Vector3 quantizationStep{};
+		Matrix inverseTransform{};
+
+		//Out of core meshes are compact, bvhNodes only holds the top of the hierarchy and its leaves reference clusters
+		ClusterCache* pClusterCache{ nullptr };
+		uint32_t clusterFileIndex{};
+
 		void Translate(const Vector3& translation)
 		{
 			translationTransform = Matrix::CreateTranslation(translation);
@@ -108,8 +159,40 @@ namespace dae
 			scaleTransform = Matrix::CreateScale(scale);
 		}
 
+		Matrix GetTransform() const
+		{
+			return scaleTransform * rotationTransform * translationTransform;
+		}
+
+		//The rotation is orthonormal, so its transpose is its inverse
+		Matrix GetInverseTransform() const
+		{
+			const Vector3 scale{ scaleTransform[0].x, scaleTransform[1].y, scaleTransform[2].z };
+			const Matrix inverseScale{ Matrix::CreateScale(scale.x != 0.f ? 1.f / scale.x : 0.f, scale.y != 0.f ? 1.f / scale.y : 0.f, scale.z != 0.f ? 1.f / scale.z : 0.f) };
+			return Matrix::CreateTranslation(-translationTransform.GetTranslation()) * Matrix::Transpose(rotationTransform) * inverseScale;
+		}
+
+		//Splits an affine transform into the scale, rotation and translation matrices, shear is lost
+		void SetTransform(const Matrix& transform)
+		{
+			const Vector3 axisX{ transform.GetAxisX() };
+			const Vector3 axisY{ transform.GetAxisY() };
+			const Vector3 axisZ{ transform.GetAxisZ() };
+
+			Vector3 scale{ axisX.Magnitude(), axisY.Magnitude(), axisZ.Magnitude() };
+			if (Vector3::Dot(Vector3::Cross(axisX, axisY), axisZ) < 0.f)
+				scale.x = -scale.x;
+
+			scaleTransform = Matrix::CreateScale(scale);
+			rotationTransform = {};
+			if (scale.x != 0.f && scale.y != 0.f && scale.z != 0.f)
+				rotationTransform = Matrix{ axisX / scale.x, axisY / scale.y, axisZ / scale.z, Vector3::Zero };
+			translationTransform = Matrix::CreateTranslation(transform.GetTranslation());
+		}
+
 		void AppendTriangle(const Triangle& triangle, bool ignoreTransformUpdate = false)
 		{
+			assert(!isCompact && "Compact meshes can not be edited");
 			int startIndex = static_cast<int>(positions.size());
 
 			positions.push_back(triangle.v0);
@@ -122,6 +205,10 @@ namespace dae
 
 			normals.push_back(triangle.normal);
 
+			//Hierarchy no longer covers all triangles
+			bvhNodes.clear();
+			transformedBVHNodes.clear();
+
 			//Not ideal, but making sure all vertices are updated
 			if(!ignoreTransformUpdate)
 				UpdateTransforms();
@@ -132,26 +219,452 @@ namespace dae
 			normals.reserve(indices.size() / 3);
 			for (int i{}; i < indices.size(); i += 3)
 			{
-				const Vector3& edgeV0V1 = positions[i + 1] - positions[i];
-				const Vector3& edgeV0V2 = positions[i + 2] - positions[i];
+				const Vector3& edgeV0V1 = positions[indices[i + 1]] - positions[indices[i]];
+				const Vector3& edgeV0V2 = positions[indices[i + 2]] - positions[indices[i]];
 				normals.emplace_back(Vector3::Cross(edgeV0V1, edgeV0V2).Normalized());
 			}
 		}
 
 		void UpdateTransforms()
 		{
+			PROFILE_SCOPE("TriangleMesh::UpdateTransforms");
 			//Calculate Final Transform 
-			const auto& finalTransform{ scaleTransform * rotationTransform * translationTransform };
+			const auto& finalTransform{ GetTransform() };
 
-			transformedPositions.reserve(positions.size());
-			transformedNormals.reserve(normals.size());
+			//Compact meshes are hit tested in object space, nothing to transform
+			if (isCompact)
+			{
+				inverseTransform = GetInverseTransform();
+				UpdateTransformedAABB(finalTransform);
+				return;
+			}
+
+			transformedPositions.resize(positions.size());
+			transformedNormals.resize(normals.size());
 
 			for (int i{}; i < positions.size(); i++)
 				transformedPositions[i] = finalTransform.TransformPoint(positions[i]);
+			//Degenerate triangles keep their zero normal, normalizing it would produce NaNs that pass every hit test
 			for (int i{}; i < normals.size(); i++)
-				transformedNormals[i] = finalTransform.TransformVector(normals[i]).Normalized();
+				transformedNormals[i] = normals[i].SqrMagnitude() > 0.f ? finalTransform.TransformVector(normals[i]).Normalized() : Vector3::Zero;
 
 			UpdateTransformedAABB(finalTransform);
+
+			if (!bvhNodes.empty())
+				RefitBVH();
+		}
+
+		/**
+		 * \brief Builds a bounding volume hierarchy over the object space triangles (median split on the largest centroid axis)
+		 * Reorders indices and normals so every leaf references a contiguous range of triangles
+		 */
+		void BuildBVH()
+		{
+			bvhNodes.clear();
+			transformedBVHNodes.clear();
+
+			const int triangleCount{ static_cast<int>(indices.size() / 3) };
+			if (triangleCount == 0)
+				return;
+
+			std::vector<int> order(triangleCount);
+			std::iota(order.begin(), order.end(), 0);
+
+			std::vector<Vector3> centroids(triangleCount);
+			for (int i{}; i < triangleCount; ++i)
+				centroids[i] = (positions[indices[i * 3]] + positions[indices[i * 3 + 1]] + positions[indices[i * 3 + 2]]) / 3.f;
+
+			//A binary tree with at least one triangle per leaf never has more nodes than this, so references stay valid
+			bvhNodes.reserve(size_t(triangleCount) * 2 - 1);
+			bvhNodes.push_back({ {}, 0, {}, triangleCount });
+
+			std::vector<int> nodeStack{ 0 };
+			while (!nodeStack.empty())
+			{
+				BVHNode& node{ bvhNodes[nodeStack.back()] };
+				nodeStack.pop_back();
+
+				const int first{ node.leftFirst };
+				const int count{ node.triangleCount };
+
+				Vector3 minCentroid{ centroids[order[first]] };
+				Vector3 maxCentroid{ minCentroid };
+				node.minAABB = positions[indices[order[first] * 3]];
+				node.maxAABB = node.minAABB;
+				for (int i{ first }; i < first + count; ++i)
+				{
+					for (int corner{}; corner < 3; ++corner)
+					{
+						node.minAABB = Vector3::Min(node.minAABB, positions[indices[order[i] * 3 + corner]]);
+						node.maxAABB = Vector3::Max(node.maxAABB, positions[indices[order[i] * 3 + corner]]);
+					}
+					minCentroid = Vector3::Min(minCentroid, centroids[order[i]]);
+					maxCentroid = Vector3::Max(maxCentroid, centroids[order[i]]);
+				}
+
+				if (count <= maxLeafTriangles)
+					continue;
+
+				const Vector3 extent{ maxCentroid - minCentroid };
+				int axis{ extent.y > extent.x ? 1 : 0 };
+				if (extent.z > extent[axis])
+					axis = 2;
+				if (extent[axis] <= 0.f)
+					continue;
+
+				const int middle{ first + count / 2 };
+				std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + first + count,
+					[&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+				const int leftIndex{ static_cast<int>(bvhNodes.size()) };
+				node.leftFirst = leftIndex;
+				node.triangleCount = 0;
+				bvhNodes.push_back({ {}, first, {}, middle - first });
+				bvhNodes.push_back({ {}, middle, {}, first + count - middle });
+				nodeStack.push_back(leftIndex + 1);
+				nodeStack.push_back(leftIndex);
+			}
+
+			std::vector<int> sortedIndices(indices.size());
+			std::vector<Vector3> sortedNormals(normals.size());
+			for (int i{}; i < triangleCount; ++i)
+			{
+				for (int corner{}; corner < 3; ++corner)
+					sortedIndices[i * 3 + corner] = indices[order[i] * 3 + corner];
+				if (!normals.empty())
+					sortedNormals[i] = normals[order[i]];
+			}
+			indices.swap(sortedIndices);
+			normals.swap(sortedNormals);
+		}
+
+		/**
+		 * \brief Welds bitwise identical positions, drops zero-area triangles and sorts triangles along a Morton curve
+		 * Vertices are renumbered in first use order so neighbouring triangles share cache lines
+		 * Invalidates the hierarchy and transformed data, call before BuildBVH
+		 * \return vertex, triangle and memory counts before and after
+		 */
+		MeshOptimizationStats Optimize()
+		{
+			MeshOptimizationStats stats{};
+			stats.vertexCountBefore = positions.size();
+			stats.triangleCountBefore = indices.size() / 3;
+			stats.bytesBefore = GetMemoryUsage();
+
+			const bool hasNormals{ normals.size() == indices.size() / 3 };
+
+			//Weld, adding 0 turns -0 into +0 so both land in the same bucket
+			struct PositionHash
+			{
+				size_t operator()(const Vector3& p) const
+				{
+					uint32_t bits[3]{};
+					std::memcpy(bits, &p, sizeof(bits));
+					return size_t(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+				}
+			};
+			struct PositionEqual
+			{
+				bool operator()(const Vector3& a, const Vector3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+			};
+
+			std::unordered_map<Vector3, int, PositionHash, PositionEqual> uniquePositions{};
+			uniquePositions.reserve(positions.size());
+			std::vector<int> remap(positions.size());
+			std::vector<Vector3> weldedPositions{};
+			weldedPositions.reserve(positions.size());
+			for (size_t i{}; i < positions.size(); ++i)
+			{
+				const Vector3 position{ positions[i].x + 0.f, positions[i].y + 0.f, positions[i].z + 0.f };
+				const auto result{ uniquePositions.try_emplace(position, static_cast<int>(weldedPositions.size())) };
+				if (result.second)
+					weldedPositions.push_back(position);
+				remap[i] = result.first->second;
+			}
+
+			//Drop triangles without area, they can never be hit
+			std::vector<std::pair<uint32_t, int>> triangles{};
+			triangles.reserve(indices.size() / 3);
+			for (int triangle{}; triangle < static_cast<int>(indices.size() / 3); ++triangle)
+			{
+				const int i0{ remap[indices[triangle * 3]] };
+				const int i1{ remap[indices[triangle * 3 + 1]] };
+				const int i2{ remap[indices[triangle * 3 + 2]] };
+				if (i0 == i1 || i1 == i2 || i2 == i0)
+					continue;
+				const Vector3 cross{ Vector3::Cross(weldedPositions[i1] - weldedPositions[i0], weldedPositions[i2] - weldedPositions[i0]) };
+				if (cross.SqrMagnitude() <= 0.f)
+					continue;
+				triangles.emplace_back(0u, triangle);
+			}
+
+			//Morton code of the centroid, 10 bits per axis inside the mesh bounds
+			if (!weldedPositions.empty())
+			{
+				Vector3 minPosition{ weldedPositions[0] };
+				Vector3 maxPosition{ weldedPositions[0] };
+				for (const Vector3& p : weldedPositions)
+				{
+					minPosition = Vector3::Min(minPosition, p);
+					maxPosition = Vector3::Max(maxPosition, p);
+				}
+				const Vector3 extent{ maxPosition - minPosition };
+
+				const auto expandBits = [](uint32_t value)
+				{
+					value = (value | (value << 16)) & 0x030000FFu;
+					value = (value | (value << 8)) & 0x0300F00Fu;
+					value = (value | (value << 4)) & 0x030C30C3u;
+					value = (value | (value << 2)) & 0x09249249u;
+					return value;
+				};
+				const auto quantize = [](float value, float minValue, float range)
+				{
+					const float normalized{ range > 0.f ? (value - minValue) / range : 0.f };
+					return static_cast<uint32_t>(std::clamp(normalized * 1023.f, 0.f, 1023.f));
+				};
+
+				for (std::pair<uint32_t, int>& triangle : triangles)
+				{
+					const Vector3 centroid{ (weldedPositions[remap[indices[triangle.second * 3]]] +
+						weldedPositions[remap[indices[triangle.second * 3 + 1]]] +
+						weldedPositions[remap[indices[triangle.second * 3 + 2]]]) / 3.f };
+					triangle.first = expandBits(quantize(centroid.x, minPosition.x, extent.x)) << 2 |
+						expandBits(quantize(centroid.y, minPosition.y, extent.y)) << 1 |
+						expandBits(quantize(centroid.z, minPosition.z, extent.z));
+				}
+				std::sort(triangles.begin(), triangles.end());
+			}
+
+			std::vector<int> newVertexIndex(weldedPositions.size(), -1);
+			std::vector<Vector3> sortedPositions{};
+			std::vector<Vector3> sortedNormals{};
+			std::vector<int> sortedIndices{};
+			sortedPositions.reserve(weldedPositions.size());
+			sortedNormals.reserve(triangles.size());
+			sortedIndices.reserve(triangles.size() * 3);
+			for (const std::pair<uint32_t, int>& triangle : triangles)
+			{
+				for (int corner{}; corner < 3; ++corner)
+				{
+					const int vertex{ remap[indices[triangle.second * 3 + corner]] };
+					if (newVertexIndex[vertex] < 0)
+					{
+						newVertexIndex[vertex] = static_cast<int>(sortedPositions.size());
+						sortedPositions.push_back(weldedPositions[vertex]);
+					}
+					sortedIndices.push_back(newVertexIndex[vertex]);
+				}
+
+				if (hasNormals)
+					sortedNormals.push_back(normals[triangle.second]);
+			}
+
+			positions.swap(sortedPositions);
+			indices.swap(sortedIndices);
+			normals.swap(sortedNormals);
+			if (!hasNormals)
+				CalculateNormals();
+
+			//Release the old allocations, the transformed copies are rebuilt by UpdateTransforms
+			positions.shrink_to_fit();
+			indices.shrink_to_fit();
+			normals.shrink_to_fit();
+			std::vector<Vector3>{}.swap(transformedPositions);
+			std::vector<Vector3>{}.swap(transformedNormals);
+			std::vector<BVHNode>{}.swap(bvhNodes);
+			std::vector<BVHNode>{}.swap(transformedBVHNodes);
+
+			stats.vertexCountAfter = positions.size();
+			stats.triangleCountAfter = indices.size() / 3;
+			stats.bytesAfter = GetMemoryUsage();
+			return stats;
+		}
+
+		/**
+		 * \brief Switches to compact storage, hit tests then decode triangles on the fly in object space
+		 * Positions are quantized to 16 bits per axis inside the AABB, face normals are octahedral encoded in 32 bits
+		 * and indices become 16 bit offsets from a per leaf base vertex, leaves spanning more vertices keep 32 bit indices
+		 * Builds the BVH when there is none, the mesh can no longer be edited afterwards
+		 */
+		void Compact()
+		{
+			if (isCompact || indices.empty())
+				return;
+			if (bvhNodes.empty())
+				BuildBVH();
+			UpdateAABB();
+
+			const Vector3 extent{ maxAABB - minAABB };
+			for (int axis{}; axis < 3; ++axis)
+				quantizationStep[axis] = extent[axis] / 65535.f;
+
+			quantizedPositions.resize(positions.size() * 3);
+			for (size_t vertex{}; vertex < positions.size(); ++vertex)
+			{
+				for (int axis{}; axis < 3; ++axis)
+				{
+					const float quantized{ quantizationStep[axis] > 0.f ? std::round((positions[vertex][axis] - minAABB[axis]) / quantizationStep[axis]) : 0.f };
+					quantizedPositions[vertex * 3 + axis] = static_cast<uint16_t>(std::clamp(quantized, 0.f, 65535.f));
+				}
+			}
+
+			packedNormals.resize(normals.size());
+			for (size_t triangle{}; triangle < normals.size(); ++triangle)
+				packedNormals[triangle] = EncodeOctahedral(normals[triangle]);
+
+			//Leaves reference a small, spatially coherent set of vertices, so offsets from the lowest one usually fit 16 bits
+			//A negative base marks a leaf whose indices went to overflowIndices instead, starting at -1 - base
+			leafVertexBases.assign(bvhNodes.size(), 0);
+			compactIndices.resize(indices.size());
+			for (size_t nodeIndex{}; nodeIndex < bvhNodes.size(); ++nodeIndex)
+			{
+				const BVHNode& node{ bvhNodes[nodeIndex] };
+				if (!node.IsLeaf())
+					continue;
+
+				const auto first{ indices.begin() + node.leftFirst * 3 };
+				const auto last{ indices.begin() + (node.leftFirst + node.triangleCount) * 3 };
+				const auto range{ std::minmax_element(first, last) };
+				if (*range.second - *range.first > 65535)
+				{
+					leafVertexBases[nodeIndex] = -1 - static_cast<int>(overflowIndices.size());
+					overflowIndices.insert(overflowIndices.end(), first, last);
+					continue;
+				}
+
+				leafVertexBases[nodeIndex] = *range.first;
+				for (int i{ node.leftFirst * 3 }; i < (node.leftFirst + node.triangleCount) * 3; ++i)
+					compactIndices[i] = static_cast<uint16_t>(indices[i] - *range.first);
+			}
+			std::vector<int>{}.swap(indices);
+
+			//Rounding can move vertices just outside the original bounds, refit the hierarchy to the decoded triangles
+			Triangle triangle{};
+			for (int nodeIndex{ static_cast<int>(bvhNodes.size()) - 1 }; nodeIndex >= 0; --nodeIndex)
+			{
+				BVHNode& node{ bvhNodes[nodeIndex] };
+				if (node.IsLeaf())
+				{
+					GetCompactTriangle(nodeIndex, node.leftFirst, triangle);
+					node.minAABB = triangle.v0;
+					node.maxAABB = triangle.v0;
+					for (int triangleIndex{ node.leftFirst }; triangleIndex < node.leftFirst + node.triangleCount; ++triangleIndex)
+					{
+						GetCompactTriangle(nodeIndex, triangleIndex, triangle);
+						node.minAABB = Vector3::Min(Vector3::Min(node.minAABB, triangle.v0), Vector3::Min(triangle.v1, triangle.v2));
+						node.maxAABB = Vector3::Max(Vector3::Max(node.maxAABB, triangle.v0), Vector3::Max(triangle.v1, triangle.v2));
+					}
+				}
+				else
+				{
+					node.minAABB = Vector3::Min(bvhNodes[node.leftFirst].minAABB, bvhNodes[node.leftFirst + 1].minAABB);
+					node.maxAABB = Vector3::Max(bvhNodes[node.leftFirst].maxAABB, bvhNodes[node.leftFirst + 1].maxAABB);
+				}
+			}
+
+			std::vector<Vector3>{}.swap(positions);
+			std::vector<Vector3>{}.swap(normals);
+			std::vector<Vector3>{}.swap(transformedPositions);
+			std::vector<Vector3>{}.swap(transformedNormals);
+			std::vector<BVHNode>{}.swap(transformedBVHNodes);
+			isCompact = true;
+
+			UpdateTransforms();
+		}
+
+		//Decodes a triangle of a compact mesh in object space, nodeIndex is the leaf containing it
+		void GetCompactTriangle(int nodeIndex, int triangleIndex, Triangle& triangle) const
+		{
+			const int vertexBase{ leafVertexBases[nodeIndex] };
+			const int firstIndex{ bvhNodes[nodeIndex].leftFirst * 3 };
+			auto decodePosition = [&](int corner)
+			{
+				const int i{ triangleIndex * 3 + corner };
+				const int vertex{ vertexBase >= 0 ? vertexBase + compactIndices[i] : overflowIndices[-1 - vertexBase + i - firstIndex] };
+				const uint16_t* pQuantized{ &quantizedPositions[size_t(vertex) * 3] };
+				return Vector3{ minAABB.x + pQuantized[0] * quantizationStep.x, minAABB.y + pQuantized[1] * quantizationStep.y, minAABB.z + pQuantized[2] * quantizationStep.z };
+			};
+
+			triangle.v0 = decodePosition(0);
+			triangle.v1 = decodePosition(1);
+			triangle.v2 = decodePosition(2);
+			triangle.normal = DecodeOctahedral(packedNormals[triangleIndex]);
+		}
+
+		//Unit vector folded onto an octahedron, two 16 bit snorm components, zero vectors get a code no normal produces
+		static uint32_t EncodeOctahedral(const Vector3& normal)
+		{
+			const float length{ std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z) };
+			if (length <= 0.f)
+				return 0x80008000u;
+
+			float x{ normal.x / length };
+			float y{ normal.y / length };
+			if (normal.z < 0.f)
+			{
+				const float foldedX{ (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f) };
+				y = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+				x = foldedX;
+			}
+
+			const int16_t encodedX{ static_cast<int16_t>(std::round(std::clamp(x, -1.f, 1.f) * 32767.f)) };
+			const int16_t encodedY{ static_cast<int16_t>(std::round(std::clamp(y, -1.f, 1.f) * 32767.f)) };
+			return uint32_t(uint16_t(encodedX)) | uint32_t(uint16_t(encodedY)) << 16;
+		}
+
+		static Vector3 DecodeOctahedral(uint32_t packedNormal)
+		{
+			if (packedNormal == 0x80008000u)
+				return Vector3::Zero;
+
+			Vector3 normal{ int16_t(packedNormal & 0xFFFF) / 32767.f, int16_t(packedNormal >> 16) / 32767.f, 0.f };
+			normal.z = 1.f - std::abs(normal.x) - std::abs(normal.y);
+			const float fold{ std::max(-normal.z, 0.f) };
+			normal.x += normal.x >= 0.f ? -fold : fold;
+			normal.y += normal.y >= 0.f ? -fold : fold;
+			return normal.Normalized();
+		}
+
+		//Bytes held by the geometry, hierarchy and transformed copies
+		size_t GetMemoryUsage() const
+		{
+			return (positions.capacity() + normals.capacity() + transformedPositions.capacity() + transformedNormals.capacity()) * sizeof(Vector3) +
+				indices.capacity() * sizeof(int) +
+				(bvhNodes.capacity() + transformedBVHNodes.capacity()) * sizeof(BVHNode) +
+				(quantizedPositions.capacity() + compactIndices.capacity()) * sizeof(uint16_t) +
+				packedNormals.capacity() * sizeof(uint32_t) + (overflowIndices.capacity() + leafVertexBases.capacity()) * sizeof(int);
+		}
+
+		//Recomputes the bounds of the transformed hierarchy, children are always stored after their parent
+		void RefitBVH()
+		{
+			transformedBVHNodes.resize(bvhNodes.size());
+			for (int nodeIndex{ static_cast<int>(bvhNodes.size()) - 1 }; nodeIndex >= 0; --nodeIndex)
+			{
+				const BVHNode& sourceNode{ bvhNodes[nodeIndex] };
+				BVHNode& node{ transformedBVHNodes[nodeIndex] };
+				node.leftFirst = sourceNode.leftFirst;
+				node.triangleCount = sourceNode.triangleCount;
+
+				if (node.IsLeaf())
+				{
+					node.minAABB = transformedPositions[indices[node.leftFirst * 3]];
+					node.maxAABB = node.minAABB;
+					for (int i{ node.leftFirst * 3 }; i < (node.leftFirst + node.triangleCount) * 3; ++i)
+					{
+						node.minAABB = Vector3::Min(node.minAABB, transformedPositions[indices[i]]);
+						node.maxAABB = Vector3::Max(node.maxAABB, transformedPositions[indices[i]]);
+					}
+				}
+				else
+				{
+					const BVHNode& left{ transformedBVHNodes[node.leftFirst] };
+					const BVHNode& right{ transformedBVHNodes[node.leftFirst + 1] };
+					node.minAABB = Vector3::Min(left.minAABB, right.minAABB);
+					node.maxAABB = Vector3::Max(left.maxAABB, right.maxAABB);
+				}
+			}
 		}
 
 		void UpdateAABB()
@@ -244,5 +757,42 @@ namespace dae
 		bool didHit{ false };
 		unsigned char materialIndex{ 0 };
 	};
+
+	//Weighted reservoir holding a single light sample (ReSTIR)
+	struct Reservoir
+	{
+		int lightIndex{ -1 };
+		float weightSum{};
+		float sampleCount{};
+		float targetPdf{};
+		float contributionWeight{};
+
+		bool Update(int candidateIndex, float weight, float candidateTargetPdf, float random)
+		{
+			weightSum += weight;
+			++sampleCount;
+			if (weight > 0.f && random * weightSum < weight)
+			{
+				lightIndex = candidateIndex;
+				targetPdf = candidateTargetPdf;
+				return true;
+			}
+			return false;
+		}
+
+		//otherTargetPdf is the target pdf of other's sample evaluated at this reservoir's pixel
+		bool Merge(const Reservoir& other, float otherTargetPdf, float random)
+		{
+			const float currentCount{ sampleCount };
+			const bool selected{ Update(other.lightIndex, otherTargetPdf * other.contributionWeight * other.sampleCount, otherTargetPdf, random) };
+			sampleCount = currentCount + other.sampleCount;
+			return selected;
+		}
+
+		void FinalizeWeight()
+		{
+			contributionWeight = (targetPdf > 0.f && sampleCount > 0.f) ? weightSum / (sampleCount * targetPdf) : 0.f;
+		}
+	};
 #pragma endregion
 }
\ No newline at end of file
@@ -0,0 +1,358 @@
+#include "Denoiser.h"
+#include "HardwareCounters.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DENOISER_SSE
+#endif
+
+using namespace dae;
+
+constexpr int DENOISER_TILE_SIZE{ 32 };
+
+//B3 spline, the 5x5 kernel is the outer product of these weights
+constexpr float KERNEL_WEIGHTS[5]{ 1.f / 16.f, 1.f / 4.f, 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+
+#if defined(DENOISER_SSE)
+namespace
+{
+	//Cephes expf: range reduction by ln(2) and a degree 5 polynomial, within a few ulp of expf
+	__m128 Exp(__m128 x)
+	{
+		x = _mm_max_ps(_mm_min_ps(x, _mm_set1_ps(88.f)), _mm_set1_ps(-87.f));
+		const __m128i exponent{ _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504f))) };
+		const __m128 exponentFloat{ _mm_cvtepi32_ps(exponent) };
+		x = _mm_sub_ps(x, _mm_mul_ps(exponentFloat, _mm_set1_ps(0.693359375f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(exponentFloat, _mm_set1_ps(-2.12194440e-4f)));
+
+		__m128 polynomial{ _mm_set1_ps(1.9875691500e-4f) };
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(1.3981999507e-3f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(8.3334519073e-3f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(4.1665795894e-2f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(1.6666665459e-1f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(5.0000001201e-1f));
+		polynomial = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(polynomial, x), x), x), _mm_set1_ps(1.f));
+
+		//2^exponent built in the exponent bits, the clamp above keeps it a normal float
+		const __m128 scale{ _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(127)), 23)) };
+		return _mm_mul_ps(polynomial, scale);
+	}
+
+	__m128 Abs(__m128 x)
+	{
+		return _mm_andnot_ps(_mm_set1_ps(-0.f), x);
+	}
+
+	__m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+}
+#endif
+
+Denoiser::Denoiser(int width, int height) :
+	m_Width(width),
+	m_Height(height)
+{
+	const uint32_t amountOfPixels{ uint32_t(m_Width * m_Height) };
+	m_Guides.resize(amountOfPixels);
+	m_MaterialIds.resize(amountOfPixels);
+	m_LuminanceDeviation.resize(amountOfPixels);
+	m_Input.resize(amountOfPixels);
+	m_Output.resize(amountOfPixels);
+
+	const uint32_t tilesX{ uint32_t((m_Width + DENOISER_TILE_SIZE - 1) / DENOISER_TILE_SIZE) };
+	const uint32_t tilesY{ uint32_t((m_Height + DENOISER_TILE_SIZE - 1) / DENOISER_TILE_SIZE) };
+	m_TileIndices.reserve(tilesX * tilesY);
+	for (uint32_t index{}; index < tilesX * tilesY; ++index) m_TileIndices.emplace_back(index);
+}
+
+void Denoiser::Apply(const std::vector<HitRecord>& gBuffer, std::vector<ColorRGB>& colorBuffer)
+{
+	const auto startTime{ std::chrono::steady_clock::now() };
+	auto elapsedMs = [&startTime]()
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	};
+
+	PrepareGuides(gBuffer, colorBuffer);
+
+	m_LastIterationCount = 0;
+	float previousElapsed{ elapsedMs() };
+	float iterationDuration{};
+	while (m_LastIterationCount < m_MaxIterations)
+	{
+		//Always filter once, afterwards only start an iteration that is expected to fit the budget
+		if (m_LastIterationCount > 0 && previousElapsed + iterationDuration > m_BudgetMs)
+			break;
+
+		const int stepSize{ 1 << m_LastIterationCount };
+		ForEachTile([&](uint32_t tileIndex) {
+			FilterTile(tileIndex, stepSize);
+			});
+		std::swap(m_Input, m_Output);
+		++m_LastIterationCount;
+
+		const float currentElapsed{ elapsedMs() };
+		iterationDuration = currentElapsed - previousElapsed;
+		previousElapsed = currentElapsed;
+	}
+
+	ForEachTile([&](uint32_t tileIndex) {
+		const HardwareCounterScope hardwareCounterScope{ RenderStage::Denoising };
+		const TileBounds bounds{ GetTileBounds(tileIndex) };
+		for (int py{ bounds.startY }; py < bounds.endY; ++py)
+		{
+			for (int pixelIndex{ bounds.startX + py * m_Width }; pixelIndex < bounds.endX + py * m_Width; ++pixelIndex)
+			{
+				const Color4& color{ m_Input[pixelIndex] };
+				colorBuffer[pixelIndex] = { color.r, color.g, color.b };
+			}
+		}
+		});
+
+	m_LastDurationMs = elapsedMs();
+}
+
+template<typename Function>
+void Denoiser::ForEachTile(const Function& function)
+{
+	if (!m_pThreadPool)
+	{
+		std::for_each(m_TileIndices.begin(), m_TileIndices.end(), function);
+		return;
+	}
+	m_pThreadPool->ParallelFor(uint32_t(m_TileIndices.size()), [&](uint32_t index) { function(m_TileIndices[index]); });
+}
+
+Denoiser::TileBounds Denoiser::GetTileBounds(uint32_t tileIndex) const
+{
+	const int tilesX{ (m_Width + DENOISER_TILE_SIZE - 1) / DENOISER_TILE_SIZE };
+	const int startX{ int(tileIndex) % tilesX * DENOISER_TILE_SIZE }, startY{ int(tileIndex) / tilesX * DENOISER_TILE_SIZE };
+	return { startX, startY, std::min(startX + DENOISER_TILE_SIZE, m_Width), std::min(startY + DENOISER_TILE_SIZE, m_Height) };
+}
+
+void Denoiser::PrepareGuides(const std::vector<HitRecord>& gBuffer, const std::vector<ColorRGB>& colorBuffer)
+{
+	//Every guide has to be written before the deviation reads the neighbouring tiles
+	ForEachTile([&](uint32_t tileIndex) {
+		const HardwareCounterScope hardwareCounterScope{ RenderStage::Denoising };
+		const TileBounds bounds{ GetTileBounds(tileIndex) };
+		for (int py{ bounds.startY }; py < bounds.endY; ++py)
+		{
+			for (int pixelIndex{ bounds.startX + py * m_Width }; pixelIndex < bounds.endX + py * m_Width; ++pixelIndex)
+			{
+				const HitRecord& hitRecord{ gBuffer[pixelIndex] };
+				const ColorRGB& color{ colorBuffer[pixelIndex] };
+
+				m_Guides[pixelIndex] = { hitRecord.normal, hitRecord.t };
+				m_MaterialIds[pixelIndex] = hitRecord.didHit ? int(hitRecord.materialIndex) : -1;
+				m_Input[pixelIndex] = { color.r, color.g, color.b, color.Luminance() };
+			}
+		}
+		});
+
+	//Local luminance deviation (3x3) scales the luminance edge stopping, so noise gets filtered and edges don't
+	auto calculateDeviation = [&](uint32_t tileIndex) {
+		const HardwareCounterScope hardwareCounterScope{ RenderStage::Denoising };
+		const TileBounds bounds{ GetTileBounds(tileIndex) };
+		for (int py{ bounds.startY }; py < bounds.endY; ++py)
+		{
+			for (int px{ bounds.startX }; px < bounds.endX; ++px)
+			{
+				float sum{}, sumSquared{}, count{};
+				for (int y{ std::max(py - 1, 0) }; y <= std::min(py + 1, m_Height - 1); ++y)
+				{
+					for (int x{ std::max(px - 1, 0) }; x <= std::min(px + 1, m_Width - 1); ++x)
+					{
+						const float luminance{ m_Input[x + y * m_Width].a };
+						sum += luminance;
+						sumSquared += luminance * luminance;
+						++count;
+					}
+				}
+				const float mean{ sum / count };
+				m_LuminanceDeviation[px + py * m_Width] = sqrtf(std::max(0.f, sumSquared / count - mean * mean));
+			}
+		}
+	};
+
+	ForEachTile(calculateDeviation);
+}
+
+void Denoiser::FilterTile(uint32_t tileIndex, int stepSize)
+{
+	const HardwareCounterScope hardwareCounterScope{ RenderStage::Denoising };
+	const TileBounds bounds{ GetTileBounds(tileIndex) };
+	for (int py{ bounds.startY }; py < bounds.endY; ++py)
+	{
+		int px{ bounds.startX };
+#if defined(DENOISER_SSE)
+		for (; px + 4 <= bounds.endX; px += 4)
+			FilterFourPixels(px, py, stepSize);
+#endif
+		for (; px < bounds.endX; ++px)
+			FilterPixel(px, py, stepSize);
+	}
+}
+
+void Denoiser::FilterPixel(int px, int py, int stepSize)
+{
+	const int pixelIndex{ px + py * m_Width };
+	const Color4& center{ m_Input[pixelIndex] };
+	const int materialId{ m_MaterialIds[pixelIndex] };
+
+	//Background pixels have nothing to guide the filter
+	if (materialId < 0)
+	{
+		m_Output[pixelIndex] = center;
+		return;
+	}
+
+	const Guide& centerGuide{ m_Guides[pixelIndex] };
+	//Reciprocals, the kernel loop only multiplies
+	const float luminanceScale{ 1.f / (m_LuminanceSigma * m_LuminanceDeviation[pixelIndex] + 1e-4f) };
+	const float depthScale{ 1.f / (m_DepthSigma * centerGuide.depth * stepSize) };
+
+	Color4 colorSum{};
+	float weightSum{};
+	for (int ky{ -2 }; ky <= 2; ++ky)
+	{
+		const int y{ py + ky * stepSize };
+		if (y < 0 || y >= m_Height)
+			continue;
+
+		for (int kx{ -2 }; kx <= 2; ++kx)
+		{
+			const int x{ px + kx * stepSize };
+			if (x < 0 || x >= m_Width)
+				continue;
+
+			const int sampleIndex{ x + y * m_Width };
+			if (m_MaterialIds[sampleIndex] != materialId)
+				continue;
+
+			const Guide& sampleGuide{ m_Guides[sampleIndex] };
+			const Color4& sample{ m_Input[sampleIndex] };
+
+			float normalWeight{ std::max(0.f, Vector3::Dot(centerGuide.normal, sampleGuide.normal)) };
+			for (int squaring{}; squaring < m_NormalPowerLog2; ++squaring)
+				normalWeight *= normalWeight;
+			const float exponent{ std::abs(center.a - sample.a) * luminanceScale + std::abs(centerGuide.depth - sampleGuide.depth) * depthScale };
+			const float weight{ KERNEL_WEIGHTS[kx + 2] * KERNEL_WEIGHTS[ky + 2] * normalWeight * expf(-exponent) };
+
+			colorSum.r += sample.r * weight;
+			colorSum.g += sample.g * weight;
+			colorSum.b += sample.b * weight;
+			colorSum.a += sample.a * weight;
+			weightSum += weight;
+		}
+	}
+
+	//The center sample always contributes, so weightSum is never zero
+	m_Output[pixelIndex] = { colorSum.r / weightSum, colorSum.g / weightSum, colorSum.b / weightSum, colorSum.a / weightSum };
+}
+
+#if defined(DENOISER_SSE)
+void Denoiser::FilterFourPixels(int px, int py, int stepSize)
+{
+	//One lane per pixel, the guides and colors are transposed so every register holds one channel of the four pixels
+	const int pixelIndex{ px + py * m_Width };
+	const __m128i materialIds{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_MaterialIds[pixelIndex])) };
+
+	__m128 centerR{ _mm_load_ps(&m_Input[pixelIndex].r) }, centerG{ _mm_load_ps(&m_Input[pixelIndex + 1].r) };
+	__m128 centerB{ _mm_load_ps(&m_Input[pixelIndex + 2].r) }, centerA{ _mm_load_ps(&m_Input[pixelIndex + 3].r) };
+	_MM_TRANSPOSE4_PS(centerR, centerG, centerB, centerA);
+	__m128 centerX{ _mm_load_ps(&m_Guides[pixelIndex].normal.x) }, centerY{ _mm_load_ps(&m_Guides[pixelIndex + 1].normal.x) };
+	__m128 centerZ{ _mm_load_ps(&m_Guides[pixelIndex + 2].normal.x) }, centerDepth{ _mm_load_ps(&m_Guides[pixelIndex + 3].normal.x) };
+	_MM_TRANSPOSE4_PS(centerX, centerY, centerZ, centerDepth);
+
+	const __m128 one{ _mm_set1_ps(1.f) };
+	const __m128 luminanceSigma{ _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m_LuminanceSigma), _mm_loadu_ps(&m_LuminanceDeviation[pixelIndex])), _mm_set1_ps(1e-4f)) };
+	const __m128 luminanceScale{ _mm_div_ps(one, luminanceSigma) };
+	const __m128 depthScale{ _mm_div_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(m_DepthSigma), centerDepth), _mm_set1_ps(float(stepSize)))) };
+
+	__m128 sumR{ _mm_setzero_ps() }, sumG{ _mm_setzero_ps() }, sumB{ _mm_setzero_ps() }, sumA{ _mm_setzero_ps() };
+	__m128 weightSum{ _mm_setzero_ps() };
+	for (int ky{ -2 }; ky <= 2; ++ky)
+	{
+		const int y{ py + ky * stepSize };
+		if (y < 0 || y >= m_Height)
+			continue;
+
+		for (int kx{ -2 }; kx <= 2; ++kx)
+		{
+			const int x{ px + kx * stepSize };
+			if (x + 3 < 0 || x >= m_Width)
+				continue;
+
+			//At the image border the lanes outside are gathered as samples of no material
+			const Guide* pGuides{ &m_Guides[0] };
+			const Color4* pColors{ &m_Input[0] };
+			__m128i sampleIds{};
+			int sampleIndex{ x + y * m_Width };
+			Guide borderGuides[4]{};
+			Color4 borderColors[4]{};
+			if (x >= 0 && x + 3 < m_Width)
+				sampleIds = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_MaterialIds[sampleIndex]));
+			else
+			{
+				alignas(16) int borderIds[4]{ -2, -2, -2, -2 };
+				for (int lane{ std::max(0, -x) }; lane < std::min(4, m_Width - x); ++lane)
+				{
+					borderIds[lane] = m_MaterialIds[sampleIndex + lane];
+					borderGuides[lane] = m_Guides[sampleIndex + lane];
+					borderColors[lane] = m_Input[sampleIndex + lane];
+				}
+				sampleIds = _mm_load_si128(reinterpret_cast<const __m128i*>(borderIds));
+				pGuides = borderGuides;
+				pColors = borderColors;
+				sampleIndex = 0;
+			}
+
+			const __m128 materialMask{ _mm_castsi128_ps(_mm_cmpeq_epi32(sampleIds, materialIds)) };
+			if (_mm_movemask_ps(materialMask) == 0)
+				continue;
+
+			__m128 sampleX{ _mm_load_ps(&pGuides[sampleIndex].normal.x) }, sampleY{ _mm_load_ps(&pGuides[sampleIndex + 1].normal.x) };
+			__m128 sampleZ{ _mm_load_ps(&pGuides[sampleIndex + 2].normal.x) }, sampleDepth{ _mm_load_ps(&pGuides[sampleIndex + 3].normal.x) };
+			_MM_TRANSPOSE4_PS(sampleX, sampleY, sampleZ, sampleDepth);
+			__m128 sampleR{ _mm_load_ps(&pColors[sampleIndex].r) }, sampleG{ _mm_load_ps(&pColors[sampleIndex + 1].r) };
+			__m128 sampleB{ _mm_load_ps(&pColors[sampleIndex + 2].r) }, sampleA{ _mm_load_ps(&pColors[sampleIndex + 3].r) };
+			_MM_TRANSPOSE4_PS(sampleR, sampleG, sampleB, sampleA);
+
+			const __m128 dot{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, sampleX), _mm_mul_ps(centerY, sampleY)), _mm_mul_ps(centerZ, sampleZ)) };
+			__m128 normalWeight{ _mm_max_ps(dot, _mm_setzero_ps()) };
+			for (int squaring{}; squaring < m_NormalPowerLog2; ++squaring)
+				normalWeight = _mm_mul_ps(normalWeight, normalWeight);
+			const __m128 exponent{ _mm_add_ps(_mm_mul_ps(Abs(_mm_sub_ps(centerA, sampleA)), luminanceScale),
+				_mm_mul_ps(Abs(_mm_sub_ps(centerDepth, sampleDepth)), depthScale)) };
+			__m128 weight{ _mm_mul_ps(_mm_set1_ps(KERNEL_WEIGHTS[kx + 2] * KERNEL_WEIGHTS[ky + 2]), normalWeight) };
+			weight = _mm_and_ps(materialMask, _mm_mul_ps(weight, Exp(_mm_sub_ps(_mm_setzero_ps(), exponent))));
+
+			sumR = _mm_add_ps(sumR, _mm_mul_ps(sampleR, weight));
+			sumG = _mm_add_ps(sumG, _mm_mul_ps(sampleG, weight));
+			sumB = _mm_add_ps(sumB, _mm_mul_ps(sampleB, weight));
+			sumA = _mm_add_ps(sumA, _mm_mul_ps(sampleA, weight));
+			weightSum = _mm_add_ps(weightSum, weight);
+		}
+	}
+
+	//Background lanes keep their center, the division by their zero weight is discarded
+	const __m128 backgroundMask{ _mm_castsi128_ps(_mm_cmplt_epi32(materialIds, _mm_setzero_si128())) };
+	sumR = Select(backgroundMask, centerR, _mm_div_ps(sumR, weightSum));
+	sumG = Select(backgroundMask, centerG, _mm_div_ps(sumG, weightSum));
+	sumB = Select(backgroundMask, centerB, _mm_div_ps(sumB, weightSum));
+	sumA = Select(backgroundMask, centerA, _mm_div_ps(sumA, weightSum));
+	_MM_TRANSPOSE4_PS(sumR, sumG, sumB, sumA);
+	_mm_store_ps(&m_Output[pixelIndex].r, sumR);
+	_mm_store_ps(&m_Output[pixelIndex + 1].r, sumG);
+	_mm_store_ps(&m_Output[pixelIndex + 2].r, sumB);
+	_mm_store_ps(&m_Output[pixelIndex + 3].r, sumA);
+}
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	//Edge-aware a-trous wavelet filter guided by the normals, depth and material ids of the G-buffer
+	class Denoiser final
+	{
+	public:
+		Denoiser(int width, int height);
+		~Denoiser() = default;
+
+		Denoiser(const Denoiser&) = delete;
+		Denoiser(Denoiser&&) noexcept = delete;
+		Denoiser& operator=(const Denoiser&) = delete;
+		Denoiser& operator=(Denoiser&&) noexcept = delete;
+
+		/**
+		 * \brief Filters the color buffer in place, iterations stop early when the next one would exceed the budget
+		 * \param gBuffer primary hits, one per pixel
+		 * \param colorBuffer linear colors, one per pixel
+		 */
+		void Apply(const std::vector<HitRecord>& gBuffer, std::vector<ColorRGB>& colorBuffer);
+
+		//Tiles are spread over the calling thread and the pool, nullptr filters on the calling thread only
+		void SetThreadPool(ThreadPool* pThreadPool) { m_pThreadPool = pThreadPool; };
+		void SetBudget(float milliseconds) { m_BudgetMs = milliseconds; };
+		void SetMaxIterations(int iterations) { m_MaxIterations = iterations; };
+		float GetLastDuration() const { return m_LastDurationMs; };
+		int GetLastIterationCount() const { return m_LastIterationCount; };
+
+	private:
+		struct alignas(16) Color4
+		{
+			float r{}, g{}, b{}, a{};
+		};
+
+		struct alignas(16) Guide
+		{
+			Vector3 normal{};
+			float depth{};
+		};
+
+		//Pixel range of a tile, the end is exclusive
+		struct TileBounds
+		{
+			int startX{}, startY{}, endX{}, endY{};
+		};
+
+		int m_Width{};
+		int m_Height{};
+		ThreadPool* m_pThreadPool{ nullptr };
+
+		float m_BudgetMs{ 8.f };
+		int m_MaxIterations{ 5 };
+		float m_LastDurationMs{};
+		int m_LastIterationCount{};
+
+		//Edge stopping parameters, the normal weight is the dot product to the power 2^m_NormalPowerLog2 (128)
+		int m_NormalPowerLog2{ 7 };
+		float m_DepthSigma{ 0.05f };
+		float m_LuminanceSigma{ 4.f };
+
+		std::vector<uint32_t> m_TileIndices{};
+		std::vector<Guide> m_Guides{};
+		std::vector<int> m_MaterialIds{};
+		std::vector<float> m_LuminanceDeviation{};
+		std::vector<Color4> m_Input{};
+		std::vector<Color4> m_Output{};
+
+		template<typename Function>
+		void ForEachTile(const Function& function);
+		void PrepareGuides(const std::vector<HitRecord>& gBuffer, const std::vector<ColorRGB>& colorBuffer);
+		TileBounds GetTileBounds(uint32_t tileIndex) const;
+		void FilterTile(uint32_t tileIndex, int stepSize);
+		void FilterPixel(int px, int py, int stepSize);
+		//Filters px up to px + 3 at once, only built with SSE
+		void FilterFourPixels(int px, int py, int stepSize);
+	};
+}
@@ -0,0 +1,185 @@
+#include "FrameStream.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#endif
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr char Y4M_FRAME_HEADER[]{ "FRAME\n" };
+	constexpr size_t Y4M_FRAME_HEADER_SIZE{ sizeof(Y4M_FRAME_HEADER) - 1 };
+}
+
+FrameStream::FrameStream(const std::string& destination, FrameStreamFormat format, uint32_t width, uint32_t height, uint32_t frameRate, uint32_t ringSize) :
+	m_Format{ format },
+	m_Width{ width },
+	m_Height{ height }
+{
+	if (!Open(destination))
+	{
+		std::cout << "Could not open frame stream " << destination << std::endl;
+		return;
+	}
+
+	const size_t frameSize{ size_t(width) * height * 3 + (format == FrameStreamFormat::Y4M ? Y4M_FRAME_HEADER_SIZE : 0) };
+	m_Slots.resize(std::max(ringSize, 1u));
+	for (std::vector<uint8_t>& slot : m_Slots)
+	{
+		slot.resize(frameSize);
+		if (format == FrameStreamFormat::Y4M)
+			std::copy(Y4M_FRAME_HEADER, Y4M_FRAME_HEADER + Y4M_FRAME_HEADER_SIZE, slot.begin());
+	}
+
+	//8-bit video range BT.601, matching what readers assume when the header has no color range
+	if (format == FrameStreamFormat::Y4M)
+		fprintf(m_pFile, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n", width, height, frameRate);
+
+	m_pThreadPool = new ThreadPool(1);
+}
+
+FrameStream::~FrameStream()
+{
+	{
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_FrameWritten.wait(lock, [this]() { return m_PendingFrameCount == 0; });
+	}
+	delete m_pThreadPool;
+	m_pThreadPool = nullptr;
+
+	if (m_pFile)
+	{
+		if (m_OwnsFile)
+			fclose(m_pFile);
+		else
+			fflush(m_pFile);
+		m_pFile = nullptr;
+	}
+}
+
+bool FrameStream::IsOpen() const
+{
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	return m_pFile && !m_IsBroken;
+}
+
+void FrameStream::Submit(const uint32_t* pPixels, uint32_t pitch, const PixelFormat& pixelFormat)
+{
+	uint32_t slotIndex{};
+	{
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		if (!m_pFile || m_IsBroken)
+			return;
+		m_FrameWritten.wait(lock, [this]() { return m_PendingFrameCount < m_Slots.size(); });
+		++m_PendingFrameCount;
+		slotIndex = m_NextSlot;
+		m_NextSlot = (m_NextSlot + 1) % uint32_t(m_Slots.size());
+	}
+
+	//The writer only touches slots that are pending, so this one is free until it is queued below
+	std::vector<uint8_t>& slot{ m_Slots[slotIndex] };
+	const size_t planeSize{ size_t(m_Width) * m_Height };
+	for (uint32_t y{}; y < m_Height; ++y)
+	{
+		const uint32_t* pRow{ reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(pPixels) + size_t(y) * pitch) };
+		for (uint32_t x{}; x < m_Width; ++x)
+		{
+			const int red{ int((pRow[x] >> pixelFormat.redShift) & 0xFF) };
+			const int green{ int((pRow[x] >> pixelFormat.greenShift) & 0xFF) };
+			const int blue{ int((pRow[x] >> pixelFormat.blueShift) & 0xFF) };
+			const size_t pixelIndex{ size_t(y) * m_Width + x };
+
+			if (m_Format == FrameStreamFormat::RawRGB)
+			{
+				uint8_t* pRGB{ &slot[pixelIndex * 3] };
+				pRGB[0] = uint8_t(red);
+				pRGB[1] = uint8_t(green);
+				pRGB[2] = uint8_t(blue);
+			}
+			else
+			{
+				uint8_t* pPlanes{ &slot[Y4M_FRAME_HEADER_SIZE] };
+				pPlanes[pixelIndex] = uint8_t(((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+				pPlanes[planeSize + pixelIndex] = uint8_t(((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128);
+				pPlanes[2 * planeSize + pixelIndex] = uint8_t(((112 * red - 94 * green - 18 * blue + 128) >> 8) + 128);
+			}
+		}
+	}
+
+	m_pThreadPool->Enqueue([this, slotIndex]() { Write(slotIndex); });
+}
+
+uint64_t FrameStream::GetFrameCount() const
+{
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	return m_FrameCount;
+}
+
+bool FrameStream::Open(const std::string& destination)
+{
+#if !defined(_WIN32)
+	//A reader that exits should end the stream, not the renderer
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	if (destination == "-")
+	{
+#if defined(_WIN32)
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		m_pFile = stdout;
+		m_OwnsFile = false;
+	}
+	else if (destination.rfind("fd:", 0) == 0)
+	{
+		const int fileDescriptor{ std::atoi(destination.c_str() + 3) };
+#if defined(_WIN32)
+		_setmode(fileDescriptor, _O_BINARY);
+		m_pFile = _fdopen(fileDescriptor, "wb");
+#else
+		m_pFile = fdopen(fileDescriptor, "wb");
+#endif
+		m_OwnsFile = true;
+	}
+	else
+	{
+		m_pFile = fopen(destination.c_str(), "wb");
+		m_OwnsFile = true;
+	}
+	return m_pFile != nullptr;
+}
+
+void FrameStream::Write(uint32_t slotIndex)
+{
+	PROFILE_SCOPE("FrameStream::Write");
+	bool isBroken{};
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		isBroken = m_IsBroken;
+	}
+
+	const std::vector<uint8_t>& slot{ m_Slots[slotIndex] };
+	const bool isWritten{ !isBroken && fwrite(slot.data(), 1, slot.size(), m_pFile) == slot.size() && fflush(m_pFile) == 0 };
+	if (!isWritten && !isBroken)
+		std::cout << "Frame stream closed after " << m_FrameCount << " frames" << std::endl;
+
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		if (isWritten)
+			++m_FrameCount;
+		m_IsBroken = m_IsBroken || !isWritten;
+		--m_PendingFrameCount;
+	}
+	m_FrameWritten.notify_all();
+}
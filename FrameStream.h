@@ -0,0 +1,73 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ToneMapper.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	enum class FrameStreamFormat
+	{
+		//Interleaved 8-bit RGB without any header (ffmpeg -f rawvideo -pixel_format rgb24 -video_size WxH)
+		RawRGB,
+		//YUV4MPEG2, planar 4:4:4 BT.601 with a stream header, ffmpeg and most players read it without extra options
+		Y4M
+	};
+
+	//Streams every submitted frame to a file, pipe or inherited file descriptor for an external encoder.
+	//Frames are converted straight into a ring of pre-allocated slots and written from there on a background thread
+	class FrameStream final
+	{
+	public:
+		/**
+		 * \param destination "-" for stdout, "fd:<n>" for an inherited file descriptor, otherwise a file or named pipe
+		 * \param frameRate only stored in the Y4M header, frames are written as fast as they are rendered
+		 * \param ringSize frames that can be in flight before Submit blocks
+		 */
+		FrameStream(const std::string& destination, FrameStreamFormat format, uint32_t width, uint32_t height, uint32_t frameRate = 30, uint32_t ringSize = 3);
+		~FrameStream();
+
+		FrameStream(const FrameStream&) = delete;
+		FrameStream(FrameStream&&) noexcept = delete;
+		FrameStream& operator=(const FrameStream&) = delete;
+		FrameStream& operator=(FrameStream&&) noexcept = delete;
+
+		//False when the destination could not be opened or the reader went away
+		bool IsOpen() const;
+
+		/**
+		 * \brief Converts a frame into the next ring slot, only blocks while every slot is still being written
+		 * \param pPixels packed pixels, rows are pitch bytes apart
+		 * \param pixelFormat bit layout of the packed pixels
+		 */
+		void Submit(const uint32_t* pPixels, uint32_t pitch, const PixelFormat& pixelFormat);
+
+		uint64_t GetFrameCount() const;
+
+	private:
+		FrameStreamFormat m_Format{};
+		uint32_t m_Width{};
+		uint32_t m_Height{};
+
+		FILE* m_pFile{ nullptr };
+		bool m_OwnsFile{ false };
+		bool m_IsBroken{ false };
+
+		ThreadPool* m_pThreadPool{ nullptr };
+		std::vector<std::vector<uint8_t>> m_Slots{};
+		uint32_t m_NextSlot{};
+		uint32_t m_PendingFrameCount{};
+		uint64_t m_FrameCount{};
+		mutable std::mutex m_Mutex{};
+		std::condition_variable m_FrameWritten{};
+
+		bool Open(const std::string& destination);
+		void Write(uint32_t slotIndex);
+	};
+}
@@ -0,0 +1,338 @@
+#include "HardwareCounters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+namespace
+{
+	constexpr const char* RENDER_STAGE_NAMES[RENDER_STAGE_COUNT]
+	{
+		"tracing", "antiAliasing", "accumulation", "denoising", "present"
+	};
+
+	constexpr const char* HARDWARE_COUNTER_NAMES[HARDWARE_COUNTER_COUNT]
+	{
+		"cycles", "instructions", "l1dMisses", "llcMisses", "branchMisses"
+	};
+
+	//Counter group of one thread, only that thread reads it and adds to its own accumulators
+	struct alignas(64) HardwareThreadCounters
+	{
+		int groupFd{ -1 };
+		std::vector<int> fds{};
+		//Counter of every value a group read returns, in the order they were opened
+		std::vector<HardwareCounter> readOrder{};
+		std::atomic<uint64_t> counts[RENDER_STAGE_COUNT][HARDWARE_COUNTER_COUNT]{};
+	};
+
+	//Thread blocks stay registered after their thread exits, so the totals never go back
+	struct HardwareCountersRegistry
+	{
+		~HardwareCountersRegistry();
+
+		std::mutex mutex{};
+		std::vector<HardwareThreadCounters*> threadCounters{};
+		HardwareStats collectedTotals{};
+		std::atomic<bool> isEnabled{};
+		//Counters the first thread could open, the others are printed as unavailable
+		bool isSupported[HARDWARE_COUNTER_COUNT]{};
+	};
+
+	HardwareCountersRegistry& GetRegistry()
+	{
+		static HardwareCountersRegistry registry{};
+		return registry;
+	}
+
+#if defined(__linux__)
+	int OpenCounter(HardwareCounter counter, int groupFd)
+	{
+		perf_event_attr attribute{};
+		attribute.size = sizeof(perf_event_attr);
+		attribute.type = PERF_TYPE_HARDWARE;
+		switch (counter)
+		{
+		case HardwareCounter::Cycles:
+			attribute.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case HardwareCounter::Instructions:
+			attribute.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case HardwareCounter::L1DataMisses:
+			attribute.type = PERF_TYPE_HW_CACHE;
+			attribute.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		case HardwareCounter::LastLevelCacheMisses:
+			attribute.config = PERF_COUNT_HW_CACHE_MISSES;
+			break;
+		case HardwareCounter::BranchMisses:
+			attribute.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		default:
+			return -1;
+		}
+
+		//The leader starts disabled so the whole group is switched on at once, user space only keeps paranoid level 2 working
+		attribute.disabled = groupFd < 0 ? 1 : 0;
+		attribute.exclude_kernel = 1;
+		attribute.exclude_hv = 1;
+		attribute.read_format = PERF_FORMAT_GROUP;
+
+		//Calling thread, any CPU
+		return int(syscall(SYS_perf_event_open, &attribute, 0, -1, groupFd, 0));
+	}
+
+	//Returns false when even the cycle counter cannot be opened, errorCode holds the reason
+	bool OpenThreadCounters(HardwareThreadCounters& threadCounters, int& errorCode)
+	{
+		threadCounters.groupFd = OpenCounter(HardwareCounter::Cycles, -1);
+		if (threadCounters.groupFd < 0)
+		{
+			errorCode = errno;
+			return false;
+		}
+		threadCounters.fds.push_back(threadCounters.groupFd);
+		threadCounters.readOrder.push_back(HardwareCounter::Cycles);
+
+		//Counters the CPU or the hypervisor does not offer are left out one by one
+		for (size_t index{ size_t(HardwareCounter::Cycles) + 1 }; index < HARDWARE_COUNTER_COUNT; ++index)
+		{
+			const int fd{ OpenCounter(HardwareCounter(index), threadCounters.groupFd) };
+			if (fd < 0)
+				continue;
+			threadCounters.fds.push_back(fd);
+			threadCounters.readOrder.push_back(HardwareCounter(index));
+		}
+
+		ioctl(threadCounters.groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(threadCounters.groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		return true;
+	}
+
+	void CloseThreadCounters(HardwareThreadCounters& threadCounters)
+	{
+		for (const int fd : threadCounters.fds)
+			close(fd);
+		threadCounters.fds.clear();
+		threadCounters.readOrder.clear();
+		threadCounters.groupFd = -1;
+	}
+
+	//One read returns the whole group: the number of values followed by the values
+	bool ReadThreadCounters(const HardwareThreadCounters& threadCounters, uint64_t counts[HARDWARE_COUNTER_COUNT])
+	{
+		uint64_t buffer[1 + HARDWARE_COUNTER_COUNT]{};
+		const ssize_t size{ read(threadCounters.groupFd, buffer, sizeof(buffer)) };
+		if (size < ssize_t(sizeof(uint64_t)) || buffer[0] != threadCounters.readOrder.size())
+			return false;
+
+		for (size_t index{}; index < threadCounters.readOrder.size(); ++index)
+			counts[size_t(threadCounters.readOrder[index])] = buffer[1 + index];
+		return true;
+	}
+#endif
+
+	HardwareThreadCounters* RegisterThread()
+	{
+		HardwareCountersRegistry& registry{ GetRegistry() };
+		const auto pThreadCounters = new HardwareThreadCounters();
+#if defined(__linux__)
+		int errorCode{};
+		OpenThreadCounters(*pThreadCounters, errorCode);
+#endif
+
+		const std::lock_guard<std::mutex> lock{ registry.mutex };
+		registry.threadCounters.push_back(pThreadCounters);
+		return pThreadCounters;
+	}
+
+	HardwareThreadCounters& GetThreadCounters()
+	{
+		thread_local HardwareThreadCounters* const pThreadCounters{ RegisterThread() };
+		return *pThreadCounters;
+	}
+
+	HardwareCountersRegistry::~HardwareCountersRegistry()
+	{
+		for (HardwareThreadCounters* pThreadCounters : threadCounters)
+		{
+#if defined(__linux__)
+			CloseThreadCounters(*pThreadCounters);
+#endif
+			delete pThreadCounters;
+		}
+	}
+}
+
+HardwareStats& HardwareStats::operator+=(const HardwareStats& other)
+{
+	for (size_t stage{}; stage < RENDER_STAGE_COUNT; ++stage)
+	{
+		for (size_t counter{}; counter < HARDWARE_COUNTER_COUNT; ++counter)
+			counts[stage][counter] += other.counts[stage][counter];
+	}
+	return *this;
+}
+
+bool HardwareCounters::Enable()
+{
+	HardwareCountersRegistry& registry{ GetRegistry() };
+	if (IsEnabled())
+		return true;
+
+#if defined(__linux__)
+	//A throwaway group tells whether this process may count at all, before any render thread tries
+	HardwareThreadCounters probe{};
+	int errorCode{};
+	if (!OpenThreadCounters(probe, errorCode))
+	{
+		std::cout << "Hardware counters are unavailable (" << std::strerror(errorCode) << ")";
+		if (errorCode == EACCES || errorCode == EPERM)
+			std::cout << ", lower /proc/sys/kernel/perf_event_paranoid to 2 or run with CAP_PERFMON";
+		else if (errorCode == ENOENT || errorCode == EOPNOTSUPP)
+			std::cout << ", the CPU or the virtual machine does not expose them";
+		std::cout << std::endl;
+		return false;
+	}
+
+	{
+		const std::lock_guard<std::mutex> lock{ registry.mutex };
+		for (const HardwareCounter counter : probe.readOrder)
+			registry.isSupported[size_t(counter)] = true;
+	}
+	CloseThreadCounters(probe);
+	registry.isEnabled.store(true, std::memory_order_release);
+	return true;
+#else
+	std::cout << "Hardware counters are only supported on Linux" << std::endl;
+	return false;
+#endif
+}
+
+bool HardwareCounters::IsEnabled()
+{
+	return GetRegistry().isEnabled.load(std::memory_order_relaxed);
+}
+
+HardwareStats HardwareCounters::Collect()
+{
+	HardwareCountersRegistry& registry{ GetRegistry() };
+	const std::lock_guard<std::mutex> lock{ registry.mutex };
+
+	//Accumulators only grow, the frame is the difference with the totals of the previous call
+	HardwareStats totals{};
+	for (const HardwareThreadCounters* pThreadCounters : registry.threadCounters)
+	{
+		for (size_t stage{}; stage < RENDER_STAGE_COUNT; ++stage)
+		{
+			for (size_t counter{}; counter < HARDWARE_COUNTER_COUNT; ++counter)
+				totals.counts[stage][counter] += pThreadCounters->counts[stage][counter].load(std::memory_order_relaxed);
+		}
+	}
+
+	HardwareStats frame{};
+	for (size_t stage{}; stage < RENDER_STAGE_COUNT; ++stage)
+	{
+		for (size_t counter{}; counter < HARDWARE_COUNTER_COUNT; ++counter)
+			frame.counts[stage][counter] = totals.counts[stage][counter] - registry.collectedTotals.counts[stage][counter];
+	}
+	registry.collectedTotals = totals;
+	return frame;
+}
+
+const char* HardwareCounters::GetStageName(RenderStage stage)
+{
+	return RENDER_STAGE_NAMES[size_t(stage)];
+}
+
+const char* HardwareCounters::GetCounterName(HardwareCounter counter)
+{
+	return HARDWARE_COUNTER_NAMES[size_t(counter)];
+}
+
+void HardwareCounters::Print(std::ostream& stream, const HardwareStats& stats, uint32_t frameCount)
+{
+	const HardwareCountersRegistry& registry{ GetRegistry() };
+	const uint64_t divisor{ std::max(frameCount, 1u) };
+	const std::ios_base::fmtflags flags{ stream.flags() };
+	const std::streamsize precision{ stream.precision() };
+
+	stream << std::fixed << std::setprecision(2);
+	for (size_t stage{}; stage < RENDER_STAGE_COUNT; ++stage)
+	{
+		const uint64_t cycles{ stats.counts[stage][size_t(HardwareCounter::Cycles)] };
+		if (cycles == 0)
+			continue;
+
+		const uint64_t instructions{ stats.counts[stage][size_t(HardwareCounter::Instructions)] };
+		stream << "  " << RENDER_STAGE_NAMES[stage] << ":";
+		for (size_t counter{}; counter < HARDWARE_COUNTER_COUNT; ++counter)
+		{
+			stream << " " << HARDWARE_COUNTER_NAMES[counter] << "=";
+			if (registry.isSupported[counter])
+				stream << stats.counts[stage][counter] / divisor;
+			else
+				stream << "n/a";
+		}
+
+		if (instructions > 0)
+		{
+			//Misses per thousand instructions compare stages of different sizes
+			stream << " ipc=" << double(instructions) / double(cycles);
+			for (const HardwareCounter counter : { HardwareCounter::L1DataMisses, HardwareCounter::LastLevelCacheMisses, HardwareCounter::BranchMisses })
+			{
+				if (registry.isSupported[size_t(counter)])
+					stream << " " << HARDWARE_COUNTER_NAMES[size_t(counter)] << "PKI=" << 1000.0 * double(stats.Get(RenderStage(stage), counter)) / double(instructions);
+			}
+		}
+		stream << "\n";
+	}
+	stream.flush();
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+HardwareCounterScope::HardwareCounterScope(RenderStage stage) :
+	m_Stage{ stage }
+{
+#if defined(__linux__)
+	if (!HardwareCounters::IsEnabled())
+		return;
+
+	const HardwareThreadCounters& threadCounters{ GetThreadCounters() };
+	m_IsCounting = threadCounters.groupFd >= 0 && ReadThreadCounters(threadCounters, m_StartCounts);
+#endif
+}
+
+HardwareCounterScope::~HardwareCounterScope()
+{
+#if defined(__linux__)
+	if (!m_IsCounting)
+		return;
+
+	HardwareThreadCounters& threadCounters{ GetThreadCounters() };
+	uint64_t endCounts[HARDWARE_COUNTER_COUNT]{};
+	if (!ReadThreadCounters(threadCounters, endCounts))
+		return;
+
+	//Only the owning thread writes, a relaxed load and store is enough
+	std::atomic<uint64_t>* const pCounts{ threadCounters.counts[size_t(m_Stage)] };
+	for (size_t counter{}; counter < HARDWARE_COUNTER_COUNT; ++counter)
+		pCounts[counter].store(pCounts[counter].load(std::memory_order_relaxed) + endCounts[counter] - m_StartCounts[counter], std::memory_order_relaxed);
+#endif
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+namespace dae
+{
+	enum class RenderStage
+	{
+		//Primary visibility and shading, including the ReSTIR passes
+		Tracing,
+		AntiAliasing,
+		Accumulation,
+		Denoising,
+		Present,
+		Count
+	};
+
+	enum class HardwareCounter
+	{
+		Cycles,
+		Instructions,
+		L1DataMisses,
+		LastLevelCacheMisses,
+		BranchMisses,
+		Count
+	};
+
+	constexpr size_t RENDER_STAGE_COUNT{ size_t(RenderStage::Count) };
+	constexpr size_t HARDWARE_COUNTER_COUNT{ size_t(HardwareCounter::Count) };
+
+	struct HardwareStats
+	{
+		uint64_t counts[RENDER_STAGE_COUNT][HARDWARE_COUNTER_COUNT]{};
+
+		uint64_t Get(RenderStage stage, HardwareCounter counter) const { return counts[size_t(stage)][size_t(counter)]; };
+		HardwareStats& operator+=(const HardwareStats& other);
+	};
+
+	//CPU performance counters (perf_event_open, Linux only) summed per render stage over every thread.
+	//Every thread opens its own counter group the first time it enters a stage, the kernel only counts user space
+	class HardwareCounters final
+	{
+	public:
+		//Tries the counters on the calling thread, they stay disabled when the platform or the kernel does not allow them
+		static bool Enable();
+		static bool IsEnabled();
+
+		//Counts of every thread since the previous call, only call it between frames
+		static HardwareStats Collect();
+
+		static const char* GetStageName(RenderStage stage);
+		static const char* GetCounterName(HardwareCounter counter);
+		//One line per stage with the average counts per frame, IPC and misses per thousand instructions
+		static void Print(std::ostream& stream, const HardwareStats& stats, uint32_t frameCount = 1);
+	};
+
+	//Adds what the calling thread did during the scope to a stage, keep the scopes coarse (tiles, rows), every scope reads the counters twice
+	class HardwareCounterScope final
+	{
+	public:
+		explicit HardwareCounterScope(RenderStage stage);
+		~HardwareCounterScope();
+
+		HardwareCounterScope(const HardwareCounterScope&) = delete;
+		HardwareCounterScope(HardwareCounterScope&&) noexcept = delete;
+		HardwareCounterScope& operator=(const HardwareCounterScope&) = delete;
+		HardwareCounterScope& operator=(HardwareCounterScope&&) noexcept = delete;
+
+	private:
+		RenderStage m_Stage;
+		bool m_IsCounting{ false };
+		uint64_t m_StartCounts[HARDWARE_COUNTER_COUNT]{};
+	};
+}
@@ -0,0 +1,520 @@
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "Timer.h"
+#include "Renderer.h"
+#include "RenderTarget.h"
+#include "Scene.h"
+#include "ImageWriter.h"
+#include "FrameStream.h"
+#include "Benchmark.h"
+#include "Regression.h"
+#include "RenderCounters.h"
+#include "HardwareCounters.h"
+#include "Profiler.h"
+#include "InputRecording.h"
+
+using namespace dae;
+
+//Batch renderer without a window, renders a scene into an offscreen target and reports frame timings
+namespace
+{
+	struct HeadlessOptions
+	{
+		std::string sceneName{ "W4" };
+		std::string sceneFilename{};
+		uint32_t width{ 640 };
+		uint32_t height{ 480 };
+		//0 picks the default of the mode, 1 frame for a render and BenchmarkSettings for a benchmark
+		uint32_t frameCount{ 0 };
+		int warmupFrameCount{ -1 };
+		float startTime{ 0.f };
+		float timeStep{ 1.f / 30.f };
+		std::string outputPrefix{};
+		ImageFormat outputFormat{ ImageFormat::PNG };
+		std::string streamDestination{};
+		FrameStreamFormat streamFormat{ FrameStreamFormat::Y4M };
+		std::string benchmarkFilename{};
+		std::vector<std::string> benchmarkScenes{};
+		std::string regressionDirectory{};
+		std::string threadScalingFilename{};
+		std::string replayFilename{};
+		//0 keeps the default, every hardware thread
+		uint32_t workerCount{ 0 };
+		RegressionSettings regressionSettings{};
+		std::string statsFilename{};
+		std::string traceFilename{};
+		bool showHeatmap{ false };
+		bool usePerfCounters{ false };
+		HeatmapMetric heatmapMetric{ HeatmapMetric::Nanoseconds };
+	};
+
+	const char* const BUILT_IN_SCENES[]{ "W1", "W2", "W3", "W4", "Bunny" };
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: RayTracerHeadless [scene.json] [options]\n"
+			<< "  --scene W1|W2|W3|W4|Bunny   built-in scene when no scene file is given (W4)\n"
+			<< "  --scene Stress[:key=value]  generated scene, keys: spheres (256), meshes (16), segments (24), lights (4),\n"
+			<< "                              triangles (0), distribution uniform|clustered|nested, seed, extent (10)\n"
+			<< "                              every mesh is a full copy of a segments * segments / 2 quad torus, memory grows with both\n"
+			<< "  --width <pixels>            (640)\n"
+			<< "  --height <pixels>           (480)\n"
+			<< "  --frames <count>            measured frames (1, benchmark 30)\n"
+			<< "  --warmup <count>            frames rendered before measuring (0, benchmark 3)\n"
+			<< "  --time <seconds>            scene time of the first frame (0)\n"
+			<< "  --timestep <seconds>        scene time between frames (1/30)\n"
+			<< "  --replay <file.rtin>        render a session recorded with RayTracer --record, every frame with its recorded input,\n"
+			<< "                              time and resolution. --frames and --time are ignored, warmup frames are not measured\n"
+			<< "  --output <prefix>           save every measured frame as <prefix>_00000.<format>\n"
+			<< "  --format png|exr|ppm        (png)\n"
+			<< "  --stream <destination>      stream frames to a file, \"-\" or \"fd:<n>\"\n"
+			<< "  --stream-format raw|y4m     (y4m)\n"
+			<< "  --benchmark <file.json>     render every scene along a scripted camera path and write the timings\n"
+			<< "  --scenes <name,name,...>    scenes to benchmark or check (the scene file, otherwise every built-in scene)\n"
+			<< "  --regression <directory>    compare fixed camera renders and benchmark timings of every scene with the references\n"
+			<< "  --regression-update         record the references and the timing baseline instead of comparing\n"
+			<< "  --baseline <file.txt>       timing baseline in ms written by --regression-update (<directory>/baseline.txt),\n"
+			<< "                              one [scene] section with WIDTH and HEIGHT per scene, HIGH/LOW/AVG in frames\n"
+			<< "                              per second inside a section are converted approximately\n"
+			<< "  --min-psnr <dB>             lowest PSNR an image may have (45)\n"
+			<< "  --max-error <value>         largest 8-bit channel difference an image may have (8)\n"
+			<< "  --time-tolerance <fraction> how much slower than the baseline a scene may be (0.15)\n"
+			<< "  --stats <file.csv>          write the render counters of every measured frame (needs RENDER_COUNTERS)\n"
+			<< "  --heatmap time|tests        render the per-pixel cost instead of the image (tests needs RENDER_COUNTERS)\n"
+			<< "  --trace <file.json>         write a Chrome trace of the measured frames\n"
+			<< "  --perf-counters             print CPU cycles, instructions, cache and branch misses per render stage (Linux)\n"
+			<< "  --threads <count>           worker threads, the main thread included (every hardware thread)\n"
+			<< "  --thread-scaling <file.csv> benchmark the scene with 1 to --threads workers and report speedup and idle time" << std::endl;
+	}
+
+	bool ParseOptions(int argc, char* args[], HeadlessOptions& options)
+	{
+		for (int index{ 1 }; index < argc; ++index)
+		{
+			const std::string argument{ args[index] };
+			if (argument.rfind("--", 0) != 0)
+			{
+				options.sceneFilename = argument;
+				continue;
+			}
+			if (argument == "--perf-counters")
+			{
+				options.usePerfCounters = true;
+				continue;
+			}
+			if (argument == "--regression-update")
+			{
+				options.regressionSettings.updateReferences = true;
+				continue;
+			}
+			if (index + 1 >= argc)
+				return false;
+
+			const std::string value{ args[++index] };
+			if (argument == "--scene")
+				options.sceneName = value;
+			else if (argument == "--width")
+				options.width = uint32_t(std::max(1, std::atoi(value.c_str())));
+			else if (argument == "--height")
+				options.height = uint32_t(std::max(1, std::atoi(value.c_str())));
+			else if (argument == "--frames")
+				options.frameCount = uint32_t(std::max(1, std::atoi(value.c_str())));
+			else if (argument == "--warmup")
+				options.warmupFrameCount = std::max(0, std::atoi(value.c_str()));
+			else if (argument == "--time")
+				options.startTime = float(std::atof(value.c_str()));
+			else if (argument == "--timestep")
+				options.timeStep = float(std::atof(value.c_str()));
+			else if (argument == "--output")
+				options.outputPrefix = value;
+			else if (argument == "--format")
+				options.outputFormat = value == "exr" ? ImageFormat::EXR : value == "ppm" ? ImageFormat::PPM : ImageFormat::PNG;
+			else if (argument == "--stream")
+				options.streamDestination = value;
+			else if (argument == "--stream-format")
+				options.streamFormat = value == "raw" ? FrameStreamFormat::RawRGB : FrameStreamFormat::Y4M;
+			else if (argument == "--heatmap")
+			{
+				options.showHeatmap = true;
+				options.heatmapMetric = value == "tests" ? HeatmapMetric::IntersectionTests : HeatmapMetric::Nanoseconds;
+			}
+			else if (argument == "--trace")
+				options.traceFilename = value;
+			else if (argument == "--stats")
+				options.statsFilename = value;
+			else if (argument == "--benchmark")
+				options.benchmarkFilename = value;
+			else if (argument == "--threads")
+				options.workerCount = uint32_t(std::max(1, std::atoi(value.c_str())));
+			else if (argument == "--replay")
+				options.replayFilename = value;
+			else if (argument == "--thread-scaling")
+				options.threadScalingFilename = value;
+			else if (argument == "--regression")
+				options.regressionDirectory = value;
+			else if (argument == "--baseline")
+				options.regressionSettings.baselineFilename = value;
+			else if (argument == "--min-psnr")
+				options.regressionSettings.minPsnr = std::atof(value.c_str());
+			else if (argument == "--max-error")
+				options.regressionSettings.maxChannelError = uint32_t(std::max(0, std::atoi(value.c_str())));
+			else if (argument == "--time-tolerance")
+				options.regressionSettings.timeTolerance = std::max(0.0, std::atof(value.c_str()));
+			else if (argument == "--scenes")
+			{
+				std::stringstream names{ value };
+				for (std::string name{}; std::getline(names, name, ',');)
+				{
+					if (!name.empty())
+						options.benchmarkScenes.push_back(name);
+				}
+			}
+			else
+				return false;
+		}
+		return true;
+	}
+
+	//Built-in scene by name, "Stress:..." generates one, any other name is the path of a scene file
+	Scene* CreateScene(const std::string& name)
+	{
+		if (name == "W1")
+			return new Scene_W1();
+		if (name == "W2")
+			return new Scene_W2();
+		if (name == "W3")
+			return new Scene_W3();
+		if (name == "W4")
+			return new Scene_W4();
+		if (name == "Bunny")
+			return new Scene_W4_BunnyScene();
+		StressSceneSettings stressSettings{};
+		if (StressSceneSettings::Parse(name, stressSettings))
+			return new Scene_Stress(stressSettings);
+		return new Scene_File(name);
+	}
+
+	double GetMillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//--scenes, otherwise the scene file, otherwise every built-in scene
+	std::vector<std::string> GetSceneNames(const HeadlessOptions& options)
+	{
+		std::vector<std::string> sceneNames{ options.benchmarkScenes };
+		if (sceneNames.empty() && !options.sceneFilename.empty())
+			sceneNames.push_back(options.sceneFilename);
+		if (sceneNames.empty())
+			sceneNames.assign(std::begin(BUILT_IN_SCENES), std::end(BUILT_IN_SCENES));
+		return sceneNames;
+	}
+
+	BenchmarkSettings GetBenchmarkSettings(const HeadlessOptions& options)
+	{
+		BenchmarkSettings settings{};
+		if (options.frameCount > 0)
+			settings.frameCount = options.frameCount;
+		if (options.warmupFrameCount >= 0)
+			settings.warmupFrameCount = uint32_t(options.warmupFrameCount);
+		settings.timeStep = options.timeStep;
+		return settings;
+	}
+
+	int RunBenchmark(const HeadlessOptions& options)
+	{
+		const std::vector<std::string> sceneNames{ GetSceneNames(options) };
+		const Benchmark benchmark{ GetBenchmarkSettings(options) };
+
+		const auto pTarget = new RenderTarget(options.width, options.height);
+		std::vector<BenchmarkResult> results{};
+		for (const std::string& sceneName : sceneNames)
+		{
+			Scene* pScene{ CreateScene(sceneName) };
+			const auto loadStart{ std::chrono::steady_clock::now() };
+			pScene->Initialize();
+			pScene->FinishLoading();
+			const double loadTime{ GetMillisecondsSince(loadStart) };
+
+			//Every scene starts from a fresh renderer, no history or caches carry over
+			const auto pRenderer = new Renderer(pTarget);
+			if (options.workerCount > 0)
+				pRenderer->SetWorkerCount(options.workerCount);
+			results.push_back(benchmark.Run(sceneName, pScene, pRenderer, loadTime));
+			Benchmark::PrintResult(results.back());
+
+			delete pRenderer;
+			delete pScene;
+		}
+		delete pTarget;
+
+		if (!benchmark.WriteJson(options.benchmarkFilename, results))
+		{
+			std::cout << "Could not write " << options.benchmarkFilename << std::endl;
+			return 1;
+		}
+		std::cout << "Saved " << options.benchmarkFilename << std::endl;
+		return 0;
+	}
+
+	/**
+	 * \brief Benchmarks one scene with every worker count from 1 to --threads.
+	 * Efficiency is the speedup per worker, the serial fraction (Karp-Flatt) stays flat when only the serial part limits scaling
+	 * and grows when the workers slow each other down, e.g. through shared caches or memory bandwidth
+	 */
+	int RunThreadScaling(const HeadlessOptions& options)
+	{
+		const std::string sceneName{ options.sceneFilename.empty() ? options.sceneName : options.sceneFilename };
+		const uint32_t maxWorkerCount{ options.workerCount > 0 ? options.workerCount : Renderer::GetDefaultWorkerCount() };
+		const Benchmark benchmark{ GetBenchmarkSettings(options) };
+
+		Scene* pScene{ CreateScene(sceneName) };
+		pScene->Initialize();
+		pScene->FinishLoading();
+		const auto pTarget = new RenderTarget(options.width, options.height);
+		const auto pRenderer = new Renderer(pTarget);
+
+		std::ofstream file{ options.threadScalingFilename, std::ios::trunc };
+		file << "threads,medianMs,avgMs,speedup,efficiency,serialFraction,parallelMs,avgIdlePercent,maxIdlePercent\n";
+		std::cout << "threads  median ms  speedup  efficiency  serial  parallel ms  idle avg %  idle max %" << std::endl;
+
+		double singleWorkerTime{};
+		for (uint32_t workerCount{ 1 }; workerCount <= maxWorkerCount; ++workerCount)
+		{
+			pRenderer->SetWorkerCount(workerCount);
+			const BenchmarkResult result{ benchmark.Run(sceneName, pScene, pRenderer) };
+			if (workerCount == 1)
+				singleWorkerTime = result.medianFrameTime;
+
+			const double speedup{ result.medianFrameTime > 0.0 ? singleWorkerTime / result.medianFrameTime : 0.0 };
+			const double efficiency{ speedup / double(workerCount) };
+			const double serialFraction{ workerCount > 1 && speedup > 0.0 ? (1.0 / speedup - 1.0 / workerCount) / (1.0 - 1.0 / workerCount) : 0.0 };
+
+			//Idle time is relative to the time spent in parallel loops, a single worker has no one to wait for
+			double totalIdleTime{}, maxIdleTime{};
+			for (const double idleTime : result.workerIdleTimes)
+			{
+				totalIdleTime += idleTime;
+				maxIdleTime = std::max(maxIdleTime, idleTime);
+			}
+			const double averageIdlePercent{ result.parallelTime > 0.0 ? 100.0 * totalIdleTime / (result.parallelTime * workerCount) : 0.0 };
+			const double maxIdlePercent{ result.parallelTime > 0.0 ? 100.0 * maxIdleTime / result.parallelTime : 0.0 };
+
+			file << workerCount << "," << result.medianFrameTime << "," << result.averageFrameTime << "," << speedup << "," << efficiency << ","
+				<< serialFraction << "," << result.parallelTime << "," << averageIdlePercent << "," << maxIdlePercent << "\n";
+			std::cout << std::fixed << std::setprecision(2) << std::setw(7) << workerCount << std::setw(11) << result.medianFrameTime << std::setw(9) << speedup
+				<< std::setw(12) << efficiency << std::setw(8) << serialFraction << std::setw(13) << result.parallelTime
+				<< std::setw(12) << averageIdlePercent << std::setw(12) << maxIdlePercent << std::defaultfloat << std::endl;
+		}
+
+		delete pRenderer;
+		delete pTarget;
+		delete pScene;
+
+		if (!file)
+		{
+			std::cout << "Could not write " << options.threadScalingFilename << std::endl;
+			return 1;
+		}
+		std::cout << "Saved " << options.threadScalingFilename << std::endl;
+		return 0;
+	}
+
+	//Exits with 1 when any scene rendered different pixels or got slower than the baseline allows
+	int RunRegression(const HeadlessOptions& options)
+	{
+		RegressionSettings settings{ options.regressionSettings };
+		settings.referenceDirectory = options.regressionDirectory;
+		settings.benchmarkSettings = GetBenchmarkSettings(options);
+		RegressionGate gate{ settings };
+
+		const std::vector<std::string> sceneNames{ GetSceneNames(options) };
+		const auto pTarget = new RenderTarget(options.width, options.height);
+		for (const std::string& sceneName : sceneNames)
+		{
+			Scene* pScene{ CreateScene(sceneName) };
+			pScene->Initialize();
+			pScene->FinishLoading();
+
+			//Every scene starts from a fresh renderer, no history or caches carry over
+			const auto pRenderer = new Renderer(pTarget);
+			if (options.workerCount > 0)
+				pRenderer->SetWorkerCount(options.workerCount);
+			gate.Run(sceneName, pScene, pRenderer, pTarget);
+
+			delete pRenderer;
+			delete pScene;
+		}
+		delete pTarget;
+
+		if (!gate.WriteBaseline())
+		{
+			std::cout << "Could not write the timing baseline" << std::endl;
+			return 1;
+		}
+		if (gate.GetFailureCount() > 0)
+		{
+			std::cout << "Regression: " << gate.GetFailureCount() << " of " << sceneNames.size() << " scenes failed" << std::endl;
+			return 1;
+		}
+		std::cout << "Regression: " << (settings.updateReferences ? "recorded " : "passed ") << sceneNames.size() << " scenes" << std::endl;
+		return 0;
+	}
+}
+
+int main(int argc, char* args[])
+{
+	HeadlessOptions options{};
+	if (!ParseOptions(argc, args, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	//Frames streamed to stdout would be corrupted by the log
+	if (options.streamDestination == "-")
+		std::cout.rdbuf(std::cerr.rdbuf());
+
+	if (!options.benchmarkFilename.empty())
+		return RunBenchmark(options);
+	if (!options.regressionDirectory.empty())
+		return RunRegression(options);
+	if (!options.threadScalingFilename.empty())
+		return RunThreadScaling(options);
+
+	//A replay renders its recorded scene, unless a scene file is given
+	InputReplay replay{};
+	const bool isReplaying{ !options.replayFilename.empty() };
+	if (isReplaying)
+	{
+		if (!replay.Load(options.replayFilename) || replay.GetFrameCount() == 0)
+		{
+			std::cout << "Could not read input recording " << options.replayFilename << std::endl;
+			return 1;
+		}
+		if (options.sceneFilename.empty())
+			options.sceneName = replay.GetSceneName();
+		options.width = replay.GetWidth();
+		options.height = replay.GetHeight();
+		std::cout << "Replaying " << replay.GetFrameCount() << " frames of " << options.replayFilename << " (" << replay.GetSceneName() << ")" << std::endl;
+	}
+
+	Scene* pScene{ CreateScene(options.sceneFilename.empty() ? options.sceneName : options.sceneFilename) };
+
+	//Streamed meshes are waited for, every measured frame renders the complete scene
+	const auto loadStart{ std::chrono::steady_clock::now() };
+	pScene->Initialize();
+	pScene->FinishLoading();
+	std::cout << "Scene loaded in " << GetMillisecondsSince(loadStart) << " ms" << std::endl;
+
+	const auto pTimer = new Timer();
+	pTimer->SetFixedTimeStep(options.timeStep, options.startTime);
+	pTimer->Start();
+
+	const auto pTarget = new RenderTarget(options.width, options.height);
+	const auto pRenderer = new Renderer(pTarget);
+	if (options.workerCount > 0)
+		pRenderer->SetWorkerCount(options.workerCount);
+	if (!options.outputPrefix.empty())
+		pRenderer->SetImageOutput(options.outputPrefix, options.outputFormat);
+	if (options.showHeatmap)
+		pRenderer->ShowCostHeatmap(options.heatmapMetric);
+	if (!options.streamDestination.empty() && !pRenderer->StartFrameStream(options.streamDestination, options.streamFormat, uint32_t(1.f / options.timeStep + 0.5f)))
+		std::cout << "Streaming disabled" << std::endl;
+
+	std::ofstream statsFile{};
+	if (!options.statsFilename.empty() && RenderCounters::IsEnabled())
+	{
+		statsFile.open(options.statsFilename, std::ios::trunc);
+		RenderCounters::WriteCsvHeader(statsFile);
+	}
+	else if (!options.statsFilename.empty())
+		std::cout << "Render counters are compiled out, define RENDER_COUNTERS to write " << options.statsFilename << std::endl;
+	RenderStats totalStats{};
+	HardwareStats totalHardwareStats{};
+	if (options.usePerfCounters)
+		HardwareCounters::Enable();
+
+	uint32_t frameCount{ std::max(options.frameCount, 1u) };
+	uint32_t warmupFrameCount{ uint32_t(std::max(options.warmupFrameCount, 0)) };
+	if (isReplaying)
+	{
+		warmupFrameCount = std::min(warmupFrameCount, replay.GetFrameCount() - 1);
+		frameCount = replay.GetFrameCount() - warmupFrameCount;
+	}
+	std::vector<double> frameTimes{};
+	frameTimes.reserve(frameCount);
+	Profiler::SetThreadName("Main");
+	for (uint32_t frame{}; frame < warmupFrameCount + frameCount; ++frame)
+	{
+		if (frame == warmupFrameCount && !options.traceFilename.empty())
+			Profiler::BeginCapture();
+
+		const auto frameStart{ std::chrono::steady_clock::now() };
+		if (isReplaying)
+		{
+			//The recorded times replace the fixed timestep, so the camera moves exactly as it did in the session
+			const InputFrame& inputFrame{ replay.GetFrame(frame) };
+			pTimer->SetFrameTime(inputFrame.elapsedTime, inputFrame.totalTime);
+			ApplyInputActions(pRenderer, inputFrame.actions);
+			pScene->SetCameraInput(inputFrame.cameraInput);
+		}
+		{
+			PROFILE_SCOPE("Scene::Update");
+			pScene->Update(pTimer);
+		}
+		pRenderer->Render(pScene);
+		const double frameTime{ GetMillisecondsSince(frameStart) };
+		pTimer->Update();
+
+		if (frame < warmupFrameCount)
+			continue;
+
+		frameTimes.push_back(frameTime);
+		std::cout << "Frame " << frameTimes.size() - 1 << ": " << frameTime << " ms" << std::endl;
+		totalStats += pRenderer->GetFrameStats();
+		totalHardwareStats += pRenderer->GetHardwareStats();
+		if (statsFile.is_open())
+			RenderCounters::WriteCsvRow(statsFile, uint32_t(frameTimes.size() - 1), frameTime, pRenderer->GetFrameStats());
+		if (!options.outputPrefix.empty())
+			pRenderer->SaveBufferToImage();
+	}
+
+	if (!options.traceFilename.empty() && !Profiler::EndCapture(options.traceFilename))
+		std::cout << "Could not write " << options.traceFilename << std::endl;
+
+	std::vector<double> sortedFrameTimes{ frameTimes };
+	std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+	const double averageFrameTime{ std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / double(frameTimes.size()) };
+	std::cout << "Rendered " << frameTimes.size() << " frames at " << options.width << "x" << options.height
+		<< ": avg " << averageFrameTime << " ms, median " << sortedFrameTimes[sortedFrameTimes.size() / 2]
+		<< " ms, min " << sortedFrameTimes.front() << " ms, max " << sortedFrameTimes.back()
+		<< " ms (" << 1000.0 / averageFrameTime << " FPS)" << std::endl;
+	if (RenderCounters::IsEnabled())
+		RenderCounters::Print(std::cout, totalStats, uint32_t(frameTimes.size()));
+	if (HardwareCounters::IsEnabled())
+	{
+		std::cout << "Hardware counters per frame:\n";
+		HardwareCounters::Print(std::cout, totalHardwareStats, uint32_t(frameTimes.size()));
+	}
+	if (options.showHeatmap)
+		std::cout << pRenderer->GetHeatmapLegend() << std::endl;
+
+	//The renderer waits for queued images and streamed frames
+	delete pRenderer;
+	delete pTarget;
+	delete pScene;
+	delete pTimer;
+	return 0;
+}
@@ -0,0 +1,479 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+using namespace dae;
+
+namespace
+{
+	//Candidates followed per position while searching for a match, trades PNG size for encoding time
+	constexpr int DEFLATE_MAX_CHAIN{ 16 };
+	constexpr int DEFLATE_WINDOW_SIZE{ 32768 };
+	constexpr int DEFLATE_HASH_BITS{ 15 };
+	constexpr int DEFLATE_MIN_MATCH{ 3 };
+	constexpr int DEFLATE_MAX_MATCH{ 258 };
+
+	constexpr uint16_t DEFLATE_LENGTH_BASES[29]{ 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr uint8_t DEFLATE_LENGTH_EXTRA_BITS[29]{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr uint16_t DEFLATE_DISTANCE_BASES[30]{ 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr uint8_t DEFLATE_DISTANCE_EXTRA_BITS[30]{ 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	//Deflate streams are filled from the least significant bit, Huffman codes from their most significant bit
+	class BitWriter final
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& output) : m_Output{ output } {}
+
+		void WriteBits(uint32_t value, int count)
+		{
+			m_BitBuffer |= value << m_BitCount;
+			m_BitCount += count;
+			while (m_BitCount >= 8)
+			{
+				m_Output.push_back(static_cast<uint8_t>(m_BitBuffer));
+				m_BitBuffer >>= 8;
+				m_BitCount -= 8;
+			}
+		}
+
+		void WriteCode(uint32_t code, int length)
+		{
+			uint32_t reversed{};
+			for (int bit{}; bit < length; ++bit)
+				reversed |= ((code >> bit) & 1u) << (length - 1 - bit);
+			WriteBits(reversed, length);
+		}
+
+		void Finish()
+		{
+			if (m_BitCount > 0)
+				m_Output.push_back(static_cast<uint8_t>(m_BitBuffer));
+			m_BitBuffer = 0;
+			m_BitCount = 0;
+		}
+
+	private:
+		std::vector<uint8_t>& m_Output;
+		uint32_t m_BitBuffer{};
+		int m_BitCount{};
+	};
+
+	//Fixed Huffman code of a literal/length symbol (RFC 1951, 3.2.6)
+	void WriteFixedSymbol(BitWriter& writer, int symbol)
+	{
+		if (symbol < 144)
+			writer.WriteCode(0x30 + symbol, 8);
+		else if (symbol < 256)
+			writer.WriteCode(0x190 + symbol - 144, 9);
+		else if (symbol < 280)
+			writer.WriteCode(symbol - 256, 7);
+		else
+			writer.WriteCode(0xC0 + symbol - 280, 8);
+	}
+
+	void WriteMatch(BitWriter& writer, int length, int distance)
+	{
+		const int lengthCode{ static_cast<int>(std::upper_bound(std::begin(DEFLATE_LENGTH_BASES), std::end(DEFLATE_LENGTH_BASES), length) - std::begin(DEFLATE_LENGTH_BASES)) - 1 };
+		WriteFixedSymbol(writer, 257 + lengthCode);
+		writer.WriteBits(length - DEFLATE_LENGTH_BASES[lengthCode], DEFLATE_LENGTH_EXTRA_BITS[lengthCode]);
+
+		const int distanceCode{ static_cast<int>(std::upper_bound(std::begin(DEFLATE_DISTANCE_BASES), std::end(DEFLATE_DISTANCE_BASES), distance) - std::begin(DEFLATE_DISTANCE_BASES)) - 1 };
+		writer.WriteCode(distanceCode, 5);
+		writer.WriteBits(distance - DEFLATE_DISTANCE_BASES[distanceCode], DEFLATE_DISTANCE_EXTRA_BITS[distanceCode]);
+	}
+
+	//Single fixed Huffman block with hash chain LZ77 matching, wrapped in a zlib stream
+	std::vector<uint8_t> CompressZlib(const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> output{ 0x78, 0x01 };
+		output.reserve(data.size() / 2);
+
+		BitWriter writer{ output };
+		writer.WriteBits(1, 1);
+		writer.WriteBits(1, 2);
+
+		std::vector<int> head(size_t(1) << DEFLATE_HASH_BITS, -1);
+		std::vector<int> previous(DEFLATE_WINDOW_SIZE, -1);
+		const int size{ static_cast<int>(data.size()) };
+		auto insert = [&](int position)
+		{
+			if (position + DEFLATE_MIN_MATCH > size)
+				return;
+			const uint32_t hash{ ((uint32_t(data[position]) << 10) ^ (uint32_t(data[position + 1]) << 5) ^ data[position + 2]) & ((1u << DEFLATE_HASH_BITS) - 1) };
+			previous[position % DEFLATE_WINDOW_SIZE] = head[hash];
+			head[hash] = position;
+		};
+
+		for (int position{}; position < size;)
+		{
+			int bestLength{};
+			int bestDistance{};
+			if (position + DEFLATE_MIN_MATCH <= size)
+			{
+				const uint32_t hash{ ((uint32_t(data[position]) << 10) ^ (uint32_t(data[position + 1]) << 5) ^ data[position + 2]) & ((1u << DEFLATE_HASH_BITS) - 1) };
+				const int maxLength{ std::min(DEFLATE_MAX_MATCH, size - position) };
+				int candidate{ head[hash] };
+				for (int chain{}; candidate >= 0 && position - candidate <= DEFLATE_WINDOW_SIZE && chain < DEFLATE_MAX_CHAIN; ++chain)
+				{
+					int length{};
+					while (length < maxLength && data[candidate + length] == data[position + length])
+						++length;
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = position - candidate;
+						if (length == maxLength)
+							break;
+					}
+					candidate = previous[candidate % DEFLATE_WINDOW_SIZE];
+				}
+			}
+
+			if (bestLength >= DEFLATE_MIN_MATCH)
+			{
+				WriteMatch(writer, bestLength, bestDistance);
+				for (int offset{}; offset < bestLength; ++offset)
+					insert(position + offset);
+				position += bestLength;
+			}
+			else
+			{
+				WriteFixedSymbol(writer, data[position]);
+				insert(position);
+				++position;
+			}
+		}
+		WriteFixedSymbol(writer, 256);
+		writer.Finish();
+
+		uint32_t a{ 1 }, b{ 0 };
+		for (uint8_t byte : data)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		const uint32_t adler{ (b << 16) | a };
+		output.insert(output.end(), { uint8_t(adler >> 24), uint8_t(adler >> 16), uint8_t(adler >> 8), uint8_t(adler) });
+		return output;
+	}
+
+	uint32_t CalculateCRC32(const uint8_t* pData, size_t size, uint32_t crc = 0)
+	{
+		static const std::array<uint32_t, 256> table{ []()
+		{
+			std::array<uint32_t, 256> entries{};
+			for (uint32_t index{}; index < 256; ++index)
+			{
+				uint32_t value{ index };
+				for (int bit{}; bit < 8; ++bit)
+					value = (value & 1u) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+				entries[index] = value;
+			}
+			return entries;
+		}() };
+
+		crc = ~crc;
+		for (size_t index{}; index < size; ++index)
+			crc = table[(crc ^ pData[index]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void AppendBigEndian(std::vector<uint8_t>& output, uint32_t value)
+	{
+		output.insert(output.end(), { uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value) });
+	}
+
+	void AppendChunk(std::vector<uint8_t>& output, const char type[4], const std::vector<uint8_t>& data)
+	{
+		AppendBigEndian(output, static_cast<uint32_t>(data.size()));
+		const size_t typeOffset{ output.size() };
+		output.insert(output.end(), type, type + 4);
+		output.insert(output.end(), data.begin(), data.end());
+		AppendBigEndian(output, CalculateCRC32(output.data() + typeOffset, data.size() + 4));
+	}
+
+	void UnpackRGB(uint32_t pixel, const PixelFormat& format, uint8_t* pRGB)
+	{
+		pRGB[0] = static_cast<uint8_t>(pixel >> format.redShift);
+		pRGB[1] = static_cast<uint8_t>(pixel >> format.greenShift);
+		pRGB[2] = static_cast<uint8_t>(pixel >> format.blueShift);
+	}
+
+	uint8_t PaethPredictor(int left, int up, int upLeft)
+	{
+		const int estimate{ left + up - upLeft };
+		const int leftDistance{ std::abs(estimate - left) };
+		const int upDistance{ std::abs(estimate - up) };
+		const int upLeftDistance{ std::abs(estimate - upLeft) };
+		if (leftDistance <= upDistance && leftDistance <= upLeftDistance)
+			return static_cast<uint8_t>(left);
+		return static_cast<uint8_t>(upDistance <= upLeftDistance ? up : upLeft);
+	}
+
+	//8-bit RGB, every row takes the filter with the smallest sum of absolute differences
+	bool WritePNG(const std::string& filename, uint32_t width, uint32_t height, const std::vector<uint32_t>& pixels, const PixelFormat& format)
+	{
+		const size_t rowSize{ size_t(width) * 3 };
+		std::vector<uint8_t> rows(rowSize * height);
+		for (size_t index{}; index < pixels.size(); ++index)
+			UnpackRGB(pixels[index], format, &rows[index * 3]);
+
+		std::vector<uint8_t> filtered((rowSize + 1) * height);
+		std::vector<uint8_t> candidate(rowSize);
+		for (uint32_t y{}; y < height; ++y)
+		{
+			const uint8_t* pRow{ &rows[y * rowSize] };
+			const uint8_t* pUpRow{ y > 0 ? &rows[(y - 1) * rowSize] : nullptr };
+			uint8_t* pFiltered{ &filtered[y * (rowSize + 1)] };
+
+			uint64_t bestScore{ UINT64_MAX };
+			for (uint8_t filter{}; filter < 5; ++filter)
+			{
+				uint64_t score{};
+				for (size_t x{}; x < rowSize; ++x)
+				{
+					const int left{ x >= 3 ? pRow[x - 3] : 0 };
+					const int up{ pUpRow ? pUpRow[x] : 0 };
+					const int upLeft{ pUpRow && x >= 3 ? pUpRow[x - 3] : 0 };
+					uint8_t prediction{};
+					switch (filter)
+					{
+					case 1: prediction = static_cast<uint8_t>(left); break;
+					case 2: prediction = static_cast<uint8_t>(up); break;
+					case 3: prediction = static_cast<uint8_t>((left + up) / 2); break;
+					case 4: prediction = PaethPredictor(left, up, upLeft); break;
+					default: break;
+					}
+					candidate[x] = static_cast<uint8_t>(pRow[x] - prediction);
+					score += std::abs(static_cast<int8_t>(candidate[x]));
+				}
+
+				if (score < bestScore)
+				{
+					bestScore = score;
+					pFiltered[0] = filter;
+					std::copy(candidate.begin(), candidate.end(), pFiltered + 1);
+				}
+			}
+		}
+
+		std::vector<uint8_t> header{};
+		AppendBigEndian(header, width);
+		AppendBigEndian(header, height);
+		header.insert(header.end(), { 8, 2, 0, 0, 0 });
+
+		std::vector<uint8_t> png{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		AppendChunk(png, "IHDR", header);
+		AppendChunk(png, "IDAT", CompressZlib(filtered));
+		AppendChunk(png, "IEND", {});
+
+		std::ofstream file{ filename, std::ios::binary | std::ios::trunc };
+		file.write(reinterpret_cast<const char*>(png.data()), std::streamsize(png.size()));
+		return bool(file);
+	}
+
+	bool WritePPM(const std::string& filename, uint32_t width, uint32_t height, const std::vector<uint32_t>& pixels, const PixelFormat& format)
+	{
+		std::vector<uint8_t> rgb(pixels.size() * 3);
+		for (size_t index{}; index < pixels.size(); ++index)
+			UnpackRGB(pixels[index], format, &rgb[index * 3]);
+
+		std::ofstream file{ filename, std::ios::binary | std::ios::trunc };
+		file << "P6\n" << width << " " << height << "\n255\n";
+		file.write(reinterpret_cast<const char*>(rgb.data()), std::streamsize(rgb.size()));
+		return bool(file);
+	}
+
+	//Uncompressed scanline OpenEXR with 32-bit float B, G and R channels (channels are stored alphabetically)
+	bool WriteEXR(const std::string& filename, uint32_t width, uint32_t height, const std::vector<ColorRGB>& colors)
+	{
+		std::vector<char> header{ 0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0 };
+		auto appendValue = [&](const auto& value)
+		{
+			const char* pValue{ reinterpret_cast<const char*>(&value) };
+			header.insert(header.end(), pValue, pValue + sizeof(value));
+		};
+		auto appendAttribute = [&](const char* pName, const char* pType, int32_t size)
+		{
+			header.insert(header.end(), pName, pName + std::strlen(pName) + 1);
+			header.insert(header.end(), pType, pType + std::strlen(pType) + 1);
+			appendValue(size);
+		};
+
+		appendAttribute("channels", "chlist", 3 * 18 + 1);
+		for (const char* pChannel : { "B", "G", "R" })
+		{
+			header.insert(header.end(), { pChannel[0], 0 });
+			appendValue(int32_t{ 2 });
+			header.insert(header.end(), { 0, 0, 0, 0 });
+			appendValue(int32_t{ 1 });
+			appendValue(int32_t{ 1 });
+		}
+		header.push_back(0);
+
+		appendAttribute("compression", "compression", 1);
+		header.push_back(0);
+		const int32_t window[4]{ 0, 0, int32_t(width) - 1, int32_t(height) - 1 };
+		appendAttribute("dataWindow", "box2i", sizeof(window));
+		appendValue(window);
+		appendAttribute("displayWindow", "box2i", sizeof(window));
+		appendValue(window);
+		appendAttribute("lineOrder", "lineOrder", 1);
+		header.push_back(0);
+		appendAttribute("pixelAspectRatio", "float", 4);
+		appendValue(1.f);
+		const float screenWindowCenter[2]{};
+		appendAttribute("screenWindowCenter", "v2f", sizeof(screenWindowCenter));
+		appendValue(screenWindowCenter);
+		appendAttribute("screenWindowWidth", "float", 4);
+		appendValue(1.f);
+		header.push_back(0);
+
+		//One scanline per block, the offset table points at each of them
+		const uint32_t lineDataSize{ width * 3 * uint32_t(sizeof(float)) };
+		const uint64_t firstLineOffset{ header.size() + uint64_t(height) * sizeof(uint64_t) };
+		for (uint32_t y{}; y < height; ++y)
+			appendValue(uint64_t{ firstLineOffset + uint64_t(y) * (8 + lineDataSize) });
+
+		std::ofstream file{ filename, std::ios::binary | std::ios::trunc };
+		file.write(header.data(), std::streamsize(header.size()));
+
+		std::vector<float> line(size_t(width) * 3);
+		for (uint32_t y{}; y < height; ++y)
+		{
+			const ColorRGB* pRow{ &colors[size_t(y) * width] };
+			for (uint32_t x{}; x < width; ++x)
+			{
+				line[x] = pRow[x].b;
+				line[width + x] = pRow[x].g;
+				line[2 * width + x] = pRow[x].r;
+			}
+
+			const int32_t lineHeader[2]{ int32_t(y), int32_t(lineDataSize) };
+			file.write(reinterpret_cast<const char*>(lineHeader), sizeof(lineHeader));
+			file.write(reinterpret_cast<const char*>(line.data()), std::streamsize(lineDataSize));
+		}
+		return bool(file);
+	}
+}
+
+ImageWriter::ImageWriter(const std::string& prefix, uint32_t maxPendingImages) :
+	m_Prefix{ prefix },
+	m_MaxPendingImages{ std::max(maxPendingImages, 1u) },
+	m_pThreadPool{ new ThreadPool(1) }
+{
+}
+
+ImageWriter::~ImageWriter()
+{
+	Flush();
+
+	delete m_pThreadPool;
+	m_pThreadPool = nullptr;
+
+	for (ImageBuffer* pBuffer : m_pFreeBuffers)
+		delete pBuffer;
+	m_pFreeBuffers.clear();
+}
+
+std::string ImageWriter::Submit(ImageFormat format, uint32_t width, uint32_t height, const uint32_t* pPixels, uint32_t pitch,
+	const PixelFormat& pixelFormat, const ColorRGB* pColors)
+{
+	ImageBuffer* pBuffer{ nullptr };
+	{
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_ImageWritten.wait(lock, [this]() { return m_PendingImageCount < m_MaxPendingImages; });
+		++m_PendingImageCount;
+		if (!m_pFreeBuffers.empty())
+		{
+			pBuffer = m_pFreeBuffers.back();
+			m_pFreeBuffers.pop_back();
+		}
+	}
+	if (!pBuffer)
+		pBuffer = new ImageBuffer{};
+
+	pBuffer->format = format;
+	pBuffer->width = width;
+	pBuffer->height = height;
+	pBuffer->pixelFormat = pixelFormat;
+	if (format == ImageFormat::EXR)
+	{
+		pBuffer->colors.assign(pColors, pColors + size_t(width) * height);
+	}
+	else
+	{
+		pBuffer->pixels.resize(size_t(width) * height);
+		for (uint32_t y{}; y < height; ++y)
+		{
+			const uint32_t* pRow{ reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(pPixels) + size_t(y) * pitch) };
+			std::copy(pRow, pRow + width, pBuffer->pixels.begin() + size_t(y) * width);
+		}
+	}
+
+	//Never overwrite results of an earlier run
+	do
+	{
+		std::ostringstream filename{};
+		filename << m_Prefix << "_" << std::setw(5) << std::setfill('0') << m_ImageIndex++ << "." << GetExtension(format);
+		pBuffer->filename = filename.str();
+	} while (std::filesystem::exists(pBuffer->filename));
+
+	std::string filename{ pBuffer->filename };
+	m_pThreadPool->Enqueue([this, pBuffer]() { Write(pBuffer); });
+	return filename;
+}
+
+void ImageWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock{ m_Mutex };
+	m_ImageWritten.wait(lock, [this]() { return m_PendingImageCount == 0; });
+}
+
+const char* ImageWriter::GetExtension(ImageFormat format)
+{
+	switch (format)
+	{
+	case ImageFormat::EXR: return "exr";
+	case ImageFormat::PPM: return "ppm";
+	default: return "png";
+	}
+}
+
+void ImageWriter::Write(ImageBuffer* pBuffer)
+{
+	PROFILE_SCOPE("ImageWriter::Write");
+	bool isWritten{};
+	switch (pBuffer->format)
+	{
+	case ImageFormat::PNG:
+		isWritten = WritePNG(pBuffer->filename, pBuffer->width, pBuffer->height, pBuffer->pixels, pBuffer->pixelFormat);
+		break;
+	case ImageFormat::EXR:
+		isWritten = WriteEXR(pBuffer->filename, pBuffer->width, pBuffer->height, pBuffer->colors);
+		break;
+	case ImageFormat::PPM:
+		isWritten = WritePPM(pBuffer->filename, pBuffer->width, pBuffer->height, pBuffer->pixels, pBuffer->pixelFormat);
+		break;
+	}
+	if (!isWritten)
+		std::cout << "Failed to write " << pBuffer->filename << std::endl;
+
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_pFreeBuffers.push_back(pBuffer);
+		--m_PendingImageCount;
+	}
+	m_ImageWritten.notify_all();
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ColorRGB.h"
+#include "ToneMapper.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	enum class ImageFormat
+	{
+		PNG,
+		EXR,
+		PPM
+	};
+
+	//Encodes frames on a background thread into numbered files (<prefix>_00000.png, ...).
+	//Frames are copied into pooled buffers first, so the caller only pays for a copy
+	class ImageWriter final
+	{
+	public:
+		explicit ImageWriter(const std::string& prefix, uint32_t maxPendingImages = 4);
+		~ImageWriter();
+
+		ImageWriter(const ImageWriter&) = delete;
+		ImageWriter(ImageWriter&&) noexcept = delete;
+		ImageWriter& operator=(const ImageWriter&) = delete;
+		ImageWriter& operator=(ImageWriter&&) noexcept = delete;
+
+		/**
+		 * \brief Queues a frame, only blocks while maxPendingImages frames are still being written
+		 * \param format PNG and PPM store the packed 8-bit pixels, EXR stores the linear colors as 32-bit floats
+		 * \param pPixels packed pixels, rows are pitch bytes apart
+		 * \param pixelFormat bit layout of the packed pixels
+		 * \param pColors linear colors, width * height of them
+		 * \return name of the file the frame will be written to
+		 */
+		std::string Submit(ImageFormat format, uint32_t width, uint32_t height, const uint32_t* pPixels, uint32_t pitch,
+			const PixelFormat& pixelFormat, const ColorRGB* pColors);
+
+		//Blocks until every queued frame is written
+		void Flush();
+
+		static const char* GetExtension(ImageFormat format);
+
+	private:
+		struct ImageBuffer
+		{
+			ImageFormat format{};
+			uint32_t width{};
+			uint32_t height{};
+			PixelFormat pixelFormat{};
+			std::vector<uint32_t> pixels{};
+			std::vector<ColorRGB> colors{};
+			std::string filename{};
+		};
+
+		std::string m_Prefix{};
+		uint32_t m_ImageIndex{};
+		uint32_t m_MaxPendingImages{};
+
+		ThreadPool* m_pThreadPool{ nullptr };
+		std::vector<ImageBuffer*> m_pFreeBuffers{};
+		uint32_t m_PendingImageCount{};
+		std::mutex m_Mutex{};
+		std::condition_variable m_ImageWritten{};
+
+		void Write(ImageBuffer* pBuffer);
+	};
+}
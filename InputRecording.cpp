@@ -0,0 +1,211 @@
+#include "InputRecording.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "Renderer.h"
+#include "ToneMapper.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr char MAGIC[4]{ 'R', 'T', 'I', 'N' };
+	constexpr uint16_t VERSION{ 1 };
+	constexpr size_t FRAME_SIZE{ 16 };
+
+	//Bits of the held keys and mouse buttons
+	enum InputButton : uint16_t
+	{
+		MoveForward = 1 << 0,
+		MoveBackward = 1 << 1,
+		MoveRight = 1 << 2,
+		MoveLeft = 1 << 3,
+		NarrowFov = 1 << 4,
+		WidenFov = 1 << 5,
+		Sprint = 1 << 6,
+		LeftMouseButton = 1 << 7,
+		RightMouseButton = 1 << 8
+	};
+
+	//Little endian, whatever the platform
+	void Write16(uint8_t*& pBytes, uint16_t value)
+	{
+		*pBytes++ = uint8_t(value);
+		*pBytes++ = uint8_t(value >> 8);
+	}
+
+	void Write32(uint8_t*& pBytes, uint32_t value)
+	{
+		Write16(pBytes, uint16_t(value));
+		Write16(pBytes, uint16_t(value >> 16));
+	}
+
+	void WriteFloat(uint8_t*& pBytes, float value)
+	{
+		uint32_t bits{};
+		std::memcpy(&bits, &value, sizeof(bits));
+		Write32(pBytes, bits);
+	}
+
+	uint16_t Read16(const uint8_t*& pBytes)
+	{
+		const uint16_t value{ uint16_t(pBytes[0] | pBytes[1] << 8) };
+		pBytes += 2;
+		return value;
+	}
+
+	uint32_t Read32(const uint8_t*& pBytes)
+	{
+		const uint32_t low{ Read16(pBytes) };
+		return low | uint32_t(Read16(pBytes)) << 16;
+	}
+
+	float ReadFloat(const uint8_t*& pBytes)
+	{
+		const uint32_t bits{ Read32(pBytes) };
+		float value{};
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	//Mouse motion beyond a short does not happen within one frame
+	int16_t ClampToShort(int value)
+	{
+		return int16_t(std::clamp(value, int(INT16_MIN), int(INT16_MAX)));
+	}
+}
+
+void dae::ApplyInputActions(Renderer* pRenderer, uint16_t actions)
+{
+	if (actions == 0)
+		return;
+
+	ToneMapper* pToneMapper{ pRenderer->GetToneMapper() };
+	if (actions & uint16_t(InputAction::ToggleShadows))
+		pRenderer->ToggleShadows();
+	if (actions & uint16_t(InputAction::CycleLightingMode))
+		pRenderer->CycleLightingMode();
+	if (actions & uint16_t(InputAction::ToggleReSTIR))
+		pRenderer->ToggleReSTIR();
+	if (actions & uint16_t(InputAction::ToggleAdaptiveAA))
+		pRenderer->ToggleAdaptiveAA();
+	if (actions & uint16_t(InputAction::ToggleAccumulation))
+		pRenderer->ToggleAccumulation();
+	if (actions & uint16_t(InputAction::ToggleDenoiser))
+		pRenderer->ToggleDenoiser();
+	if (actions & uint16_t(InputAction::CycleToneMapOperator))
+		pToneMapper->CycleOperator();
+	if (actions & uint16_t(InputAction::ToggleSRGB))
+		pToneMapper->ToggleSRGB();
+	if (actions & uint16_t(InputAction::IncreaseExposure))
+		pToneMapper->SetExposure(pToneMapper->GetExposure() + 0.5f);
+	if (actions & uint16_t(InputAction::DecreaseExposure))
+		pToneMapper->SetExposure(pToneMapper->GetExposure() - 0.5f);
+}
+
+#pragma region InputRecorder
+InputRecorder::InputRecorder(const std::string& filename, const std::string& sceneName, uint32_t width, uint32_t height) :
+	m_File{ filename, std::ios::binary | std::ios::trunc }
+{
+	if (!m_File.is_open())
+	{
+		std::cout << "Could not open input recording " << filename << std::endl;
+		return;
+	}
+
+	//Magic, version, scene name length, width, height, scene name
+	const uint16_t nameLength{ uint16_t(std::min(sceneName.size(), size_t(UINT16_MAX))) };
+	uint8_t header[16]{};
+	std::memcpy(header, MAGIC, sizeof(MAGIC));
+	uint8_t* pBytes{ header + sizeof(MAGIC) };
+	Write16(pBytes, VERSION);
+	Write16(pBytes, nameLength);
+	Write32(pBytes, width);
+	Write32(pBytes, height);
+	m_File.write(reinterpret_cast<const char*>(header), sizeof(header));
+	m_File.write(sceneName.data(), nameLength);
+}
+
+void InputRecorder::Record(const InputFrame& frame)
+{
+	if (!m_File.is_open())
+		return;
+
+	const CameraInput& input{ frame.cameraInput };
+	uint16_t buttons{};
+	buttons |= input.moveForward ? MoveForward : 0;
+	buttons |= input.moveBackward ? MoveBackward : 0;
+	buttons |= input.moveRight ? MoveRight : 0;
+	buttons |= input.moveLeft ? MoveLeft : 0;
+	buttons |= input.narrowFov ? NarrowFov : 0;
+	buttons |= input.widenFov ? WidenFov : 0;
+	buttons |= input.sprint ? Sprint : 0;
+	buttons |= input.leftMouseButton ? LeftMouseButton : 0;
+	buttons |= input.rightMouseButton ? RightMouseButton : 0;
+
+	uint8_t bytes[FRAME_SIZE]{};
+	uint8_t* pBytes{ bytes };
+	WriteFloat(pBytes, frame.elapsedTime);
+	WriteFloat(pBytes, frame.totalTime);
+	Write16(pBytes, buttons);
+	Write16(pBytes, uint16_t(ClampToShort(input.mouseX)));
+	Write16(pBytes, uint16_t(ClampToShort(input.mouseY)));
+	Write16(pBytes, frame.actions);
+
+	//16 bytes per frame, cheap enough to flush every time
+	m_File.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+	m_File.flush();
+	++m_FrameCount;
+}
+#pragma endregion
+
+#pragma region InputReplay
+bool InputReplay::Load(const std::string& filename)
+{
+	std::ifstream file{ filename, std::ios::binary };
+	if (!file.is_open())
+		return false;
+
+	uint8_t header[16]{};
+	if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0)
+		return false;
+	const uint8_t* pHeader{ header + sizeof(MAGIC) };
+	if (Read16(pHeader) != VERSION)
+		return false;
+	const uint16_t nameLength{ Read16(pHeader) };
+	m_Width = Read32(pHeader);
+	m_Height = Read32(pHeader);
+	m_SceneName.resize(nameLength);
+	if (!file.read(m_SceneName.data(), nameLength))
+		return false;
+
+	m_Frames.clear();
+	uint8_t bytes[FRAME_SIZE]{};
+	while (file.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+	{
+		const uint8_t* pBytes{ bytes };
+		InputFrame frame{};
+		frame.elapsedTime = ReadFloat(pBytes);
+		frame.totalTime = ReadFloat(pBytes);
+		const uint16_t buttons{ Read16(pBytes) };
+		frame.cameraInput.mouseX = int16_t(Read16(pBytes));
+		frame.cameraInput.mouseY = int16_t(Read16(pBytes));
+		frame.actions = Read16(pBytes);
+
+		CameraInput& input{ frame.cameraInput };
+		input.moveForward = (buttons & MoveForward) != 0;
+		input.moveBackward = (buttons & MoveBackward) != 0;
+		input.moveRight = (buttons & MoveRight) != 0;
+		input.moveLeft = (buttons & MoveLeft) != 0;
+		input.narrowFov = (buttons & NarrowFov) != 0;
+		input.widenFov = (buttons & WidenFov) != 0;
+		input.sprint = (buttons & Sprint) != 0;
+		input.leftMouseButton = (buttons & LeftMouseButton) != 0;
+		input.rightMouseButton = (buttons & RightMouseButton) != 0;
+		m_Frames.push_back(frame);
+	}
+	return true;
+}
+#pragma endregion
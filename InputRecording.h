@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+
+namespace dae
+{
+	class Renderer;
+
+	//Render settings changed by the interactive keys, one bit each so a frame can hold several
+	enum class InputAction : uint16_t
+	{
+		ToggleShadows = 1 << 0,
+		CycleLightingMode = 1 << 1,
+		ToggleReSTIR = 1 << 2,
+		ToggleAdaptiveAA = 1 << 3,
+		ToggleAccumulation = 1 << 4,
+		ToggleDenoiser = 1 << 5,
+		CycleToneMapOperator = 1 << 6,
+		ToggleSRGB = 1 << 7,
+		IncreaseExposure = 1 << 8,
+		DecreaseExposure = 1 << 9
+	};
+
+	inline uint16_t operator|(uint16_t actions, InputAction action) { return uint16_t(actions | uint16_t(action)); }
+	inline uint16_t& operator|=(uint16_t& actions, InputAction action) { return actions = actions | action; }
+
+	//Applies the InputAction bits in declaration order
+	void ApplyInputActions(Renderer* pRenderer, uint16_t actions);
+
+	//Everything one frame of an interactive session depends on
+	struct InputFrame
+	{
+		//Timer values seen by Scene::Update
+		float elapsedTime{};
+		float totalTime{};
+		CameraInput cameraInput{};
+		//InputAction bits, applied before the scene update
+		uint16_t actions{};
+	};
+
+	/**
+	 * \brief Appends and flushes the input of every frame while the session runs, a crashed session keeps every recorded frame.
+	 * The file holds a header with the scene and resolution followed by 16 bytes per frame
+	 */
+	class InputRecorder final
+	{
+	public:
+		//The renderer settings are recorded as changes, so the recording has to start with the renderer defaults.
+		//Streamed meshes are not recorded either, the scene has to be fully loaded (Scene::FinishLoading) like the replay is
+		InputRecorder(const std::string& filename, const std::string& sceneName, uint32_t width, uint32_t height);
+		~InputRecorder() = default;
+
+		InputRecorder(const InputRecorder&) = delete;
+		InputRecorder(InputRecorder&&) noexcept = delete;
+		InputRecorder& operator=(const InputRecorder&) = delete;
+		InputRecorder& operator=(InputRecorder&&) noexcept = delete;
+
+		bool IsOpen() const { return m_File.is_open() && m_File.good(); };
+		void Record(const InputFrame& frame);
+		uint32_t GetFrameCount() const { return m_FrameCount; };
+
+	private:
+		std::ofstream m_File{};
+		uint32_t m_FrameCount{};
+	};
+
+	//Frames of a recorded session, replayed one per rendered frame
+	class InputReplay final
+	{
+	public:
+		//False when the file is missing or not an input recording, a truncated last frame is dropped
+		bool Load(const std::string& filename);
+
+		//Scene file of the session or the name of a built-in scene (W1, W2, W3, W4, Bunny, Stress:...)
+		const std::string& GetSceneName() const { return m_SceneName; };
+		uint32_t GetWidth() const { return m_Width; };
+		uint32_t GetHeight() const { return m_Height; };
+		uint32_t GetFrameCount() const { return uint32_t(m_Frames.size()); };
+		const InputFrame& GetFrame(uint32_t frameIndex) const { return m_Frames[frameIndex]; };
+
+	private:
+		std::string m_SceneName{};
+		uint32_t m_Width{};
+		uint32_t m_Height{};
+		std::vector<InputFrame> m_Frames{};
+	};
+}
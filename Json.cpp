@@ -0,0 +1,221 @@
+#include "Json.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+using namespace dae;
+
+//Protects the recursive parser against hostile input
+constexpr int JSON_MAX_DEPTH{ 128 };
+
+static const char* SkipWhitespace(const char* pCurrent, const char* pEnd)
+{
+	while (pCurrent < pEnd && (*pCurrent == ' ' || *pCurrent == '\t' || *pCurrent == '\n' || *pCurrent == '\r'))
+		++pCurrent;
+	return pCurrent;
+}
+
+static void AppendUTF8(std::string& string, uint32_t codePoint)
+{
+	if (codePoint < 0x80)
+	{
+		string += char(codePoint);
+	}
+	else if (codePoint < 0x800)
+	{
+		string += char(0xC0 | (codePoint >> 6));
+		string += char(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000)
+	{
+		string += char(0xE0 | (codePoint >> 12));
+		string += char(0x80 | ((codePoint >> 6) & 0x3F));
+		string += char(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		string += char(0xF0 | (codePoint >> 18));
+		string += char(0x80 | ((codePoint >> 12) & 0x3F));
+		string += char(0x80 | ((codePoint >> 6) & 0x3F));
+		string += char(0x80 | (codePoint & 0x3F));
+	}
+}
+
+bool JsonValue::Parse(const char* pBegin, const char* pEnd, JsonValue& value)
+{
+	value = {};
+	const char* pCurrent{ ParseValue(pBegin, pEnd, value, 0) };
+	return pCurrent && SkipWhitespace(pCurrent, pEnd) == pEnd;
+}
+
+size_t JsonValue::GetSize() const
+{
+	return m_Type == JsonType::Array ? m_Elements.size() : m_Members.size();
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	static const JsonValue null{};
+	return index < m_Elements.size() ? m_Elements[index] : null;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const
+{
+	static const JsonValue null{};
+	for (const auto& member : m_Members)
+	{
+		if (member.first == key)
+			return member.second;
+	}
+	return null;
+}
+
+const char* JsonValue::ParseString(const char* pCurrent, const char* pEnd, std::string& string)
+{
+	//pCurrent points past the opening quote
+	while (pCurrent < pEnd && *pCurrent != '"')
+	{
+		if (*pCurrent != '\\')
+		{
+			string += *pCurrent++;
+			continue;
+		}
+
+		if (++pCurrent >= pEnd)
+			return nullptr;
+		switch (*pCurrent++)
+		{
+		case '"': string += '"'; break;
+		case '\\': string += '\\'; break;
+		case '/': string += '/'; break;
+		case 'b': string += '\b'; break;
+		case 'f': string += '\f'; break;
+		case 'n': string += '\n'; break;
+		case 'r': string += '\r'; break;
+		case 't': string += '\t'; break;
+		case 'u':
+		{
+			uint32_t codePoint{};
+			if (pEnd - pCurrent < 4 || std::from_chars(pCurrent, pCurrent + 4, codePoint, 16).ptr != pCurrent + 4)
+				return nullptr;
+			pCurrent += 4;
+
+			//Surrogate pair
+			if (codePoint >= 0xD800 && codePoint < 0xDC00 && pEnd - pCurrent >= 6 && pCurrent[0] == '\\' && pCurrent[1] == 'u')
+			{
+				uint32_t lowSurrogate{};
+				if (std::from_chars(pCurrent + 2, pCurrent + 6, lowSurrogate, 16).ptr == pCurrent + 6 && lowSurrogate >= 0xDC00 && lowSurrogate < 0xE000)
+				{
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+					pCurrent += 6;
+				}
+			}
+			AppendUTF8(string, codePoint);
+			break;
+		}
+		default:
+			return nullptr;
+		}
+	}
+	return pCurrent < pEnd ? pCurrent + 1 : nullptr;
+}
+
+const char* JsonValue::ParseValue(const char* pCurrent, const char* pEnd, JsonValue& value, int depth)
+{
+	pCurrent = SkipWhitespace(pCurrent, pEnd);
+	if (pCurrent >= pEnd || depth > JSON_MAX_DEPTH)
+		return nullptr;
+
+	auto matchLiteral = [&](const char* pLiteral)
+	{
+		const size_t length{ strlen(pLiteral) };
+		if (size_t(pEnd - pCurrent) < length || strncmp(pCurrent, pLiteral, length) != 0)
+			return false;
+		pCurrent += length;
+		return true;
+	};
+
+	switch (*pCurrent)
+	{
+	case '{':
+	{
+		value.m_Type = JsonType::Object;
+		pCurrent = SkipWhitespace(pCurrent + 1, pEnd);
+		if (pCurrent < pEnd && *pCurrent == '}')
+			return pCurrent + 1;
+
+		while (pCurrent < pEnd)
+		{
+			pCurrent = SkipWhitespace(pCurrent, pEnd);
+			if (pCurrent >= pEnd || *pCurrent != '"')
+				return nullptr;
+
+			std::pair<std::string, JsonValue> member{};
+			pCurrent = ParseString(pCurrent + 1, pEnd, member.first);
+			if (!pCurrent)
+				return nullptr;
+
+			pCurrent = SkipWhitespace(pCurrent, pEnd);
+			if (pCurrent >= pEnd || *pCurrent != ':')
+				return nullptr;
+
+			pCurrent = ParseValue(pCurrent + 1, pEnd, member.second, depth + 1);
+			if (!pCurrent)
+				return nullptr;
+			value.m_Members.emplace_back(std::move(member));
+
+			pCurrent = SkipWhitespace(pCurrent, pEnd);
+			if (pCurrent < pEnd && *pCurrent == '}')
+				return pCurrent + 1;
+			if (pCurrent >= pEnd || *pCurrent != ',')
+				return nullptr;
+			++pCurrent;
+		}
+		return nullptr;
+	}
+	case '[':
+	{
+		value.m_Type = JsonType::Array;
+		pCurrent = SkipWhitespace(pCurrent + 1, pEnd);
+		if (pCurrent < pEnd && *pCurrent == ']')
+			return pCurrent + 1;
+
+		while (pCurrent < pEnd)
+		{
+			JsonValue element{};
+			pCurrent = ParseValue(pCurrent, pEnd, element, depth + 1);
+			if (!pCurrent)
+				return nullptr;
+			value.m_Elements.emplace_back(std::move(element));
+
+			pCurrent = SkipWhitespace(pCurrent, pEnd);
+			if (pCurrent < pEnd && *pCurrent == ']')
+				return pCurrent + 1;
+			if (pCurrent >= pEnd || *pCurrent != ',')
+				return nullptr;
+			++pCurrent;
+		}
+		return nullptr;
+	}
+	case '"':
+		value.m_Type = JsonType::String;
+		return ParseString(pCurrent + 1, pEnd, value.m_String);
+	case 't':
+		value.m_Type = JsonType::Bool;
+		value.m_Bool = true;
+		return matchLiteral("true") ? pCurrent : nullptr;
+	case 'f':
+		value.m_Type = JsonType::Bool;
+		value.m_Bool = false;
+		return matchLiteral("false") ? pCurrent : nullptr;
+	case 'n':
+		return matchLiteral("null") ? pCurrent : nullptr;
+	default:
+	{
+		value.m_Type = JsonType::Number;
+		const auto result{ std::from_chars(pCurrent, pEnd, value.m_Number) };
+		return result.ec == std::errc{} ? result.ptr : nullptr;
+	}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dae
+{
+	enum class JsonType
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	//Minimal read-only JSON document (UTF-8, no comments), enough for glTF headers and tool output
+	class JsonValue final
+	{
+	public:
+		JsonValue() = default;
+
+		/**
+		 * \brief Parses a complete JSON document
+		 * \param pBegin first character of the document
+		 * \param pEnd one past the last character
+		 * \param value receives the root value
+		 * \return false when the text is not valid JSON
+		 */
+		static bool Parse(const char* pBegin, const char* pEnd, JsonValue& value);
+
+		JsonType GetType() const { return m_Type; };
+		bool IsNull() const { return m_Type == JsonType::Null; };
+
+		bool AsBool(bool fallback = false) const { return m_Type == JsonType::Bool ? m_Bool : fallback; };
+		double AsNumber(double fallback = 0.0) const { return m_Type == JsonType::Number ? m_Number : fallback; };
+		float AsFloat(float fallback = 0.f) const { return m_Type == JsonType::Number ? float(m_Number) : fallback; };
+		int AsInt(int fallback = 0) const { return m_Type == JsonType::Number ? int(m_Number) : fallback; };
+		const std::string& AsString() const { return m_String; };
+
+		//Element count of arrays and objects
+		size_t GetSize() const;
+
+		//Missing elements and members return a null value
+		const JsonValue& operator[](size_t index) const;
+		const JsonValue& operator[](const std::string& key) const;
+		const std::vector<std::pair<std::string, JsonValue>>& GetMembers() const { return m_Members; };
+
+	private:
+		JsonType m_Type{ JsonType::Null };
+		bool m_Bool{};
+		double m_Number{};
+		std::string m_String{};
+		std::vector<JsonValue> m_Elements{};
+		std::vector<std::pair<std::string, JsonValue>> m_Members{};
+
+		static const char* ParseValue(const char* pCurrent, const char* pEnd, JsonValue& value, int depth);
+		static const char* ParseString(const char* pCurrent, const char* pEnd, std::string& string);
+	};
+}
@@ -0,0 +1,121 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+MappedFile::MappedFile(const std::string& filename)
+{
+	Open(filename);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE fileHandle{ CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	m_FileHandle = fileHandle;
+	m_Size = size_t(fileSize.QuadPart);
+
+	//Empty files can't be mapped, but are valid
+	if (m_Size == 0)
+	{
+		m_IsEmpty = true;
+		return true;
+	}
+
+	HANDLE mappingHandle{ CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+	if (!mappingHandle)
+	{
+		Close();
+		return false;
+	}
+	m_MappingHandle = mappingHandle;
+
+	m_pData = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (!m_pData)
+	{
+		Close();
+		return false;
+	}
+#else
+	m_FileDescriptor = open(filename.c_str(), O_RDONLY);
+	if (m_FileDescriptor < 0)
+		return false;
+
+	struct stat fileStatus {};
+	if (fstat(m_FileDescriptor, &fileStatus) != 0)
+	{
+		Close();
+		return false;
+	}
+	m_Size = size_t(fileStatus.st_size);
+
+	//Empty files can't be mapped, but are valid
+	if (m_Size == 0)
+	{
+		m_IsEmpty = true;
+		return true;
+	}
+
+	void* pMapping{ mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0) };
+	if (pMapping == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+	madvise(pMapping, m_Size, MADV_SEQUENTIAL);
+	m_pData = static_cast<const char*>(pMapping);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_MappingHandle)
+		CloseHandle(m_MappingHandle);
+	if (m_FileHandle)
+		CloseHandle(m_FileHandle);
+	m_MappingHandle = nullptr;
+	m_FileHandle = nullptr;
+#else
+	if (m_pData)
+		munmap(const_cast<char*>(m_pData), m_Size);
+	if (m_FileDescriptor >= 0)
+		close(m_FileDescriptor);
+	m_FileDescriptor = -1;
+#endif
+
+	m_pData = nullptr;
+	m_Size = 0;
+	m_IsEmpty = false;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace dae
+{
+	//Read-only memory mapping of a whole file
+	class MappedFile final
+	{
+	public:
+		MappedFile() = default;
+		MappedFile(const std::string& filename);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) noexcept = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+		bool Open(const std::string& filename);
+		void Close();
+
+		bool IsOpen() const { return m_pData != nullptr || m_IsEmpty; };
+		const char* GetData() const { return m_pData; };
+		size_t GetSize() const { return m_Size; };
+
+	private:
+		const char* m_pData{};
+		size_t m_Size{};
+		bool m_IsEmpty{ false };
+
+#if defined(_WIN32)
+		void* m_FileHandle{};
+		void* m_MappingHandle{};
+#else
+		int m_FileDescriptor{ -1 };
+#endif
+	};
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <cstdint>
 #include <float.h>
 
 namespace dae
@@ -26,6 +27,22 @@ namespace dae
 
 	inline bool AreEqual(float a, float b, float epsilon = FLT_EPSILON)
 	{
-		return abs(a - b) < epsilon;
+		return std::abs(a - b) < epsilon;
+	}
+
+	/* --- RANDOM --- */
+	//PCG hash, cheap and well distributed enough to seed per-pixel random streams
+	inline uint32_t PcgHash(uint32_t input)
+	{
+		const uint32_t state{ input * 747796405u + 2891336453u };
+		const uint32_t word{ ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u };
+		return (word >> 22u) ^ word;
+	}
+
+	//Returns a float in [0, 1) and advances the seed
+	inline float RandomFloat(uint32_t& seed)
+	{
+		seed = PcgHash(seed);
+		return float(seed >> 8) / 16777216.f;
 	}
 }
\ No newline at end of file
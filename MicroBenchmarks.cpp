@@ -0,0 +1,545 @@
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "BRDFs.h"
+#include "Utils.h"
+
+using namespace dae;
+
+//Times the intersection, BRDF and math kernels in isolation on seeded random inputs, single threaded.
+//Every kernel runs over the same data set until the time budget is spent, the median batch is reported
+namespace
+{
+	struct MicroBenchmarkOptions
+	{
+		std::string filter{};
+		uint32_t seed{ 1337 };
+		uint32_t operationCount{ 4096 };
+		//Measuring time of every kernel, split over SAMPLE_COUNT batches
+		double timePerKernel{ 0.25 };
+	};
+
+	struct MicroBenchmarkResult
+	{
+		double nanosecondsPerOperation{};
+		double minNanosecondsPerOperation{};
+		//Share of the operations that reported a hit, only meaningful for intersection kernels
+		double hitRate{};
+	};
+
+	constexpr uint32_t SAMPLE_COUNT{ 15 };
+	//Data sets are built to (almost) always hit or miss, anything beyond these limits times the wrong code path
+	constexpr double MIN_HIT_HEAVY_RATE{ 0.9 };
+	constexpr double MAX_MISS_HEAVY_RATE{ 0.1 };
+	//Meshes are large, fewer of them keeps the set closer to what a scene holds
+	constexpr uint32_t MESH_COUNT{ 256 };
+
+	//Results are folded into this so the compiler cannot drop the kernels
+	volatile float g_Sink{};
+
+	enum class RayDistribution
+	{
+		//Rays aimed inside the primitive
+		HitHeavy,
+		//Rays that pass next to the primitive or point away from it
+		MissHeavy
+	};
+
+	const char* GetDistributionName(RayDistribution distribution)
+	{
+		return distribution == RayDistribution::HitHeavy ? "hit" : "miss";
+	}
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: RayTracerMicrobench [options]\n"
+			<< "  --filter <text>    only run kernels whose name contains the text\n"
+			<< "  --seed <n>         seed of the random data sets (1337)\n"
+			<< "  --count <n>        rays, primitives or samples per data set (4096)\n"
+			<< "  --time <seconds>   measuring time per kernel (0.25)" << std::endl;
+	}
+
+	bool ParseOptions(int argc, char* args[], MicroBenchmarkOptions& options)
+	{
+		for (int index{ 1 }; index + 1 < argc; index += 2)
+		{
+			const std::string argument{ args[index] };
+			const std::string value{ args[index + 1] };
+			if (argument == "--filter")
+				options.filter = value;
+			else if (argument == "--seed")
+				options.seed = uint32_t(std::strtoul(value.c_str(), nullptr, 10));
+			else if (argument == "--count")
+				options.operationCount = uint32_t(std::max(1, std::atoi(value.c_str())));
+			else if (argument == "--time")
+				options.timePerKernel = std::max(0.001, std::atof(value.c_str()));
+			else
+				return false;
+		}
+		return argc % 2 == 1;
+	}
+
+#pragma region Data Sets
+	class RandomGenerator final
+	{
+	public:
+		explicit RandomGenerator(uint32_t seed) : m_Engine{ seed } {}
+
+		float Range(float min, float max)
+		{
+			return std::uniform_real_distribution<float>{ min, max }(m_Engine);
+		}
+
+		Vector3 InBox(float extent)
+		{
+			return { Range(-extent, extent), Range(-extent, extent), Range(-extent, extent) };
+		}
+
+		Vector3 UnitVector()
+		{
+			std::normal_distribution<float> distribution{};
+			Vector3 vector{};
+			do
+			{
+				vector = { distribution(m_Engine), distribution(m_Engine), distribution(m_Engine) };
+			} while (vector.SqrMagnitude() < 1e-6f);
+			return vector.Normalized();
+		}
+
+		//Unit vector on the side of the hemisphere the normal points to
+		Vector3 InHemisphere(const Vector3& normal)
+		{
+			const Vector3 vector{ UnitVector() };
+			return Vector3::Dot(vector, normal) < 0.f ? -vector : vector;
+		}
+
+		//Unit vector perpendicular to the given direction
+		Vector3 Perpendicular(const Vector3& direction)
+		{
+			Vector3 vector{};
+			do
+			{
+				vector = Vector3::Cross(direction, UnitVector());
+			} while (vector.SqrMagnitude() < 1e-6f);
+			return vector.Normalized();
+		}
+
+	private:
+		std::mt19937 m_Engine;
+	};
+
+	//Ray towards a point inside a bounding sphere, or one that passes the sphere at a distance of at least its radius
+	Ray CreateRayTowards(RandomGenerator& random, const Vector3& center, float radius, RayDistribution distribution)
+	{
+		const Vector3 origin{ center + random.UnitVector() * random.Range(10.f, 50.f) };
+		const Vector3 toCenter{ (center - origin).Normalized() };
+		const float offset{ distribution == RayDistribution::HitHeavy ? random.Range(0.f, 0.9f) : random.Range(1.1f, 3.f) };
+		const Vector3 target{ center + random.Perpendicular(toCenter) * (offset * radius) };
+		return Ray{ origin, (target - origin).Normalized() };
+	}
+
+	std::vector<Sphere> CreateSpheres(RandomGenerator& random, uint32_t count)
+	{
+		std::vector<Sphere> spheres(count);
+		for (Sphere& sphere : spheres)
+		{
+			sphere.origin = random.InBox(5.f);
+			sphere.radius = random.Range(0.5f, 1.5f);
+		}
+		return spheres;
+	}
+
+	std::vector<Ray> CreateSphereRays(RandomGenerator& random, const std::vector<Sphere>& spheres, RayDistribution distribution)
+	{
+		std::vector<Ray> rays(spheres.size());
+		for (size_t index{}; index < rays.size(); ++index)
+			rays[index] = CreateRayTowards(random, spheres[index].origin, spheres[index].radius, distribution);
+		return rays;
+	}
+
+	std::vector<Plane> CreatePlanes(RandomGenerator& random, uint32_t count)
+	{
+		std::vector<Plane> planes(count);
+		for (Plane& plane : planes)
+		{
+			plane.origin = random.InBox(5.f);
+			plane.normal = random.UnitVector();
+		}
+		return planes;
+	}
+
+	//Rays start in front of the plane and point towards it, or away from it
+	std::vector<Ray> CreatePlaneRays(RandomGenerator& random, const std::vector<Plane>& planes, RayDistribution distribution)
+	{
+		std::vector<Ray> rays(planes.size());
+		for (size_t index{}; index < rays.size(); ++index)
+		{
+			const Plane& plane{ planes[index] };
+			const Vector3 direction{ random.InHemisphere(plane.normal) };
+			rays[index].origin = plane.origin + random.Perpendicular(plane.normal) * random.Range(0.f, 5.f) + plane.normal * random.Range(0.5f, 20.f);
+			rays[index].direction = distribution == RayDistribution::HitHeavy ? -direction : direction;
+		}
+		return rays;
+	}
+
+	std::vector<Triangle> CreateTriangles(RandomGenerator& random, uint32_t count)
+	{
+		std::vector<Triangle> triangles(count);
+		for (Triangle& triangle : triangles)
+		{
+			const Vector3 center{ random.InBox(5.f) };
+			triangle = Triangle{ center + random.InBox(1.f), center + random.InBox(1.f), center + random.InBox(1.f) };
+			triangle.cullMode = TriangleCullMode::BackFaceCulling;
+		}
+		return triangles;
+	}
+
+	//Rays come from the front face and aim at a point of the triangle plane, inside the triangle or outside of it.
+	//The shadow ray overload mirrors the cull mode, its rays come from the back face
+	std::vector<Ray> CreateTriangleRays(RandomGenerator& random, const std::vector<Triangle>& triangles, RayDistribution distribution, bool isShadowRay)
+	{
+		std::vector<Ray> rays(triangles.size());
+		for (size_t index{}; index < rays.size(); ++index)
+		{
+			const Triangle& triangle{ triangles[index] };
+			float u{ random.Range(0.05f, 0.9f) };
+			float v{ random.Range(0.05f, 0.9f) };
+			if (distribution == RayDistribution::HitHeavy && u + v > 0.95f)
+			{
+				u = 0.95f - u;
+				v = 0.95f - v;
+			}
+			else if (distribution == RayDistribution::MissHeavy && u + v < 1.05f)
+			{
+				u += 1.05f;
+			}
+			const Vector3 target{ triangle.v0 + (triangle.v1 - triangle.v0) * u + (triangle.v2 - triangle.v0) * v };
+			const Vector3 backDirection{ random.InHemisphere(triangle.normal) };
+			const Vector3 direction{ isShadowRay ? backDirection : -backDirection };
+			rays[index] = Ray{ target - direction * random.Range(1.f, 20.f), direction };
+		}
+		return rays;
+	}
+
+	std::vector<TriangleMesh> CreateMeshBounds(RandomGenerator& random, uint32_t count)
+	{
+		std::vector<TriangleMesh> meshes(count);
+		for (TriangleMesh& mesh : meshes)
+		{
+			const Vector3 center{ random.InBox(5.f) };
+			const Vector3 halfExtent{ random.Range(0.25f, 2.f), random.Range(0.25f, 2.f), random.Range(0.25f, 2.f) };
+			mesh.transformedMinAABB = center - halfExtent;
+			mesh.transformedMaxAABB = center + halfExtent;
+		}
+		return meshes;
+	}
+
+	//Hit-heavy rays aim inside the box, miss-heavy rays pass outside of its bounding sphere
+	std::vector<Ray> CreateMeshRays(RandomGenerator& random, const std::vector<TriangleMesh>& meshes, uint32_t count, RayDistribution distribution)
+	{
+		std::vector<Ray> rays(count);
+		for (size_t index{}; index < rays.size(); ++index)
+		{
+			const TriangleMesh& mesh{ meshes[index % meshes.size()] };
+			const Vector3 center{ (mesh.transformedMinAABB + mesh.transformedMaxAABB) * 0.5f };
+			const Vector3 halfExtent{ (mesh.transformedMaxAABB - mesh.transformedMinAABB) * 0.5f };
+			const float innerRadius{ std::min({ halfExtent.x, halfExtent.y, halfExtent.z }) };
+			rays[index] = CreateRayTowards(random, center, distribution == RayDistribution::HitHeavy ? innerRadius : halfExtent.Magnitude(), distribution);
+		}
+		return rays;
+	}
+
+	struct ShadingSample
+	{
+		Vector3 normal{};
+		Vector3 view{};
+		Vector3 light{};
+		Vector3 halfVector{};
+		ColorRGB color{};
+		float roughness{};
+		float specular{};
+		float exponent{};
+	};
+
+	//View and light directions in the hemisphere of the normal, as the shading code sees them
+	std::vector<ShadingSample> CreateShadingSamples(RandomGenerator& random, uint32_t count)
+	{
+		std::vector<ShadingSample> samples(count);
+		for (ShadingSample& sample : samples)
+		{
+			sample.normal = random.UnitVector();
+			sample.view = random.InHemisphere(sample.normal);
+			sample.light = random.InHemisphere(sample.normal);
+			sample.halfVector = (sample.view + sample.light).Normalized();
+			sample.color = { random.Range(0.f, 1.f), random.Range(0.f, 1.f), random.Range(0.f, 1.f) };
+			sample.roughness = random.Range(0.05f, 1.f);
+			sample.specular = random.Range(0.f, 1.f);
+			sample.exponent = random.Range(1.f, 60.f);
+		}
+		return samples;
+	}
+#pragma endregion
+
+#pragma region Measuring
+	//One pass runs the kernel once for every element of its data set and returns the number of hits
+	MicroBenchmarkResult Measure(uint32_t operationCount, double timePerKernel, const std::function<uint32_t()>& runPass)
+	{
+		using Clock = std::chrono::steady_clock;
+		const auto getSeconds = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+
+		//Warms the caches and finds how many passes fill one batch
+		uint32_t hitCount{ runPass() };
+		const auto calibrationStart{ Clock::now() };
+		uint32_t calibrationPassCount{};
+		while (calibrationPassCount == 0 || getSeconds(calibrationStart) < 0.01)
+		{
+			runPass();
+			++calibrationPassCount;
+		}
+		const double secondsPerPass{ getSeconds(calibrationStart) / calibrationPassCount };
+		const uint32_t passesPerBatch{ std::max(1u, uint32_t(timePerKernel / SAMPLE_COUNT / secondsPerPass)) };
+
+		std::vector<double> batchTimes(SAMPLE_COUNT);
+		for (double& batchTime : batchTimes)
+		{
+			const auto batchStart{ Clock::now() };
+			for (uint32_t pass{}; pass < passesPerBatch; ++pass)
+				g_Sink = g_Sink + float(runPass());
+			batchTime = getSeconds(batchStart);
+		}
+		std::sort(batchTimes.begin(), batchTimes.end());
+
+		const double operationsPerBatch{ double(passesPerBatch) * operationCount };
+		MicroBenchmarkResult result{};
+		result.nanosecondsPerOperation = batchTimes[SAMPLE_COUNT / 2] * 1e9 / operationsPerBatch;
+		result.minNanosecondsPerOperation = batchTimes.front() * 1e9 / operationsPerBatch;
+		result.hitRate = double(hitCount) / operationCount;
+		return result;
+	}
+
+	class MicroBenchmarkSuite final
+	{
+	public:
+		explicit MicroBenchmarkSuite(const MicroBenchmarkOptions& options) : m_Options{ options }
+		{
+			std::cout << std::left << std::setw(40) << "kernel" << std::setw(8) << "rays"
+				<< std::right << std::setw(10) << "ns/op" << std::setw(10) << "min ns" << std::setw(12) << "Mops/s" << std::setw(8) << "hits" << "\n";
+		}
+
+		//rays/s is the same number as ops/s for intersection kernels, hits are only printed and checked for them
+		void Run(const std::string& kernelName, const char* distributionName, uint32_t operationCount, const std::function<uint32_t()>& runPass)
+		{
+			if (!m_Options.filter.empty() && kernelName.find(m_Options.filter) == std::string::npos)
+				return;
+
+			const MicroBenchmarkResult result{ Measure(operationCount, m_Options.timePerKernel, runPass) };
+			std::cout << std::left << std::setw(40) << kernelName << std::setw(8) << distributionName << std::right << std::fixed
+				<< std::setprecision(2) << std::setw(10) << result.nanosecondsPerOperation << std::setw(10) << result.minNanosecondsPerOperation
+				<< std::setw(12) << 1e3 / result.nanosecondsPerOperation;
+			if (distributionName[0] != '-')
+				std::cout << std::setw(7) << std::setprecision(1) << result.hitRate * 100.0 << "%";
+			std::cout << std::defaultfloat << std::endl;
+
+			const bool isHitHeavy{ distributionName == std::string{ GetDistributionName(RayDistribution::HitHeavy) } };
+			const bool isMissHeavy{ distributionName == std::string{ GetDistributionName(RayDistribution::MissHeavy) } };
+			if ((isHitHeavy && result.hitRate < MIN_HIT_HEAVY_RATE) || (isMissHeavy && result.hitRate > MAX_MISS_HEAVY_RATE))
+			{
+				std::cout << "FAIL " << kernelName << ": " << result.hitRate * 100.0 << "% hits on the " << distributionName
+					<< " set, expected " << (isHitHeavy ? "at least " : "at most ") << (isHitHeavy ? MIN_HIT_HEAVY_RATE : MAX_MISS_HEAVY_RATE) * 100.0 << "%" << std::endl;
+				++m_FailureCount;
+			}
+		}
+
+		//Kernels whose hit rate did not match their data set, the timings of those are meaningless
+		uint32_t GetFailureCount() const { return m_FailureCount; };
+
+	private:
+		MicroBenchmarkOptions m_Options{};
+		uint32_t m_FailureCount{};
+	};
+#pragma endregion
+
+#pragma region Kernels
+	void RunIntersectionKernels(MicroBenchmarkSuite& suite, RandomGenerator& random, uint32_t count)
+	{
+		const std::vector<Sphere> spheres{ CreateSpheres(random, count) };
+		const std::vector<Plane> planes{ CreatePlanes(random, count) };
+		const std::vector<Triangle> triangles{ CreateTriangles(random, count) };
+		const std::vector<TriangleMesh> meshes{ CreateMeshBounds(random, std::min(count, MESH_COUNT)) };
+
+		for (const RayDistribution distribution : { RayDistribution::HitHeavy, RayDistribution::MissHeavy })
+		{
+			const char* distributionName{ GetDistributionName(distribution) };
+			const std::vector<Ray> sphereRays{ CreateSphereRays(random, spheres, distribution) };
+			const std::vector<Ray> planeRays{ CreatePlaneRays(random, planes, distribution) };
+			const std::vector<Ray> triangleRays{ CreateTriangleRays(random, triangles, distribution, false) };
+			const std::vector<Ray> triangleShadowRays{ CreateTriangleRays(random, triangles, distribution, true) };
+			const std::vector<Ray> meshRays{ CreateMeshRays(random, meshes, count, distribution) };
+
+			//Closest-hit tests fill a hit record per ray, any-hit tests are the shadow ray overloads
+			suite.Run("GeometryUtils::HitTest_Sphere", distributionName, count, [&]()
+				{
+					uint32_t hitCount{};
+					for (uint32_t index{}; index < count; ++index)
+					{
+						HitRecord hitRecord{};
+						hitCount += GeometryUtils::HitTest_Sphere(spheres[index], sphereRays[index], hitRecord);
+					}
+					return hitCount;
+				});
+			suite.Run("GeometryUtils::HitTest_Sphere (any)", distributionName, count, [&]()
+				{
+					uint32_t hitCount{};
+					for (uint32_t index{}; index < count; ++index)
+						hitCount += GeometryUtils::HitTest_Sphere(spheres[index], sphereRays[index]);
+					return hitCount;
+				});
+			suite.Run("GeometryUtils::HitTest_Plane", distributionName, count, [&]()
+				{
+					uint32_t hitCount{};
+					for (uint32_t index{}; index < count; ++index)
+					{
+						HitRecord hitRecord{};
+						hitCount += GeometryUtils::HitTest_Plane(planes[index], planeRays[index], hitRecord);
+					}
+					return hitCount;
+				});
+			suite.Run("GeometryUtils::HitTest_Plane (any)", distributionName, count, [&]()
+				{
+					uint32_t hitCount{};
+					for (uint32_t index{}; index < count; ++index)
+						hitCount += GeometryUtils::HitTest_Plane(planes[index], planeRays[index]);
+					return hitCount;
+				});
+			suite.Run("GeometryUtils::HitTest_Triangle", distributionName, count, [&]()
+				{
+					uint32_t hitCount{};
+					for (uint32_t index{}; index < count; ++index)
+					{
+						HitRecord hitRecord{};
+						hitCount += GeometryUtils::HitTest_Triangle(triangles[index], triangleRays[index], hitRecord);
+					}
+					return hitCount;
+				});
+			suite.Run("GeometryUtils::HitTest_Triangle (any)", distributionName, count, [&]()
+				{
+					uint32_t hitCount{};
+					for (uint32_t index{}; index < count; ++index)
+						hitCount += GeometryUtils::HitTest_Triangle(triangles[index], triangleShadowRays[index]);
+					return hitCount;
+				});
+			suite.Run("GeometryUtils::SlabTest_TriangleMesh", distributionName, count, [&]()
+				{
+					uint32_t hitCount{};
+					for (uint32_t index{}; index < count; ++index)
+						hitCount += GeometryUtils::SlabTest_TriangleMesh(meshes[index % meshes.size()], meshRays[index]);
+					return hitCount;
+				});
+		}
+	}
+
+	void RunShadingKernels(MicroBenchmarkSuite& suite, RandomGenerator& random, uint32_t count)
+	{
+		const std::vector<ShadingSample> samples{ CreateShadingSamples(random, count) };
+		//The kernel is a template argument so it is inlined into the loop like in the shading code
+		const auto runShadingPass = [&samples](auto evaluate)
+		{
+			return [&samples, evaluate]()
+			{
+				float sum{};
+				for (const ShadingSample& sample : samples)
+					sum += evaluate(sample);
+				g_Sink = g_Sink + sum;
+				return 0u;
+			};
+		};
+
+		suite.Run("BRDF::Lambert", "-", count, runShadingPass([](const ShadingSample& sample)
+			{
+				return BRDF::Lambert(sample.specular, sample.color).r;
+			}));
+		suite.Run("BRDF::Phong", "-", count, runShadingPass([](const ShadingSample& sample)
+			{
+				return BRDF::Phong(sample.specular, sample.exponent, sample.light, sample.view, sample.normal).r;
+			}));
+		suite.Run("BRDF::FresnelFunction_Schlick", "-", count, runShadingPass([](const ShadingSample& sample)
+			{
+				return BRDF::FresnelFunction_Schlick(sample.halfVector, sample.view, sample.color).r;
+			}));
+		suite.Run("BRDF::NormalDistribution_GGX", "-", count, runShadingPass([](const ShadingSample& sample)
+			{
+				return BRDF::NormalDistribution_GGX(sample.normal, sample.halfVector, sample.roughness);
+			}));
+		suite.Run("BRDF::GeometryFunction_SchlickGGX", "-", count, runShadingPass([](const ShadingSample& sample)
+			{
+				return BRDF::GeometryFunction_SchlickGGX(sample.normal, sample.view, sample.roughness);
+			}));
+		suite.Run("BRDF::GeometryFunction_Smith", "-", count, runShadingPass([](const ShadingSample& sample)
+			{
+				return BRDF::GeometryFunction_Smith(sample.normal, sample.view, sample.light, sample.roughness);
+			}));
+	}
+
+	void RunMathKernels(MicroBenchmarkSuite& suite, RandomGenerator& random, uint32_t count)
+	{
+		std::vector<Matrix> matrices(count);
+		std::vector<Vector3> points(count);
+		for (uint32_t index{}; index < count; ++index)
+		{
+			matrices[index] = Matrix::CreateScale(random.Range(0.5f, 2.f), random.Range(0.5f, 2.f), random.Range(0.5f, 2.f))
+				* Matrix::CreateRotation(random.Range(0.f, PI_2), random.Range(0.f, PI_2), random.Range(0.f, PI_2))
+				* Matrix::CreateTranslation(random.InBox(10.f));
+			points[index] = random.InBox(10.f);
+		}
+
+		suite.Run("Matrix::TransformPoint", "-", count, [&]()
+			{
+				Vector3 sum{};
+				for (uint32_t index{}; index < count; ++index)
+					sum += matrices[index].TransformPoint(points[index]);
+				g_Sink = g_Sink + sum.x + sum.y + sum.z;
+				return 0u;
+			});
+	}
+#pragma endregion
+}
+
+int main(int argc, char* args[])
+{
+	MicroBenchmarkOptions options{};
+	if (!ParseOptions(argc, args, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+#if !defined(NDEBUG)
+	std::cout << "Debug build, timings are not representative" << std::endl;
+#endif
+	std::cout << "Seed " << options.seed << ", " << options.operationCount << " operations per pass" << std::endl;
+
+	//Every kernel group draws from its own generator, so filtering never changes the data a kernel sees
+	MicroBenchmarkSuite suite{ options };
+	RandomGenerator intersectionRandom{ options.seed };
+	RunIntersectionKernels(suite, intersectionRandom, options.operationCount);
+	RandomGenerator shadingRandom{ options.seed + 1 };
+	RunShadingKernels(suite, shadingRandom, options.operationCount);
+	RandomGenerator mathRandom{ options.seed + 2 };
+	RunMathKernels(suite, mathRandom, options.operationCount);
+
+	if (suite.GetFailureCount() > 0)
+	{
+		std::cout << suite.GetFailureCount() << " kernels did not hit as often as their data set should" << std::endl;
+		return 1;
+	}
+	return 0;
+}
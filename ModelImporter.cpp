@@ -0,0 +1,659 @@
+#include "ModelImporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string_view>
+
+#include "Json.h"
+#include "MappedFile.h"
+
+namespace dae
+{
+	namespace Utils
+	{
+		static void CalculateFaceNormals(const std::vector<Vector3>& positions, const std::vector<int>& indices, std::vector<Vector3>& normals)
+		{
+			normals.resize(indices.size() / 3);
+			for (size_t triangle{}; triangle < normals.size(); ++triangle)
+			{
+				const Vector3& v0{ positions[indices[triangle * 3]] };
+				const Vector3 normal{ Vector3::Cross(positions[indices[triangle * 3 + 1]] - v0, positions[indices[triangle * 3 + 2]] - v0) };
+
+				//Degenerate triangles keep a zero normal
+				const float length{ normal.Magnitude() };
+				normals[triangle] = length > 0.f ? normal / length : Vector3::Zero;
+			}
+		}
+
+		static bool ValidateIndices(const std::string& filename, const std::vector<int>& indices, size_t positionCount)
+		{
+			const bool isValid{ std::all_of(indices.begin(), indices.end(), [&](int index) { return index >= 0 && size_t(index) < positionCount; }) };
+			if (!isValid)
+				std::cout << "Failed to parse " << filename << ": vertex index out of range" << std::endl;
+			return isValid;
+		}
+
+#pragma region PLY
+		enum class PLYType
+		{
+			Int8,
+			UInt8,
+			Int16,
+			UInt16,
+			Int32,
+			UInt32,
+			Float32,
+			Float64,
+			Invalid
+		};
+
+		struct PLYProperty
+		{
+			std::string name{};
+			PLYType type{ PLYType::Invalid };
+			PLYType countType{ PLYType::Invalid }; //Only valid for list properties
+		};
+
+		struct PLYElement
+		{
+			std::string name{};
+			size_t count{};
+			std::vector<PLYProperty> properties{};
+		};
+
+		static PLYType GetPLYType(const std::string& name)
+		{
+			if (name == "char" || name == "int8") return PLYType::Int8;
+			if (name == "uchar" || name == "uint8") return PLYType::UInt8;
+			if (name == "short" || name == "int16") return PLYType::Int16;
+			if (name == "ushort" || name == "uint16") return PLYType::UInt16;
+			if (name == "int" || name == "int32") return PLYType::Int32;
+			if (name == "uint" || name == "uint32") return PLYType::UInt32;
+			if (name == "float" || name == "float32") return PLYType::Float32;
+			if (name == "double" || name == "float64") return PLYType::Float64;
+			return PLYType::Invalid;
+		}
+
+		static size_t GetPLYTypeSize(PLYType type)
+		{
+			switch (type)
+			{
+			case PLYType::Int8:
+			case PLYType::UInt8:
+				return 1;
+			case PLYType::Int16:
+			case PLYType::UInt16:
+				return 2;
+			case PLYType::Int32:
+			case PLYType::UInt32:
+			case PLYType::Float32:
+				return 4;
+			case PLYType::Float64:
+				return 8;
+			default:
+				return 0;
+			}
+		}
+
+		template<typename T>
+		static double ReadPLYValue(const char* pData, bool isBigEndian)
+		{
+			char bytes[sizeof(T)]{};
+			std::memcpy(bytes, pData, sizeof(T));
+			if (isBigEndian)
+				std::reverse(bytes, bytes + sizeof(T));
+
+			T value{};
+			std::memcpy(&value, bytes, sizeof(T));
+			return double(value);
+		}
+
+		static double ReadPLYValue(const char* pData, PLYType type, bool isBigEndian)
+		{
+			switch (type)
+			{
+			case PLYType::Int8: return ReadPLYValue<int8_t>(pData, isBigEndian);
+			case PLYType::UInt8: return ReadPLYValue<uint8_t>(pData, isBigEndian);
+			case PLYType::Int16: return ReadPLYValue<int16_t>(pData, isBigEndian);
+			case PLYType::UInt16: return ReadPLYValue<uint16_t>(pData, isBigEndian);
+			case PLYType::Int32: return ReadPLYValue<int32_t>(pData, isBigEndian);
+			case PLYType::UInt32: return ReadPLYValue<uint32_t>(pData, isBigEndian);
+			case PLYType::Float32: return ReadPLYValue<float>(pData, isBigEndian);
+			case PLYType::Float64: return ReadPLYValue<double>(pData, isBigEndian);
+			default: return 0.0;
+			}
+		}
+
+		static bool ParsePLYHeader(std::string_view header, std::vector<PLYElement>& elements, bool& isBigEndian)
+		{
+			std::istringstream lines{ std::string{ header } };
+			std::string line{};
+			while (std::getline(lines, line))
+			{
+				std::istringstream words{ line };
+				std::string keyword{};
+				words >> keyword;
+
+				if (keyword == "format")
+				{
+					std::string format{};
+					words >> format;
+					if (format != "binary_little_endian" && format != "binary_big_endian")
+						return false;
+					isBigEndian = format == "binary_big_endian";
+				}
+				else if (keyword == "element")
+				{
+					PLYElement element{};
+					words >> element.name >> element.count;
+					elements.emplace_back(std::move(element));
+				}
+				else if (keyword == "property")
+				{
+					if (elements.empty())
+						return false;
+
+					std::string typeName{};
+					words >> typeName;
+
+					PLYProperty property{};
+					if (typeName == "list")
+					{
+						std::string countTypeName{}, itemTypeName{};
+						words >> countTypeName >> itemTypeName >> property.name;
+						property.countType = GetPLYType(countTypeName);
+						property.type = GetPLYType(itemTypeName);
+						if (property.countType == PLYType::Invalid)
+							return false;
+					}
+					else
+					{
+						property.type = GetPLYType(typeName);
+						words >> property.name;
+					}
+
+					if (property.type == PLYType::Invalid)
+						return false;
+					elements.back().properties.emplace_back(std::move(property));
+				}
+			}
+			return true;
+		}
+
+		bool ParsePLY(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		{
+			const auto startTime{ std::chrono::steady_clock::now() };
+
+			const MappedFile file{ filename };
+			if (!file.IsOpen())
+				return false;
+
+			const std::string_view contents{ file.GetData(), file.GetSize() };
+			const size_t headerEnd{ contents.find("end_header") };
+			const size_t dataOffset{ headerEnd == std::string_view::npos ? headerEnd : contents.find('\n', headerEnd) };
+			if (contents.substr(0, 3) != "ply" || dataOffset == std::string_view::npos)
+			{
+				std::cout << "Failed to parse " << filename << ": not a PLY file" << std::endl;
+				return false;
+			}
+
+			std::vector<PLYElement> elements{};
+			bool isBigEndian{};
+			if (!ParsePLYHeader(contents.substr(0, headerEnd), elements, isBigEndian))
+			{
+				std::cout << "Failed to parse " << filename << ": unsupported header, only binary PLY is supported" << std::endl;
+				return false;
+			}
+
+			positions.clear();
+			indices.clear();
+
+			const char* pCurrent{ file.GetData() + dataOffset + 1 };
+			const char* pEnd{ file.GetData() + file.GetSize() };
+			auto hasBytes = [&](size_t size) { return size <= size_t(pEnd - pCurrent); };
+
+			for (const PLYElement& element : elements)
+			{
+				const bool hasLists{ std::any_of(element.properties.begin(), element.properties.end(),
+					[](const PLYProperty& property) { return property.countType != PLYType::Invalid; }) };
+
+				if (element.name == "vertex" && !hasLists)
+				{
+					size_t vertexSize{};
+					size_t offsets[3]{ SIZE_MAX, SIZE_MAX, SIZE_MAX };
+					PLYType types[3]{};
+					for (const PLYProperty& property : element.properties)
+					{
+						const int axis{ property.name == "x" ? 0 : property.name == "y" ? 1 : property.name == "z" ? 2 : -1 };
+						if (axis >= 0)
+						{
+							offsets[axis] = vertexSize;
+							types[axis] = property.type;
+						}
+						vertexSize += GetPLYTypeSize(property.type);
+					}
+
+					if (std::find(std::begin(offsets), std::end(offsets), SIZE_MAX) != std::end(offsets) || element.count > size_t(pEnd - pCurrent) / vertexSize)
+						return false;
+
+					//Tightly packed little endian float positions are copied as one block
+					positions.resize(element.count);
+					const bool isPacked{ !isBigEndian && vertexSize == sizeof(Vector3) && offsets[0] == 0 && offsets[1] == 4 && offsets[2] == 8
+						&& types[0] == PLYType::Float32 && types[1] == PLYType::Float32 && types[2] == PLYType::Float32 };
+					if (isPacked)
+					{
+						std::memcpy(positions.data(), pCurrent, element.count * sizeof(Vector3));
+					}
+					else
+					{
+						for (size_t vertex{}; vertex < element.count; ++vertex)
+						{
+							for (int axis{}; axis < 3; ++axis)
+								positions[vertex][axis] = float(ReadPLYValue(pCurrent + vertex * vertexSize + offsets[axis], types[axis], isBigEndian));
+						}
+					}
+					pCurrent += element.count * vertexSize;
+					continue;
+				}
+
+				//Record by record, every face is a fan of the vertex index list
+				const bool isFace{ element.name == "face" };
+				std::vector<int> polygon{};
+				for (size_t record{}; record < element.count; ++record)
+				{
+					for (const PLYProperty& property : element.properties)
+					{
+						const size_t valueSize{ GetPLYTypeSize(property.type) };
+						if (property.countType == PLYType::Invalid)
+						{
+							if (!hasBytes(valueSize))
+								return false;
+							pCurrent += valueSize;
+							continue;
+						}
+
+						const size_t countSize{ GetPLYTypeSize(property.countType) };
+						if (!hasBytes(countSize))
+							return false;
+						const double count{ ReadPLYValue(pCurrent, property.countType, isBigEndian) };
+						pCurrent += countSize;
+						if (count < 0.0 || !hasBytes(size_t(count) * valueSize))
+							return false;
+
+						if (isFace && (property.name == "vertex_indices" || property.name == "vertex_index"))
+						{
+							polygon.resize(size_t(count));
+							for (int& index : polygon)
+							{
+								index = int(ReadPLYValue(pCurrent, property.type, isBigEndian));
+								pCurrent += valueSize;
+							}
+							for (size_t corner{ 1 }; corner + 1 < polygon.size(); ++corner)
+							{
+								indices.push_back(polygon[0]);
+								indices.push_back(polygon[corner]);
+								indices.push_back(polygon[corner + 1]);
+							}
+						}
+						else
+						{
+							pCurrent += size_t(count) * valueSize;
+						}
+					}
+				}
+			}
+
+			if (!ValidateIndices(filename, indices, positions.size()))
+				return false;
+			CalculateFaceNormals(positions, indices, normals);
+
+			const float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count() };
+			std::cout << "Loaded " << filename << ": " << positions.size() << " vertices, " << normals.size() << " triangles in "
+				<< seconds * 1000.f << " ms" << std::endl;
+			return true;
+		}
+#pragma endregion
+#pragma region GLB
+		constexpr uint32_t GLB_MAGIC{ 0x46546C67 }; //"glTF"
+		constexpr uint32_t GLB_CHUNK_JSON{ 0x4E4F534A };
+		constexpr uint32_t GLB_CHUNK_BIN{ 0x004E4942 };
+		constexpr int GLTF_MAX_NODE_DEPTH{ 64 };
+
+		constexpr int GLTF_UNSIGNED_BYTE{ 5121 };
+		constexpr int GLTF_UNSIGNED_SHORT{ 5123 };
+		constexpr int GLTF_UNSIGNED_INT{ 5125 };
+		constexpr int GLTF_FLOAT{ 5126 };
+		constexpr int GLTF_TRIANGLES{ 4 };
+
+		//Resolved accessor, pData points into the mapped binary chunk
+		struct GLTFAccessor
+		{
+			const char* pData{};
+			size_t count{};
+			size_t stride{};
+			int componentType{};
+			int componentCount{};
+		};
+
+		struct GLTFDocument
+		{
+			JsonValue json{};
+			const char* pBinary{};
+			size_t binarySize{};
+		};
+
+		static bool GetAccessor(const GLTFDocument& document, int accessorIndex, GLTFAccessor& accessor)
+		{
+			const JsonValue& accessorJson{ document.json["accessors"][size_t(accessorIndex)] };
+			if (accessorJson.IsNull() || !accessorJson["sparse"].IsNull())
+				return false;
+
+			const JsonValue& view{ document.json["bufferViews"][size_t(accessorJson["bufferView"].AsInt(-1))] };
+			if (view.IsNull() || view["buffer"].AsInt() != 0)
+				return false;
+
+			const std::string& type{ accessorJson["type"].AsString() };
+			accessor.componentCount = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+			accessor.componentType = accessorJson["componentType"].AsInt();
+
+			size_t componentSize{};
+			switch (accessor.componentType)
+			{
+			case GLTF_UNSIGNED_BYTE: componentSize = 1; break;
+			case GLTF_UNSIGNED_SHORT: componentSize = 2; break;
+			case GLTF_UNSIGNED_INT:
+			case GLTF_FLOAT: componentSize = 4; break;
+			default: return false;
+			}
+
+			const size_t elementSize{ componentSize * accessor.componentCount };
+			const size_t viewOffset{ size_t(view["byteOffset"].AsNumber()) };
+			const size_t viewLength{ size_t(view["byteLength"].AsNumber()) };
+			const size_t accessorOffset{ size_t(accessorJson["byteOffset"].AsNumber()) };
+			accessor.count = size_t(accessorJson["count"].AsNumber());
+			accessor.stride = view["byteStride"].IsNull() ? elementSize : size_t(view["byteStride"].AsNumber());
+
+			if (elementSize == 0 || accessor.stride < elementSize || viewOffset > document.binarySize || viewLength > document.binarySize - viewOffset
+				|| accessorOffset > viewLength)
+				return false;
+			if (accessor.count > 0 && (accessor.count - 1 > (viewLength - accessorOffset) / accessor.stride
+				|| (accessor.count - 1) * accessor.stride + elementSize > viewLength - accessorOffset))
+				return false;
+
+			accessor.pData = document.pBinary + viewOffset + accessorOffset;
+			return true;
+		}
+
+		static bool ReadPositions(const GLTFAccessor& accessor, std::vector<Vector3>& positions)
+		{
+			if (accessor.componentType != GLTF_FLOAT || accessor.componentCount != 3)
+				return false;
+
+			positions.resize(accessor.count);
+			if (accessor.stride == sizeof(Vector3))
+			{
+				std::memcpy(positions.data(), accessor.pData, accessor.count * sizeof(Vector3));
+				return true;
+			}
+
+			//Interleaved vertex data
+			for (size_t vertex{}; vertex < accessor.count; ++vertex)
+				std::memcpy(&positions[vertex], accessor.pData + vertex * accessor.stride, sizeof(Vector3));
+			return true;
+		}
+
+		static bool ReadIndices(const GLTFAccessor& accessor, std::vector<int>& indices)
+		{
+			if (accessor.componentCount != 1)
+				return false;
+
+			indices.resize(accessor.count);
+			if (accessor.componentType == GLTF_UNSIGNED_INT && accessor.stride == sizeof(uint32_t))
+			{
+				//Indices above INT_MAX turn negative and are rejected by the range check
+				std::memcpy(indices.data(), accessor.pData, accessor.count * sizeof(uint32_t));
+				return true;
+			}
+
+			for (size_t index{}; index < accessor.count; ++index)
+			{
+				const char* pIndex{ accessor.pData + index * accessor.stride };
+				switch (accessor.componentType)
+				{
+				case GLTF_UNSIGNED_BYTE:
+					indices[index] = int(*reinterpret_cast<const uint8_t*>(pIndex));
+					break;
+				case GLTF_UNSIGNED_SHORT:
+				{
+					uint16_t value{};
+					std::memcpy(&value, pIndex, sizeof(uint16_t));
+					indices[index] = int(value);
+					break;
+				}
+				case GLTF_UNSIGNED_INT:
+				{
+					uint32_t value{};
+					std::memcpy(&value, pIndex, sizeof(uint32_t));
+					indices[index] = int(value);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			return true;
+		}
+
+		static Matrix GetNodeTransform(const JsonValue& node)
+		{
+			const JsonValue& matrix{ node["matrix"] };
+			if (matrix.GetSize() == 16)
+			{
+				//Column-major with column vectors, which is exactly the row-major row vector layout of Matrix
+				Vector4 rows[4]{};
+				for (int element{}; element < 16; ++element)
+					rows[element / 4][element % 4] = matrix[element].AsFloat();
+				return { rows[0], rows[1], rows[2], rows[3] };
+			}
+
+			const JsonValue& translation{ node["translation"] };
+			const JsonValue& rotation{ node["rotation"] };
+			const JsonValue& scale{ node["scale"] };
+
+			const float x{ rotation[0].AsFloat() };
+			const float y{ rotation[1].AsFloat() };
+			const float z{ rotation[2].AsFloat() };
+			const float w{ rotation[3].AsFloat(1.f) };
+			const Matrix rotationTransform{
+				Vector3{ 1.f - 2.f * (y * y + z * z), 2.f * (x * y + w * z), 2.f * (x * z - w * y) },
+				Vector3{ 2.f * (x * y - w * z), 1.f - 2.f * (x * x + z * z), 2.f * (y * z + w * x) },
+				Vector3{ 2.f * (x * z + w * y), 2.f * (y * z - w * x), 1.f - 2.f * (x * x + y * y) },
+				Vector3::Zero };
+
+			return Matrix::CreateScale(scale[0].AsFloat(1.f), scale[1].AsFloat(1.f), scale[2].AsFloat(1.f))
+				* rotationTransform
+				* Matrix::CreateTranslation(translation[0].AsFloat(), translation[1].AsFloat(), translation[2].AsFloat());
+		}
+
+		static bool ImportNode(const std::string& filename, const GLTFDocument& document, int nodeIndex, const Matrix& parentTransform, int depth, ImportedModel& model)
+		{
+			const JsonValue& node{ document.json["nodes"][size_t(nodeIndex)] };
+			if (node.IsNull() || depth > GLTF_MAX_NODE_DEPTH)
+				return false;
+
+			const Matrix transform{ GetNodeTransform(node) * parentTransform };
+
+			const JsonValue& primitives{ document.json["meshes"][size_t(node["mesh"].AsInt(-1))]["primitives"] };
+			for (size_t primitiveIndex{}; primitiveIndex < primitives.GetSize(); ++primitiveIndex)
+			{
+				const JsonValue& primitive{ primitives[primitiveIndex] };
+				if (primitive["mode"].AsInt(GLTF_TRIANGLES) != GLTF_TRIANGLES)
+				{
+					std::cout << "Skipping non-triangle primitive in " << filename << std::endl;
+					continue;
+				}
+
+				TriangleMesh mesh{};
+				GLTFAccessor accessor{};
+				if (!GetAccessor(document, primitive["attributes"]["POSITION"].AsInt(-1), accessor) || !ReadPositions(accessor, mesh.positions))
+					return false;
+
+				if (primitive["indices"].IsNull())
+				{
+					mesh.indices.resize(mesh.positions.size());
+					std::iota(mesh.indices.begin(), mesh.indices.end(), 0);
+				}
+				else if (!GetAccessor(document, primitive["indices"].AsInt(-1), accessor) || !ReadIndices(accessor, mesh.indices))
+				{
+					return false;
+				}
+				mesh.indices.resize(mesh.indices.size() / 3 * 3);
+
+				if (!ValidateIndices(filename, mesh.indices, mesh.positions.size()))
+					return false;
+				CalculateFaceNormals(mesh.positions, mesh.indices, mesh.normals);
+				mesh.SetTransform(transform);
+
+				const int materialIndex{ primitive["material"].AsInt(-1) };
+				model.meshes.emplace_back(std::move(mesh));
+				model.meshMaterials.push_back(materialIndex);
+			}
+
+			const JsonValue& children{ node["children"] };
+			for (size_t child{}; child < children.GetSize(); ++child)
+			{
+				if (!ImportNode(filename, document, children[child].AsInt(-1), transform, depth + 1, model))
+					return false;
+			}
+			return true;
+		}
+
+		bool ParseGLB(const std::string& filename, ImportedModel& model)
+		{
+			const auto startTime{ std::chrono::steady_clock::now() };
+
+			const MappedFile file{ filename };
+			if (!file.IsOpen())
+				return false;
+
+			//Header: magic, version, total length
+			uint32_t header[3]{};
+			if (file.GetSize() >= sizeof(header))
+				std::memcpy(header, file.GetData(), sizeof(header));
+			if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > file.GetSize())
+			{
+				std::cout << "Failed to parse " << filename << ": not a glTF 2.0 binary" << std::endl;
+				return false;
+			}
+
+			GLTFDocument document{};
+			const char* pJson{};
+			size_t jsonSize{};
+			for (size_t offset{ sizeof(header) }; offset + 8 <= header[2];)
+			{
+				uint32_t chunk[2]{}; //Length, type
+				std::memcpy(chunk, file.GetData() + offset, sizeof(chunk));
+				offset += sizeof(chunk);
+				if (chunk[0] > header[2] - offset)
+					return false;
+
+				if (chunk[1] == GLB_CHUNK_JSON && !pJson)
+				{
+					pJson = file.GetData() + offset;
+					jsonSize = chunk[0];
+				}
+				else if (chunk[1] == GLB_CHUNK_BIN && !document.pBinary)
+				{
+					document.pBinary = file.GetData() + offset;
+					document.binarySize = chunk[0];
+				}
+				offset += chunk[0];
+			}
+
+			if (!pJson || !JsonValue::Parse(pJson, pJson + jsonSize, document.json))
+			{
+				std::cout << "Failed to parse " << filename << ": invalid JSON chunk" << std::endl;
+				return false;
+			}
+			if (!document.json["buffers"][0]["uri"].IsNull())
+			{
+				std::cout << "Failed to parse " << filename << ": external buffers are not supported" << std::endl;
+				return false;
+			}
+
+			model = {};
+
+			const JsonValue& materials{ document.json["materials"] };
+			for (size_t materialIndex{}; materialIndex < materials.GetSize(); ++materialIndex)
+			{
+				const JsonValue& pbr{ materials[materialIndex]["pbrMetallicRoughness"] };
+				const JsonValue& baseColor{ pbr["baseColorFactor"] };
+
+				ImportedMaterial material{};
+				material.albedo = { baseColor[0].AsFloat(1.f), baseColor[1].AsFloat(1.f), baseColor[2].AsFloat(1.f) };
+				material.metalness = pbr["metallicFactor"].AsFloat(1.f);
+				material.roughness = pbr["roughnessFactor"].AsFloat(1.f);
+				model.materials.push_back(material);
+			}
+
+			//Default scene, or every node that is nobody's child when the file has no scenes
+			std::vector<int> rootNodes{};
+			const JsonValue& scene{ document.json["scenes"][size_t(document.json["scene"].AsInt(0))] };
+			if (!scene.IsNull())
+			{
+				for (size_t node{}; node < scene["nodes"].GetSize(); ++node)
+					rootNodes.push_back(scene["nodes"][node].AsInt(-1));
+			}
+			else
+			{
+				const JsonValue& nodes{ document.json["nodes"] };
+				std::vector<bool> isChild(nodes.GetSize());
+				for (size_t node{}; node < nodes.GetSize(); ++node)
+				{
+					for (size_t child{}; child < nodes[node]["children"].GetSize(); ++child)
+					{
+						const int childIndex{ nodes[node]["children"][child].AsInt(-1) };
+						if (childIndex >= 0 && size_t(childIndex) < isChild.size())
+							isChild[childIndex] = true;
+					}
+				}
+				for (size_t node{}; node < nodes.GetSize(); ++node)
+				{
+					if (!isChild[node])
+						rootNodes.push_back(int(node));
+				}
+			}
+
+			for (const int node : rootNodes)
+			{
+				if (!ImportNode(filename, document, node, Matrix{}, 0, model))
+				{
+					std::cout << "Failed to parse " << filename << ": invalid node, accessor or buffer view" << std::endl;
+					model = {};
+					return false;
+				}
+			}
+
+			for (int& materialIndex : model.meshMaterials)
+			{
+				if (materialIndex >= int(model.materials.size()))
+					materialIndex = -1;
+			}
+
+			size_t triangleCount{};
+			for (const TriangleMesh& mesh : model.meshes)
+				triangleCount += mesh.normals.size();
+
+			const float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count() };
+			std::cout << "Loaded " << filename << ": " << model.meshes.size() << " meshes, " << triangleCount << " triangles in "
+				<< seconds * 1000.f << " ms" << std::endl;
+			return true;
+		}
+#pragma endregion
+	}
+}
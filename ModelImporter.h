@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	//glTF metallic-roughness factors, textures are not supported
+	struct ImportedMaterial
+	{
+		ColorRGB albedo{ 1.f, 1.f, 1.f };
+		float metalness{ 1.f };
+		float roughness{ 1.f };
+	};
+
+	struct ImportedModel
+	{
+		//One mesh per glTF primitive, with the node transform in its scale, rotation and translation matrices
+		std::vector<TriangleMesh> meshes{};
+		//Index into materials for every mesh, -1 when the primitive has no material
+		std::vector<int> meshMaterials{};
+		std::vector<ImportedMaterial> materials{};
+	};
+
+	namespace Utils
+	{
+		/**
+		 * \brief Parses a binary (little or big endian) PLY file
+		 * Only x, y, z of the vertex element and the index list of the face element are read, polygons are fan triangulated
+		 * \param filename path to the PLY file
+		 * \param positions vertex positions
+		 * \param normals one geometric normal per triangle
+		 * \param indices three vertex indices per triangle
+		 * \return true when the file was parsed successfully
+		 */
+		bool ParsePLY(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices);
+
+		/**
+		 * \brief Parses a binary glTF 2.0 file (.glb) with an embedded buffer
+		 * Triangle primitives of all nodes in the default scene become meshes, meshes used by several nodes are duplicated
+		 * \param filename path to the GLB file
+		 * \param model receives meshes, their node transforms and materials
+		 * \return true when the file was parsed successfully
+		 */
+		bool ParseGLB(const std::string& filename, ImportedModel& model);
+	}
+}
@@ -0,0 +1,156 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+using namespace dae;
+
+namespace
+{
+	//Events kept per thread, a 640x480 frame records about 300 tiles per pass
+	constexpr uint64_t PROFILER_RING_SIZE{ 1 << 15 };
+
+	struct ProfileEvent
+	{
+		const char* pName{};
+		int64_t start{};
+		int64_t end{};
+		int32_t value{};
+	};
+
+	//Only its own thread writes, writeCount is published after the event so a reader never sees a half written one
+	struct ProfileThreadBuffer
+	{
+		uint32_t threadIndex{};
+		std::string name{};
+		std::vector<ProfileEvent> events{};
+		std::atomic<uint64_t> writeCount{};
+	};
+
+	//Buffers stay registered after their thread exits, so their events can still be written
+	struct ProfilerRegistry
+	{
+		~ProfilerRegistry()
+		{
+			for (const ProfileThreadBuffer* pBuffer : buffers)
+				delete pBuffer;
+		}
+
+		std::mutex mutex{};
+		std::vector<ProfileThreadBuffer*> buffers{};
+		std::atomic<bool> isCapturing{};
+		std::atomic<int64_t> captureStart{};
+	};
+
+	ProfilerRegistry& GetRegistry()
+	{
+		static ProfilerRegistry registry{};
+		return registry;
+	}
+
+	ProfileThreadBuffer* RegisterThread()
+	{
+		ProfilerRegistry& registry{ GetRegistry() };
+		const auto pBuffer = new ProfileThreadBuffer();
+		pBuffer->events.resize(PROFILER_RING_SIZE);
+
+		const std::lock_guard<std::mutex> lock{ registry.mutex };
+		pBuffer->threadIndex = uint32_t(registry.buffers.size());
+		pBuffer->name = "Thread " + std::to_string(pBuffer->threadIndex);
+		registry.buffers.push_back(pBuffer);
+		return pBuffer;
+	}
+
+	ProfileThreadBuffer& GetThreadBuffer()
+	{
+		thread_local ProfileThreadBuffer* const pBuffer{ RegisterThread() };
+		return *pBuffer;
+	}
+}
+
+void Profiler::BeginCapture()
+{
+	ProfilerRegistry& registry{ GetRegistry() };
+	registry.captureStart.store(GetTimestamp(), std::memory_order_relaxed);
+	registry.isCapturing.store(true, std::memory_order_release);
+}
+
+bool Profiler::EndCapture(const std::string& filename)
+{
+	ProfilerRegistry& registry{ GetRegistry() };
+	registry.isCapturing.store(false, std::memory_order_release);
+	const int64_t captureStart{ registry.captureStart.load(std::memory_order_relaxed) };
+
+	std::ofstream file{ filename, std::ios::trunc };
+	if (!file)
+		return false;
+
+	const std::lock_guard<std::mutex> lock{ registry.mutex };
+	size_t eventCount{};
+	bool hasDroppedEvents{};
+
+	//Timestamps are microseconds since BeginCapture, complete events ("X") carry their duration
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (const ProfileThreadBuffer* pBuffer : registry.buffers)
+	{
+		file << (pBuffer == registry.buffers.front() ? "\n" : ",\n");
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << pBuffer->threadIndex << ",\"args\":{\"name\":\"" << pBuffer->name << "\"}}";
+
+		const uint64_t writeCount{ pBuffer->writeCount.load(std::memory_order_acquire) };
+		const uint64_t firstEvent{ writeCount > PROFILER_RING_SIZE ? writeCount - PROFILER_RING_SIZE : 0 };
+		for (uint64_t index{ firstEvent }; index < writeCount; ++index)
+		{
+			const ProfileEvent& event{ pBuffer->events[index % PROFILER_RING_SIZE] };
+			if (event.start < captureStart)
+				continue;
+
+			hasDroppedEvents = hasDroppedEvents || (index == firstEvent && firstEvent > 0);
+			file << ",\n{\"name\":\"" << event.pName << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << pBuffer->threadIndex
+				<< ",\"ts\":" << double(event.start - captureStart) / 1000.0 << ",\"dur\":" << double(event.end - event.start) / 1000.0;
+			if (event.value >= 0)
+				file << ",\"args\":{\"value\":" << event.value << "}";
+			file << "}";
+			++eventCount;
+		}
+	}
+	file << "\n]}\n";
+
+	std::cout << "Saved " << eventCount << " profiler events to " << filename << std::endl;
+	if (hasDroppedEvents)
+		std::cout << "The capture was too long, the oldest events of some threads were overwritten" << std::endl;
+	return bool(file);
+}
+
+bool Profiler::IsCapturing()
+{
+	return GetRegistry().isCapturing.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ProfileThreadBuffer& buffer{ GetThreadBuffer() };
+	const std::lock_guard<std::mutex> lock{ GetRegistry().mutex };
+	buffer.name = name;
+}
+
+int64_t Profiler::GetTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::Record(const char* pName, int64_t start, int64_t end, int32_t value)
+{
+	if (!IsCapturing())
+		return;
+
+	ProfileThreadBuffer& buffer{ GetThreadBuffer() };
+	const uint64_t writeCount{ buffer.writeCount.load(std::memory_order_relaxed) };
+	buffer.events[writeCount % PROFILER_RING_SIZE] = { pName, start, end, value };
+	buffer.writeCount.store(writeCount + 1, std::memory_order_release);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#define PROFILE_CONCATENATE_IMPL(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_IMPL(a, b)
+//Records the enclosing scope while a capture runs: PROFILE_SCOPE("Name") or PROFILE_SCOPE("Name", value)
+#define PROFILE_SCOPE(...) const dae::ProfileScope PROFILE_CONCATENATE(profileScope, __LINE__){ __VA_ARGS__ }
+
+namespace dae
+{
+	//Timeline of named scopes on every thread, written as Chrome trace events (chrome://tracing, ui.perfetto.dev).
+	//Every thread records into its own ring buffer without locks, the oldest events are overwritten when it is full
+	class Profiler final
+	{
+	public:
+		//Forgets earlier events and starts recording
+		static void BeginCapture();
+		/**
+		 * \brief Stops recording and writes every event since BeginCapture as a trace-event JSON file
+		 * Call it between frames, scopes that are still open on other threads are not written
+		 */
+		static bool EndCapture(const std::string& filename);
+		static bool IsCapturing();
+
+		//Shown as the name of the calling thread in the timeline, threads without a name are numbered
+		static void SetThreadName(const std::string& name);
+
+		//Nanoseconds of a steady clock
+		static int64_t GetTimestamp();
+		//value is shown as an argument of the event, negative values are left out
+		static void Record(const char* pName, int64_t start, int64_t end, int32_t value);
+	};
+
+	class ProfileScope final
+	{
+	public:
+		//pName has to outlive the capture, string literals are expected
+		explicit ProfileScope(const char* pName, int32_t value = -1) :
+			m_pName{ pName },
+			m_Value{ value },
+			m_Start{ Profiler::IsCapturing() ? Profiler::GetTimestamp() : -1 }
+		{
+		}
+
+		~ProfileScope()
+		{
+			if (m_Start >= 0)
+				Profiler::Record(m_pName, m_Start, Profiler::GetTimestamp(), m_Value);
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope(ProfileScope&&) noexcept = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+		ProfileScope& operator=(ProfileScope&&) noexcept = delete;
+
+	private:
+		const char* m_pName;
+		int32_t m_Value;
+		int64_t m_Start;
+	};
+}
@@ -0,0 +1,320 @@
+#include "Regression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "Camera.h"
+#include "RenderTarget.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+
+using namespace dae;
+
+namespace
+{
+	//Positions along the default benchmark path, the first one is the camera of the scene
+	constexpr float REGRESSION_CAMERA_PROGRESS[]{ 0.f, 0.25f, 0.5f };
+
+	std::string GetReferenceFilename(const std::string& directory, const std::string& sceneName, size_t cameraIndex)
+	{
+		//Scene files are named by their path, only the file name ends up in the reference. Generated scene names hold ':' and '='
+		std::string name{ std::filesystem::path{ sceneName }.stem().string() };
+		std::replace_if(name.begin(), name.end(), [](char character) { return character == ':' || character == '='; }, '_');
+		return (std::filesystem::path{ directory } / (name + "_" + std::to_string(cameraIndex) + ".ppm")).string();
+	}
+
+	std::vector<uint8_t> ReadTargetRgb(const RenderTarget* pTarget)
+	{
+		const PixelFormat& format{ pTarget->GetPixelFormat() };
+		std::vector<uint8_t> rgb(size_t(pTarget->GetWidth()) * pTarget->GetHeight() * 3);
+		for (uint32_t y{}; y < pTarget->GetHeight(); ++y)
+		{
+			const uint32_t* pRow{ pTarget->GetRow(y) };
+			for (uint32_t x{}; x < pTarget->GetWidth(); ++x)
+			{
+				uint8_t* pRGB{ &rgb[(size_t(y) * pTarget->GetWidth() + x) * 3] };
+				pRGB[0] = static_cast<uint8_t>(pRow[x] >> format.redShift);
+				pRGB[1] = static_cast<uint8_t>(pRow[x] >> format.greenShift);
+				pRGB[2] = static_cast<uint8_t>(pRow[x] >> format.blueShift);
+			}
+		}
+		return rgb;
+	}
+}
+
+RegressionGate::RegressionGate(const RegressionSettings& settings) :
+	m_Settings{ settings }
+{
+	//Updating keeps the baselines of the scenes that are not run again
+	ReadBaseline();
+}
+
+bool RegressionGate::Run(const std::string& sceneName, Scene* pScene, Renderer* pRenderer, const RenderTarget* pTarget)
+{
+	const bool areImagesValid{ CheckImages(sceneName, pScene, pRenderer, pTarget) };
+	const bool isTimingValid{ CheckTiming(sceneName, pScene, pRenderer) };
+	if (areImagesValid && isTimingValid)
+		return true;
+
+	++m_FailureCount;
+	return false;
+}
+
+bool RegressionGate::WriteBaseline() const
+{
+	if (!m_Settings.updateReferences)
+		return true;
+
+	std::ofstream file{ GetBaselineFilename(), std::ios::trunc };
+	for (const auto& [sceneName, baseline] : m_Baselines)
+	{
+		if (!sceneName.empty())
+			file << "[" << sceneName << "]\n";
+		file << "FRAMES = " << baseline.frameCount << "\n"
+			<< "WIDTH = " << baseline.width << "\n"
+			<< "HEIGHT = " << baseline.height << "\n"
+			<< "MIN_MS = " << baseline.minTime << "\n"
+			<< "MAX_MS = " << baseline.maxTime << "\n"
+			<< "AVG_MS = " << baseline.averageTime << "\n"
+			<< "MEDIAN_MS = " << baseline.medianTime << "\n";
+	}
+	if (!file)
+		return false;
+
+	std::cout << "Saved " << GetBaselineFilename() << std::endl;
+	return true;
+}
+
+bool RegressionGate::ReadPPM(const std::string& filename, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgb)
+{
+	std::ifstream file{ filename, std::ios::binary };
+	std::string magic{};
+	uint32_t maxValue{};
+	file >> magic >> width >> height >> maxValue;
+	if (!file || magic != "P6" || maxValue != 255 || width == 0 || height == 0)
+		return false;
+
+	//A single whitespace separates the header from the pixels
+	file.get();
+	rgb.resize(size_t(width) * height * 3);
+	file.read(reinterpret_cast<char*>(rgb.data()), std::streamsize(rgb.size()));
+	return bool(file);
+}
+
+bool RegressionGate::WritePPM(const std::string& filename, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgb)
+{
+	std::ofstream file{ filename, std::ios::binary | std::ios::trunc };
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write(reinterpret_cast<const char*>(rgb.data()), std::streamsize(rgb.size()));
+	return bool(file);
+}
+
+ImageComparison RegressionGate::CompareImages(const std::vector<uint8_t>& rgb, const std::vector<uint8_t>& referenceRgb)
+{
+	ImageComparison comparison{};
+	double squaredErrorSum{};
+	for (size_t index{}; index < rgb.size(); index += 3)
+	{
+		uint32_t pixelError{};
+		for (size_t channel{}; channel < 3; ++channel)
+		{
+			const int error{ std::abs(int(rgb[index + channel]) - int(referenceRgb[index + channel])) };
+			squaredErrorSum += double(error * error);
+			pixelError = std::max(pixelError, uint32_t(error));
+		}
+		comparison.maxChannelError = std::max(comparison.maxChannelError, pixelError);
+		comparison.differentPixels += pixelError > 0 ? 1 : 0;
+	}
+
+	//Identical images have an infinite PSNR
+	const double meanSquaredError{ squaredErrorSum / double(std::max(rgb.size(), size_t(1))) };
+	comparison.psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
+	return comparison;
+}
+
+bool RegressionGate::CheckImages(const std::string& sceneName, Scene* pScene, Renderer* pRenderer, const RenderTarget* pTarget)
+{
+	Camera& camera{ pScene->GetCamera() };
+	const CameraKeyframe start{ camera.origin, camera.totalPitch, camera.totalYaw, camera.fovAngle };
+	const CameraPath path{ CameraPath::CreateDefault(camera) };
+
+	if (m_Settings.updateReferences)
+		std::filesystem::create_directories(m_Settings.referenceDirectory);
+
+	bool isValid{ true };
+	for (size_t cameraIndex{}; cameraIndex < std::size(REGRESSION_CAMERA_PROGRESS); ++cameraIndex)
+	{
+		//Every image is a first frame at scene time 0, nothing depends on the images before it
+		Timer timer{};
+		timer.SetFixedTimeStep(m_Settings.benchmarkSettings.timeStep);
+		timer.Start();
+		pScene->Update(&timer);
+		path.Apply(REGRESSION_CAMERA_PROGRESS[cameraIndex], camera);
+		pRenderer->ResetHistory();
+		pRenderer->Render(pScene);
+
+		const std::string filename{ GetReferenceFilename(m_Settings.referenceDirectory, sceneName, cameraIndex) };
+		const std::vector<uint8_t> rgb{ ReadTargetRgb(pTarget) };
+		if (m_Settings.updateReferences)
+		{
+			if (!WritePPM(filename, pTarget->GetWidth(), pTarget->GetHeight(), rgb))
+			{
+				std::cout << "FAIL " << filename << ": could not be written" << std::endl;
+				isValid = false;
+			}
+			continue;
+		}
+
+		uint32_t referenceWidth{}, referenceHeight{};
+		std::vector<uint8_t> referenceRgb{};
+		if (!ReadPPM(filename, referenceWidth, referenceHeight, referenceRgb))
+		{
+			std::cout << "FAIL " << filename << ": missing reference, record it with --regression-update" << std::endl;
+			isValid = false;
+			continue;
+		}
+		if (referenceWidth != pTarget->GetWidth() || referenceHeight != pTarget->GetHeight())
+		{
+			std::cout << "FAIL " << filename << ": reference is " << referenceWidth << "x" << referenceHeight
+				<< ", rendered " << pTarget->GetWidth() << "x" << pTarget->GetHeight() << std::endl;
+			isValid = false;
+			continue;
+		}
+
+		const ImageComparison comparison{ CompareImages(rgb, referenceRgb) };
+		const bool isImageValid{ comparison.psnr >= m_Settings.minPsnr && comparison.maxChannelError <= m_Settings.maxChannelError };
+		std::cout << (isImageValid ? "ok   " : "FAIL ") << filename << ": PSNR " << comparison.psnr << " dB, max error "
+			<< comparison.maxChannelError << ", " << comparison.differentPixels << " pixels differ" << std::endl;
+		if (!isImageValid)
+		{
+			//Kept next to the reference, so the two can be compared side by side
+			const std::string actualFilename{ filename.substr(0, filename.size() - 4) + "_actual.ppm" };
+			if (WritePPM(actualFilename, pTarget->GetWidth(), pTarget->GetHeight(), rgb))
+				std::cout << "     saved the rendered image to " << actualFilename << std::endl;
+			isValid = false;
+		}
+	}
+
+	camera.origin = start.origin;
+	camera.fovAngle = start.fovAngle;
+	camera.SetOrientation(start.pitch, start.yaw);
+	pRenderer->ResetHistory();
+	return isValid;
+}
+
+bool RegressionGate::CheckTiming(const std::string& sceneName, Scene* pScene, Renderer* pRenderer)
+{
+	const Benchmark benchmark{ m_Settings.benchmarkSettings };
+	const BenchmarkResult result{ benchmark.Run(sceneName, pScene, pRenderer) };
+
+	if (m_Settings.updateReferences)
+	{
+		m_Baselines[sceneName] = { uint32_t(result.frameTimes.size()), result.width, result.height,
+			result.minFrameTime, result.maxFrameTime, result.averageFrameTime, result.medianFrameTime };
+		std::cout << "     " << sceneName << ": median " << result.medianFrameTime << " ms recorded" << std::endl;
+		return true;
+	}
+
+	//A timing only says something about the scene and resolution it was measured on
+	const auto baselineIt{ m_Baselines.find(sceneName) };
+	if (baselineIt == m_Baselines.end())
+	{
+		std::cout << "skip " << sceneName << ": no timing baseline" << std::endl;
+		return true;
+	}
+
+	const TimingBaseline& baseline{ baselineIt->second };
+	if (baseline.width == 0 || baseline.height == 0)
+	{
+		std::cout << "skip " << sceneName << ": baseline has no WIDTH and HEIGHT" << std::endl;
+		return true;
+	}
+	if (baseline.width != result.width || baseline.height != result.height)
+	{
+		std::cout << "skip " << sceneName << ": baseline was measured at " << baseline.width << "x" << baseline.height << std::endl;
+		return true;
+	}
+
+	//The median ignores the odd slow frame, baselines without one (converted frames per second) fall back to the average
+	const bool hasMedian{ baseline.medianTime > 0.0 };
+	const double baselineTime{ hasMedian ? baseline.medianTime : baseline.averageTime };
+	const double time{ hasMedian ? result.medianFrameTime : result.averageFrameTime };
+	const double limit{ baselineTime * (1.0 + m_Settings.timeTolerance) };
+	const bool isValid{ baselineTime <= 0.0 || time <= limit };
+	std::cout << (isValid ? "ok   " : "FAIL ") << sceneName << ": " << (hasMedian ? "median " : "avg ") << time << " ms, baseline "
+		<< baselineTime << " ms (" << (baselineTime > 0.0 ? (time / baselineTime - 1.0) * 100.0 : 0.0) << "%, limit " << limit << " ms)" << std::endl;
+	return isValid;
+}
+
+std::string RegressionGate::GetBaselineFilename() const
+{
+	if (!m_Settings.baselineFilename.empty())
+		return m_Settings.baselineFilename;
+	return (std::filesystem::path{ m_Settings.referenceDirectory } / "baseline.txt").string();
+}
+
+void RegressionGate::ReadBaseline()
+{
+	std::ifstream file{ GetBaselineFilename() };
+	std::string section{};
+	bool hasSectionlessValues{};
+	for (std::string line{}; std::getline(file, line);)
+	{
+		line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+		if (line.empty())
+			continue;
+		if (line.front() == '[' && line.back() == ']')
+		{
+			section = line.substr(1, line.size() - 2);
+			continue;
+		}
+
+		//KEY = VALUE
+		std::istringstream stream{ line };
+		std::string key{}, separator{};
+		double value{};
+		if (!(stream >> key >> separator >> value) || separator != "=")
+			continue;
+
+		//Values outside a [scene] section do not belong to any scene
+		if (section.empty())
+		{
+			hasSectionlessValues = true;
+			continue;
+		}
+
+		TimingBaseline& baseline{ m_Baselines[section] };
+		if (key == "FRAMES")
+			baseline.frameCount = uint32_t(value);
+		else if (key == "WIDTH")
+			baseline.width = uint32_t(value);
+		else if (key == "HEIGHT")
+			baseline.height = uint32_t(value);
+		else if (key == "MIN_MS")
+			baseline.minTime = value;
+		else if (key == "MAX_MS")
+			baseline.maxTime = value;
+		else if (key == "AVG_MS")
+			baseline.averageTime = value;
+		else if (key == "MEDIAN_MS")
+			baseline.medianTime = value;
+		//benchmark.txt keys in frames per second, HIGH is the fastest frame. 1000 / AVG is only close to the average frame time
+		//when the frame rate is steady (the mean of 1/x is not 1 over the mean of x). The _MS keys win when a section has both
+		else if (key == "HIGH" && value > 0.0 && baseline.minTime == 0.0)
+			baseline.minTime = 1000.0 / value;
+		else if (key == "LOW" && value > 0.0 && baseline.maxTime == 0.0)
+			baseline.maxTime = 1000.0 / value;
+		else if (key == "AVG" && value > 0.0 && baseline.averageTime == 0.0)
+			baseline.averageTime = 1000.0 / value;
+	}
+
+	if (hasSectionlessValues)
+		std::cout << "Ignored the timings outside a [scene] section of " << GetBaselineFilename()
+			<< ", put them under the scene they were measured on together with WIDTH and HEIGHT" << std::endl;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace dae
+{
+	class Scene;
+	class Renderer;
+	class RenderTarget;
+
+	struct RegressionSettings
+	{
+		//Holds <scene>_<camera>.ppm for every fixed camera
+		std::string referenceDirectory{ "Regression" };
+		//Timings to compare against, <referenceDirectory>/baseline.txt when empty
+		std::string baselineFilename{};
+		//An image fails below this PSNR (dB) or when any channel differs by more than maxChannelError
+		double minPsnr{ 45.0 };
+		uint32_t maxChannelError{ 8 };
+		//A scene fails when its median frame time is this fraction slower than the baseline
+		double timeTolerance{ 0.15 };
+		//Writes the references and the baseline instead of comparing
+		bool updateReferences{ false };
+		BenchmarkSettings benchmarkSettings{};
+	};
+
+	struct ImageComparison
+	{
+		double psnr{};
+		uint32_t maxChannelError{};
+		uint32_t differentPixels{};
+	};
+
+	//Frame times of one scene in milliseconds, stored as KEY = VALUE with the unit in the key (MEDIAN_MS, ...)
+	struct TimingBaseline
+	{
+		uint32_t frameCount{};
+		uint32_t width{};
+		uint32_t height{};
+		double minTime{};
+		double maxTime{};
+		double averageTime{};
+		double medianTime{};
+	};
+
+	/**
+	 * \brief Renders scenes from fixed cameras and compares them against reference images, then benchmarks them against a timing baseline.
+	 * Optimizations are expected to keep the pixels, so the default thresholds only allow rounding differences
+	 */
+	class RegressionGate final
+	{
+	public:
+		//Reads the baseline, a missing baseline only skips the timing checks
+		explicit RegressionGate(const RegressionSettings& settings);
+
+		//Returns false when an image or the timing of the scene regressed
+		bool Run(const std::string& sceneName, Scene* pScene, Renderer* pRenderer, const RenderTarget* pTarget);
+		//Saves the baselines of every scene run so far, only when updating
+		bool WriteBaseline() const;
+
+		uint32_t GetFailureCount() const { return m_FailureCount; };
+
+		//Binary RGB PPM (P6), false when the file is missing or not an 8-bit PPM
+		static bool ReadPPM(const std::string& filename, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgb);
+		static bool WritePPM(const std::string& filename, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgb);
+		static ImageComparison CompareImages(const std::vector<uint8_t>& rgb, const std::vector<uint8_t>& referenceRgb);
+
+	private:
+		RegressionSettings m_Settings{};
+		//Keyed by the [scene] section, a baseline only applies to its own scene at its own WIDTH and HEIGHT
+		std::map<std::string, TimingBaseline> m_Baselines{};
+		uint32_t m_FailureCount{};
+
+		bool CheckImages(const std::string& sceneName, Scene* pScene, Renderer* pRenderer, const RenderTarget* pTarget);
+		bool CheckTiming(const std::string& sceneName, Scene* pScene, Renderer* pRenderer);
+		std::string GetBaselineFilename() const;
+		void ReadBaseline();
+	};
+}
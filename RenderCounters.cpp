@@ -0,0 +1,100 @@
+#include "RenderCounters.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+using namespace dae;
+
+namespace
+{
+	constexpr const char* RENDER_COUNTER_NAMES[RENDER_COUNTER_COUNT]
+	{
+		"primaryRays", "shadowRays", "shadowEarlyExits", "aabbTests", "triangleTests", "sphereTests", "planeTests", "shadeCalls"
+	};
+
+	//Thread blocks stay registered after their thread exits, so the totals never go back
+	struct RenderCountersRegistry
+	{
+		~RenderCountersRegistry()
+		{
+			for (const RenderThreadCounts* pThreadCounts : threadCounts)
+				delete pThreadCounts;
+		}
+
+		std::mutex mutex{};
+		std::vector<RenderThreadCounts*> threadCounts{};
+		RenderStats collectedTotals{};
+	};
+
+	RenderCountersRegistry& GetRegistry()
+	{
+		static RenderCountersRegistry registry{};
+		return registry;
+	}
+}
+
+RenderStats& RenderStats::operator+=(const RenderStats& other)
+{
+	for (size_t index{}; index < RENDER_COUNTER_COUNT; ++index)
+		counts[index] += other.counts[index];
+	return *this;
+}
+
+RenderThreadCounts* RenderCounters::RegisterThread()
+{
+	RenderCountersRegistry& registry{ GetRegistry() };
+	const auto pThreadCounts = new RenderThreadCounts();
+	const std::lock_guard<std::mutex> lock{ registry.mutex };
+	registry.threadCounts.push_back(pThreadCounts);
+	return pThreadCounts;
+}
+
+RenderStats RenderCounters::Collect()
+{
+	RenderCountersRegistry& registry{ GetRegistry() };
+	const std::lock_guard<std::mutex> lock{ registry.mutex };
+
+	//Counters only grow, the frame is the difference with the totals of the previous call
+	RenderStats totals{};
+	for (const RenderThreadCounts* pThreadCounts : registry.threadCounts)
+	{
+		for (size_t index{}; index < RENDER_COUNTER_COUNT; ++index)
+			totals.counts[index] += pThreadCounts->counts[index].load(std::memory_order_relaxed);
+	}
+
+	RenderStats frame{};
+	for (size_t index{}; index < RENDER_COUNTER_COUNT; ++index)
+		frame.counts[index] = totals.counts[index] - registry.collectedTotals.counts[index];
+	registry.collectedTotals = totals;
+	return frame;
+}
+
+const char* RenderCounters::GetName(RenderCounter counter)
+{
+	return RENDER_COUNTER_NAMES[size_t(counter)];
+}
+
+void RenderCounters::Print(std::ostream& stream, const RenderStats& stats, uint32_t frameCount)
+{
+	stream << "Per frame:";
+	for (size_t index{}; index < RENDER_COUNTER_COUNT; ++index)
+		stream << " " << RENDER_COUNTER_NAMES[index] << "=" << stats.counts[index] / std::max(frameCount, 1u);
+	stream << std::endl;
+}
+
+void RenderCounters::WriteCsvHeader(std::ostream& stream)
+{
+	stream << "frame,frameMs";
+	for (const char* pName : RENDER_COUNTER_NAMES)
+		stream << "," << pName;
+	stream << "\n";
+}
+
+void RenderCounters::WriteCsvRow(std::ostream& stream, uint32_t frameIndex, double frameTime, const RenderStats& stats)
+{
+	stream << frameIndex << "," << frameTime;
+	for (const uint64_t count : stats.counts)
+		stream << "," << count;
+	stream << "\n";
+}
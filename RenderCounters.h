@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+//Uncomment to count rays and intersection tests per frame, compiled out by default since every hit test would pay for it
+//#define RENDER_COUNTERS
+
+#if defined(RENDER_COUNTERS)
+#define COUNT_RENDER_STAT(counter) dae::RenderCounters::Increment(dae::RenderCounter::counter)
+#else
+#define COUNT_RENDER_STAT(counter)
+#endif
+
+namespace dae
+{
+	enum class RenderCounter
+	{
+		PrimaryRays,
+		ShadowRays,
+		//Shadow rays that stopped at the first occluder
+		ShadowEarlyExits,
+		//Mesh bounds and BVH nodes
+		AABBTests,
+		TriangleTests,
+		SphereTests,
+		PlaneTests,
+		//Material::Shade calls
+		ShadeCalls,
+		Count
+	};
+
+	constexpr size_t RENDER_COUNTER_COUNT{ size_t(RenderCounter::Count) };
+
+	struct RenderStats
+	{
+		uint64_t counts[RENDER_COUNTER_COUNT]{};
+
+		uint64_t Get(RenderCounter counter) const { return counts[size_t(counter)]; };
+		RenderStats& operator+=(const RenderStats& other);
+	};
+
+	//Counts of one thread, on its own cache line
+	struct alignas(64) RenderThreadCounts
+	{
+		std::atomic<uint64_t> counts[RENDER_COUNTER_COUNT]{};
+	};
+
+	//Per-thread event counters, every thread increments its own cache line so counting never contends.
+	//Collect sums the threads between frames, while no rays are traced
+	class RenderCounters final
+	{
+	public:
+		static constexpr bool IsEnabled()
+		{
+#if defined(RENDER_COUNTERS)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		static void Increment(RenderCounter counter)
+		{
+			//Only the owning thread writes, a relaxed load and store is enough and avoids a locked add
+			std::atomic<uint64_t>& count{ GetThreadCounts().counts[size_t(counter)] };
+			count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		//Count of the calling thread so far, the difference around a piece of work is what that work did
+		static uint64_t GetThreadCount(RenderCounter counter)
+		{
+			return GetThreadCounts().counts[size_t(counter)].load(std::memory_order_relaxed);
+		}
+
+		//Counts of every thread since the previous call
+		static RenderStats Collect();
+
+		static const char* GetName(RenderCounter counter);
+		//One line with the average count per frame
+		static void Print(std::ostream& stream, const RenderStats& stats, uint32_t frameCount = 1);
+		static void WriteCsvHeader(std::ostream& stream);
+		static void WriteCsvRow(std::ostream& stream, uint32_t frameIndex, double frameTime, const RenderStats& stats);
+
+	private:
+		static RenderThreadCounts& GetThreadCounts()
+		{
+			thread_local RenderThreadCounts* const pThreadCounts{ RegisterThread() };
+			return *pThreadCounts;
+		}
+		static RenderThreadCounts* RegisterThread();
+	};
+}
@@ -0,0 +1,39 @@
+#include "RenderTarget.h"
+
+#include <algorithm>
+#include <new>
+
+using namespace dae;
+
+namespace
+{
+	constexpr uint32_t RENDER_TARGET_ALIGNMENT{ 64 };
+}
+
+RenderTarget::RenderTarget(uint32_t width, uint32_t height, const PixelFormat& pixelFormat) :
+	m_Width{ width },
+	m_Height{ height },
+	m_Pitch{ (width * uint32_t(sizeof(uint32_t)) + RENDER_TARGET_ALIGNMENT - 1) / RENDER_TARGET_ALIGNMENT * RENDER_TARGET_ALIGNMENT },
+	m_PixelFormat{ pixelFormat },
+	m_OwnsPixels{ true }
+{
+	const size_t size{ std::max(size_t(m_Pitch) * height, size_t(RENDER_TARGET_ALIGNMENT)) };
+	m_pPixels = static_cast<uint32_t*>(::operator new(size, std::align_val_t{ RENDER_TARGET_ALIGNMENT }));
+	std::fill_n(reinterpret_cast<uint8_t*>(m_pPixels), size, uint8_t{});
+}
+
+RenderTarget::RenderTarget(uint32_t* pPixels, uint32_t width, uint32_t height, uint32_t pitch, const PixelFormat& pixelFormat) :
+	m_pPixels{ pPixels },
+	m_Width{ width },
+	m_Height{ height },
+	m_Pitch{ pitch },
+	m_PixelFormat{ pixelFormat }
+{
+}
+
+RenderTarget::~RenderTarget()
+{
+	if (m_OwnsPixels)
+		::operator delete(m_pPixels, std::align_val_t{ RENDER_TARGET_ALIGNMENT });
+	m_pPixels = nullptr;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+#include "ToneMapper.h"
+
+namespace dae
+{
+	//Packed 32-bit pixels the renderer presents into.
+	//Headless targets own their framebuffer, a window front end wraps the pixels of its surface instead
+	class RenderTarget final
+	{
+	public:
+		//Owns a framebuffer whose rows start on a cache line
+		RenderTarget(uint32_t width, uint32_t height, const PixelFormat& pixelFormat = {});
+		//Wraps pixels owned by someone else, rows are pitch bytes apart
+		RenderTarget(uint32_t* pPixels, uint32_t width, uint32_t height, uint32_t pitch, const PixelFormat& pixelFormat);
+		~RenderTarget();
+
+		RenderTarget(const RenderTarget&) = delete;
+		RenderTarget(RenderTarget&&) noexcept = delete;
+		RenderTarget& operator=(const RenderTarget&) = delete;
+		RenderTarget& operator=(RenderTarget&&) noexcept = delete;
+
+		uint32_t* GetPixels() const { return m_pPixels; };
+		uint32_t* GetRow(uint32_t row) const { return reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(m_pPixels) + size_t(row) * m_Pitch); };
+		uint32_t GetWidth() const { return m_Width; };
+		uint32_t GetHeight() const { return m_Height; };
+		uint32_t GetPitch() const { return m_Pitch; };
+		const PixelFormat& GetPixelFormat() const { return m_PixelFormat; };
+
+	private:
+		uint32_t* m_pPixels{ nullptr };
+		uint32_t m_Width{};
+		uint32_t m_Height{};
+		uint32_t m_Pitch{};
+		PixelFormat m_PixelFormat{};
+		bool m_OwnsPixels{ false };
+	};
+}
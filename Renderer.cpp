@@ -1,78 +1,295 @@
-//External includes
-#include "SDL.h"
-#include "SDL_surface.h"
-
 //Project includes
 #include "Renderer.h"
+#include "RenderTarget.h"
+#include "Denoiser.h"
+#include "ToneMapper.h"
+#include "ImageWriter.h"
+#include "FrameStream.h"
 #include "Math.h"
 #include "Matrix.h"
 #include "Material.h"
 #include "Scene.h"
 #include "Utils.h"
-#include <execution>
+#include "ClusterCache.h"
+#include "RenderCounters.h"
+#include "Profiler.h"
+#include "HardwareCounters.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
 
+//Without it a renderer starts with a single worker, SetWorkerCount still changes that at runtime
 #define PARALLEL_EXECUTION
 
 using namespace dae;
 
-Renderer::Renderer(SDL_Window * pWindow) :
-	m_pWindow(pWindow),
-	m_pBuffer(SDL_GetWindowSurface(pWindow))
+//Pixels are handed to the threads in square tiles
+constexpr int RENDER_TILE_SIZE{ 32 };
+
+//ReSTIR parameters
+constexpr int RESTIR_INITIAL_CANDIDATES{ 32 };
+constexpr int RESTIR_SPATIAL_NEIGHBOURS{ 3 };
+constexpr float RESTIR_SPATIAL_RADIUS{ 10.f };
+constexpr float RESTIR_TEMPORAL_HISTORY_LIMIT{ 20.f };
+
+//Adaptive anti-aliasing parameters
+constexpr int AA_TILE_SIZE{ 8 };
+constexpr int AA_MAX_SAMPLES_PER_SIDE{ 4 };
+constexpr float AA_CONTRAST_THRESHOLD{ 0.1f };
+
+//Out of core geometry, pixels that skipped clusters are retraced once the loads arrived, the last pass waits for every load
+constexpr int STREAMING_MAX_DEFERRED_PASSES{ 4 };
+constexpr uint32_t STREAMING_DEFERRED_BATCH_SIZE{ RENDER_TILE_SIZE * RENDER_TILE_SIZE };
+
+//Temporal accumulation parameters, a moving camera keeps a short history to limit ghosting
+constexpr float TEMPORAL_STATIC_HISTORY_LIMIT{ 1024.f };
+constexpr float TEMPORAL_MOVING_HISTORY_LIMIT{ 16.f };
+
+//Cost heatmap, the percentile of the pixel costs that is shown in red
+constexpr float HEATMAP_SCALE_PERCENTILE{ 0.99f };
+
+Renderer::Renderer(RenderTarget* pTarget) :
+	m_pTarget(pTarget),
+	m_Width(int(pTarget->GetWidth())),
+	m_Height(int(pTarget->GetHeight()))
 {
 	//Initialize
-	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
-	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+
+	const uint32_t amountOfPixels{ uint32_t(m_Width * m_Height) };
+	m_PixelIndices.reserve(amountOfPixels);
+	for (uint32_t index{}; index < amountOfPixels; ++index) m_PixelIndices.emplace_back(index);
+	m_RowIndices.reserve(m_Height);
+	for (uint32_t row{}; row < uint32_t(m_Height); ++row) m_RowIndices.emplace_back(row);
+	const uint32_t amountOfTiles{ uint32_t(((m_Width + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE) * ((m_Height + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE)) };
+	m_TileIndices.reserve(amountOfTiles);
+	for (uint32_t tile{}; tile < amountOfTiles; ++tile) m_TileIndices.emplace_back(tile);
+
+	m_GBuffer.resize(amountOfPixels);
+	m_PreviousGBuffer.resize(amountOfPixels);
+	m_Reservoirs.resize(amountOfPixels);
+	m_PreviousReservoirs.resize(amountOfPixels);
+	m_SpatialReservoirs.resize(amountOfPixels);
+	m_ColorBuffer.resize(amountOfPixels);
+	m_HistoryBuffer.resize(amountOfPixels);
+	m_NextHistoryBuffer.resize(amountOfPixels);
+	m_DeferredPixels.resize(amountOfPixels);
+	m_PixelCosts.resize(amountOfPixels);
+
+	//One extra ray per pixel on average
+	m_AARayBudget = amountOfPixels;
+
+	m_pDenoiser = new Denoiser(m_Width, m_Height);
+	m_pToneMapper = new ToneMapper();
+	m_pImageWriter = new ImageWriter("RayTracing_Buffer");
+	SetWorkerCount(GetDefaultWorkerCount());
 }
 
-void Renderer::Render(Scene* pScene) const
+Renderer::~Renderer()
 {
-	Camera& camera = pScene->GetCamera();
-	const Matrix& cameraToWorld{ camera.CalculateCameraToWorld() };
-	//const auto& materials = pScene->GetMaterials();
-	//const auto& lights = pScene->GetLights();
+	delete m_pDenoiser;
+	m_pDenoiser = nullptr;
 
-	const float aspectRatio{ float(m_Width) / m_Height };
-	Ray viewRay{ camera.origin};
+	delete m_pThreadPool;
+	m_pThreadPool = nullptr;
 
-	float fov{ tan(camera.fovAngle * TO_RADIANS / 2.f)  };
+	delete m_pToneMapper;
+	m_pToneMapper = nullptr;
 
-#if defined(PARALLEL_EXECUTION)
-	// Parallel logic
-	const uint32_t amountOfPixels{ uint32_t(m_Width * m_Height) };
-	std::vector<uint32_t> pixelIndices{};
+	//Waits for the frames that are still being written
+	delete m_pImageWriter;
+	m_pImageWriter = nullptr;
+
+	delete m_pFrameStream;
+	m_pFrameStream = nullptr;
+}
 
-	pixelIndices.reserve(amountOfPixels);
-	for (uint32_t index{}; index < amountOfPixels; ++index) pixelIndices.emplace_back(index);
+void Renderer::SetWorkerCount(uint32_t workerCount)
+{
+	delete m_pThreadPool;
+	m_pThreadPool = nullptr;
 
-	std::for_each(std::execution::par, pixelIndices.begin(), pixelIndices.end(), [&](int i) {
-		RenderPixel(pScene, i, fov, aspectRatio, cameraToWorld, camera.origin);
-		});
+	m_WorkerCount = std::max(workerCount, 1u);
+	if (m_WorkerCount > 1)
+		m_pThreadPool = new ThreadPool(m_WorkerCount - 1);
+	m_pDenoiser->SetThreadPool(m_pThreadPool);
+	m_WorkerStats = {};
+}
+
+uint32_t Renderer::GetDefaultWorkerCount()
+{
+#if defined(PARALLEL_EXECUTION)
+	return std::max(std::thread::hardware_concurrency(), 1u);
 #else
-	// Synchronous logic (no threading)
-	uint32_t amountOfPixels{ uint32_t(m_Width * m_Height) };
-	for (uint32_t pixelIndex{}; pixelIndex < amountOfPixels; pixelIndex++)
-		RenderPixel(pScene, pixelIndex, fov, aspectRatio, cameraToWorld, camera.origin);
+	return 1;
 #endif
-	//@END
-	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
 }
 
-void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin)const
+template<typename Element, typename Function>
+void Renderer::ParallelForEach(const std::vector<Element>& elements, const Function& function) const
 {
-	const auto& materials = pScene->GetMaterials();
+	if (!m_pThreadPool)
+	{
+		// Synchronous logic (no threading)
+		std::for_each(elements.begin(), elements.end(), function);
+		return;
+	}
 
-	const uint32_t px{ pixelIndex % m_Width }, py{ pixelIndex / m_Width };
-	const float cx{ (2 * ((px + 0.5f) / m_Width) - 1) * aspectRatio * fov };
-	const float cy{ (1 - (2 * ((py + 0.5f) / m_Height))) * fov };
+	// Parallel logic
+	m_pThreadPool->ParallelFor(uint32_t(elements.size()), [&](uint32_t index) { function(elements[index]); });
+}
 
-	ColorRGB finalColor{};
+template<typename Function>
+void Renderer::ForEachPixel(RenderStage stage, const Function& function) const
+{
+	//Neighbouring pixels hit the same geometry, and one profiler event per tile shows how the frame was spread over the threads
+	const int tilesX{ (m_Width + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE };
+	ParallelForEach(m_TileIndices, [&](uint32_t tileIndex) {
+		PROFILE_SCOPE("Tile", int32_t(tileIndex));
+		const HardwareCounterScope hardwareCounterScope{ stage };
+		const int startX{ int(tileIndex) % tilesX * RENDER_TILE_SIZE }, startY{ int(tileIndex) / tilesX * RENDER_TILE_SIZE };
+		const int endX{ std::min(startX + RENDER_TILE_SIZE, m_Width) }, endY{ std::min(startY + RENDER_TILE_SIZE, m_Height) };
+		for (int py{ startY }; py < endY; ++py)
+		{
+			for (int px{ startX }; px < endX; ++px)
+				function(uint32_t(px + py * m_Width));
+		}
+		});
+}
+
+template<typename Function>
+void Renderer::MeasurePixelCost(uint32_t pixelIndex, const Function& function)
+{
+	if (m_CurrentLightingMode != LightingMode::CostHeatmap)
+	{
+		function();
+		return;
+	}
+
+	if (m_HeatmapMetric == HeatmapMetric::IntersectionTests)
+	{
+		const auto countTests = []()
+		{
+			return RenderCounters::GetThreadCount(RenderCounter::AABBTests) + RenderCounters::GetThreadCount(RenderCounter::TriangleTests)
+				+ RenderCounters::GetThreadCount(RenderCounter::SphereTests) + RenderCounters::GetThreadCount(RenderCounter::PlaneTests);
+		};
+		const uint64_t startCount{ countTests() };
+		function();
+		m_PixelCosts[pixelIndex] += float(countTests() - startCount);
+		return;
+	}
 
-	Vector3 rayDirection{ cx, cy, 1 };
-	rayDirection = cameraToWorld.TransformVector(rayDirection).Normalized();
-	const Ray& viewRay{ cameraOrigin, rayDirection };
+	const auto start{ std::chrono::steady_clock::now() };
+	function();
+	m_PixelCosts[pixelIndex] += std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Renderer::Render(Scene* pScene)
+{
+	Render(pScene, pScene->GetCamera());
+}
+
+void Renderer::Render(Scene* pScene, Camera& camera)
+{
+	PROFILE_SCOPE("Renderer::Render");
+	const Matrix& cameraToWorld{ camera.CalculateCameraToWorld() };
+
+	const float aspectRatio{ float(m_Width) / m_Height };
+
+	float fov{ tan(camera.fovAngle * TO_RADIANS / 2.f)  };
+
+	//Streamed in geometry invalidates everything that was accumulated
+	if (pScene->GetGeometryVersion() != m_SceneGeometryVersion)
+	{
+		m_SceneGeometryVersion = pScene->GetGeometryVersion();
+		ResetHistory();
+	}
 
-	HitRecord closestHit{};
+	//Exact comparisons, any zoom or movement has to drop the history
+	const bool cameraMoved{ fov != m_PreviousFov
+		|| (cameraToWorld.GetTranslation() - m_PreviousCameraToWorld.GetTranslation()).SqrMagnitude() > 0.f
+		|| (cameraToWorld.GetAxisZ() - m_PreviousCameraToWorld.GetAxisZ()).SqrMagnitude() > 0.f };
+
+	std::swap(m_GBuffer, m_PreviousGBuffer);
+
+	if (m_CurrentLightingMode == LightingMode::CostHeatmap)
+		std::fill(m_PixelCosts.begin(), m_PixelCosts.end(), 0.f);
+
+	if (m_ReSTIREnabled)
+	{
+		RenderReSTIR(pScene, fov, aspectRatio, cameraToWorld, camera.origin);
+	}
+	else if (pScene->GetClusterCache())
+	{
+		RenderStreamed(pScene, fov, aspectRatio, cameraToWorld, camera.origin);
+	}
+	else
+	{
+		PROFILE_SCOPE("Renderer::RenderPixels");
+		ForEachPixel(RenderStage::Tracing, [&](uint32_t i) {
+			MeasurePixelCost(i, [&]() { RenderPixel(pScene, i, fov, aspectRatio, cameraToWorld, camera.origin); });
+			});
+	}
+
+	m_AARaysUsed = 0;
+	if (m_AdaptiveAAEnabled)
+		RenderAdaptiveAA(pScene, fov, aspectRatio, cameraToWorld, camera.origin);
+
+	if (m_AccumulationEnabled)
+		AccumulateHistory(cameraMoved);
+
+	//Denoised output is only displayed, the accumulated history stays unfiltered
+	if (m_DenoiserEnabled)
+	{
+		PROFILE_SCOPE("Denoiser::Apply");
+		m_pDenoiser->Apply(m_GBuffer, m_ColorBuffer);
+	}
+
+	//Replaces the displayed frame only, history and G-buffer keep the shaded result
+	if (m_CurrentLightingMode == LightingMode::CostHeatmap)
+		ApplyCostHeatmap();
+
+	Present();
+
+	if (m_IsRecordingSequence)
+		SaveBufferToImage();
+
+	if (m_pFrameStream)
+	{
+		PROFILE_SCOPE("FrameStream::Submit");
+		m_pFrameStream->Submit(m_pTarget->GetPixels(), m_pTarget->GetPitch(), m_pTarget->GetPixelFormat());
+	}
+
+	m_PreviousCameraToWorld = cameraToWorld;
+	m_PreviousFov = fov;
+	m_HasHistory = true;
+	++m_FrameIndex;
+
+	//Every worker is idle again, so the counters hold exactly this frame
+	if (RenderCounters::IsEnabled())
+		m_FrameStats = RenderCounters::Collect();
+	if (HardwareCounters::IsEnabled())
+		m_HardwareStats = HardwareCounters::Collect();
+	if (m_pThreadPool)
+		m_WorkerStats = m_pThreadPool->CollectParallelStats();
+}
+
+void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin)
+{
+	const float px{ float(pixelIndex % m_Width) + 0.5f }, py{ float(pixelIndex / m_Width) + 0.5f };
+	const Ray viewRay{ cameraOrigin, CalculateViewRayDirection(px, py, fov, aspectRatio, cameraToWorld) };
+	COUNT_RENDER_STAT(PrimaryRays);
+
+	m_GBuffer[pixelIndex] = {};
+	m_ColorBuffer[pixelIndex] = ShadeViewRay(pScene, viewRay, m_GBuffer[pixelIndex]);
+}
+
+ColorRGB Renderer::ShadeViewRay(Scene* pScene, const Ray& viewRay, HitRecord& closestHit) const
+{
+	const auto& materials = pScene->GetMaterials();
+
+	ColorRGB finalColor{};
 
 	pScene->GetClosestHit(viewRay, closestHit);
 
@@ -93,32 +310,415 @@ void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float
 			if (renderShadow)
 				continue;
 
-			switch (m_CurrentLightingMode)
+			finalColor += CalculateLightContribution(materials[closestHit.materialIndex], light, closestHit, -viewRay.direction);
+		}
+	}
+
+	return finalColor;
+}
+
+void Renderer::RenderStreamed(Scene* pScene, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin)
+{
+	PROFILE_SCOPE("Renderer::RenderStreamed");
+	//Rays skip clusters that are not resident and queue their loads, the whole frame keeps tracing meanwhile
+	ForEachPixel(RenderStage::Tracing, [&](uint32_t i) {
+		ClusterCache::BeginDeferring();
+		MeasurePixelCost(i, [&]() { RenderPixel(pScene, i, fov, aspectRatio, cameraToWorld, cameraOrigin); });
+		m_DeferredPixels[i] = ClusterCache::EndDeferring();
+		});
+
+	std::vector<uint32_t> deferredPixels{};
+	std::copy_if(m_PixelIndices.begin(), m_PixelIndices.end(), std::back_inserter(deferredPixels), [this](uint32_t i) { return m_DeferredPixels[i]; });
+
+	//Deferred pixels are retraced in batches, deeper clusters can still be missing, so the last pass loads them in place
+	for (int pass{ 1 }; !deferredPixels.empty(); ++pass)
+	{
+		pScene->GetClusterCache()->WaitForPendingLoads();
+
+		//Batches of a tile worth of pixels, so the hardware counters are read per batch instead of per pixel
+		std::vector<uint32_t> batchStarts{};
+		for (uint32_t start{}; start < deferredPixels.size(); start += STREAMING_DEFERRED_BATCH_SIZE)
+			batchStarts.push_back(start);
+
+		const bool canDefer{ pass < STREAMING_MAX_DEFERRED_PASSES };
+		ParallelForEach(batchStarts, [&](uint32_t start) {
+			const HardwareCounterScope hardwareCounterScope{ RenderStage::Tracing };
+			const uint32_t end{ std::min(start + STREAMING_DEFERRED_BATCH_SIZE, uint32_t(deferredPixels.size())) };
+			for (uint32_t batchIndex{ start }; batchIndex < end; ++batchIndex)
+			{
+				const uint32_t i{ deferredPixels[batchIndex] };
+				if (canDefer)
+					ClusterCache::BeginDeferring();
+				MeasurePixelCost(i, [&]() { RenderPixel(pScene, i, fov, aspectRatio, cameraToWorld, cameraOrigin); });
+				m_DeferredPixels[i] = canDefer && ClusterCache::EndDeferring();
+			}
+			});
+
+		std::erase_if(deferredPixels, [this](uint32_t i) { return !m_DeferredPixels[i]; });
+	}
+}
+
+void Renderer::RenderReSTIR(Scene* pScene, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin)
+{
+	PROFILE_SCOPE("Renderer::RenderReSTIR");
+	const auto& materials = pScene->GetMaterials();
+	const auto& lights = pScene->GetLights();
+	const int lightCount{ int(lights.size()) };
+
+	//Target pdf: unshadowed contribution of a light at a G-buffer sample
+	auto targetPdf = [&](int lightIndex, const HitRecord& hitRecord) -> float
+	{
+		if (lightIndex < 0 || lightIndex >= lightCount)
+			return 0.f;
+		const Vector3 viewDirection{ (cameraOrigin - hitRecord.origin).Normalized() };
+		return std::max(0.f, CalculateLightContribution(materials[hitRecord.materialIndex], lights[lightIndex], hitRecord, viewDirection).Luminance());
+	};
+
+	std::swap(m_Reservoirs, m_PreviousReservoirs);
+
+	//1. Primary visibility, initial candidates and temporal reuse
+	ForEachPixel(RenderStage::Tracing, [&](uint32_t pixelIndex) {
+		MeasurePixelCost(pixelIndex, [&]() {
+			HitRecord& hitRecord{ m_GBuffer[pixelIndex] };
+			Reservoir& reservoir{ m_Reservoirs[pixelIndex] };
+			hitRecord = {};
+			reservoir = {};
+
+			const float px{ float(pixelIndex % m_Width) + 0.5f }, py{ float(pixelIndex / m_Width) + 0.5f };
+			const Ray viewRay{ cameraOrigin, CalculateViewRayDirection(px, py, fov, aspectRatio, cameraToWorld) };
+			COUNT_RENDER_STAT(PrimaryRays);
+			pScene->GetClosestHit(viewRay, hitRecord);
+			if (!hitRecord.didHit || lightCount == 0)
+				return;
+
+			uint32_t seed{ PcgHash(pixelIndex ^ PcgHash(m_FrameIndex)) };
+
+			//Resampled importance sampling from uniformly chosen lights (source pdf = 1 / lightCount)
+			const int candidateCount{ std::min(RESTIR_INITIAL_CANDIDATES, lightCount) };
+			for (int candidate{}; candidate < candidateCount; ++candidate)
+			{
+				const int lightIndex{ std::min(int(RandomFloat(seed) * lightCount), lightCount - 1) };
+				const float candidatePdf{ targetPdf(lightIndex, hitRecord) };
+				reservoir.Update(lightIndex, candidatePdf * lightCount, candidatePdf, RandomFloat(seed));
+			}
+			reservoir.FinalizeWeight();
+
+			uint32_t previousPixelIndex{};
+			if (m_HasHistory && ReprojectToPreviousFrame(hitRecord.origin, previousPixelIndex)
+				&& IsSimilarSurface(hitRecord, m_PreviousGBuffer[previousPixelIndex]))
 			{
-			case LightingMode::ObservedArea:
-				finalColor.r = finalColor.g = finalColor.b += CalculateObservedArea(lightRay, closestHit.normal);
-				break;
-			case LightingMode::Radiance:
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin);
-				break;
-			case LightingMode::BRDF:
-				finalColor += materials[closestHit.materialIndex]->Shade(closestHit, directionToLight, -rayDirection);
-				break;
-			case LightingMode::Combined:
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin)
-					* materials[closestHit.materialIndex]->Shade(closestHit, directionToLight, -rayDirection)
-					* CalculateObservedArea(lightRay, closestHit.normal);
-				break;
+				Reservoir previous{ m_PreviousReservoirs[previousPixelIndex] };
+				previous.sampleCount = std::min(previous.sampleCount, RESTIR_TEMPORAL_HISTORY_LIMIT * reservoir.sampleCount);
+				reservoir.Merge(previous, targetPdf(previous.lightIndex, hitRecord), RandomFloat(seed));
+				reservoir.FinalizeWeight();
 			}
+			});
+		});
+
+	//2. Spatial reuse from random neighbours with a similar surface
+	ForEachPixel(RenderStage::Tracing, [&](uint32_t pixelIndex) {
+		const HitRecord& hitRecord{ m_GBuffer[pixelIndex] };
+		Reservoir reservoir{ m_Reservoirs[pixelIndex] };
+		if (hitRecord.didHit)
+		{
+			uint32_t seed{ PcgHash(pixelIndex ^ PcgHash(m_FrameIndex + 0x9e3779b9u)) };
+			const int px{ int(pixelIndex % m_Width) }, py{ int(pixelIndex / m_Width) };
+
+			for (int neighbour{}; neighbour < RESTIR_SPATIAL_NEIGHBOURS; ++neighbour)
+			{
+				const int nx{ px + int((RandomFloat(seed) * 2.f - 1.f) * RESTIR_SPATIAL_RADIUS) };
+				const int ny{ py + int((RandomFloat(seed) * 2.f - 1.f) * RESTIR_SPATIAL_RADIUS) };
+				if (nx < 0 || ny < 0 || nx >= m_Width || ny >= m_Height)
+					continue;
+
+				const uint32_t neighbourIndex{ uint32_t(nx + ny * m_Width) };
+				if (neighbourIndex == pixelIndex || !IsSimilarSurface(hitRecord, m_GBuffer[neighbourIndex]))
+					continue;
+
+				const Reservoir& other{ m_Reservoirs[neighbourIndex] };
+				reservoir.Merge(other, targetPdf(other.lightIndex, hitRecord), RandomFloat(seed));
+			}
+			reservoir.FinalizeWeight();
 		}
+		m_SpatialReservoirs[pixelIndex] = reservoir;
+		});
+	std::swap(m_Reservoirs, m_SpatialReservoirs);
+
+	//3. Shade with a single shadow ray towards the selected light
+	ForEachPixel(RenderStage::Tracing, [&](uint32_t pixelIndex) {
+		MeasurePixelCost(pixelIndex, [&]() {
+			const HitRecord& hitRecord{ m_GBuffer[pixelIndex] };
+			Reservoir& reservoir{ m_Reservoirs[pixelIndex] };
+
+			ColorRGB finalColor{};
+			if (hitRecord.didHit && reservoir.lightIndex >= 0)
+			{
+				const Light& light{ lights[reservoir.lightIndex] };
+
+				Vector3 directionToLight{ LightUtils::GetDirectionToLight(light, hitRecord.origin) };
+				Ray lightRay{ hitRecord.origin, {}, 0.01f, };
+				lightRay.max = directionToLight.Normalize();
+				lightRay.direction = directionToLight;
+
+				//Occluded samples keep a zero weight so they are not propagated to the next frame
+				if (m_ShadowsEnabled && pScene->DoesHit(lightRay))
+					reservoir.contributionWeight = 0.f;
+
+				const Vector3 viewDirection{ (cameraOrigin - hitRecord.origin).Normalized() };
+				finalColor = CalculateLightContribution(materials[hitRecord.materialIndex], light, hitRecord, viewDirection)
+					* reservoir.contributionWeight;
+			}
+			m_ColorBuffer[pixelIndex] = finalColor;
+			});
+		});
+}
+
+void Renderer::RenderAdaptiveAA(Scene* pScene, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin)
+{
+	PROFILE_SCOPE("Renderer::RenderAdaptiveAA");
+	const uint32_t tilesX{ uint32_t((m_Width + AA_TILE_SIZE - 1) / AA_TILE_SIZE) };
+	const uint32_t tilesY{ uint32_t((m_Height + AA_TILE_SIZE - 1) / AA_TILE_SIZE) };
+
+	m_AATiles.resize(tilesX * tilesY);
+	for (uint32_t tileIndex{}; tileIndex < m_AATiles.size(); ++tileIndex)
+		m_AATiles[tileIndex].tileIndex = tileIndex;
+
+	//1. Estimate the contrast of every tile from the 1 spp result
+	ParallelForEach(m_AATiles, [&](const AATile& tile) {
+		const HardwareCounterScope hardwareCounterScope{ RenderStage::AntiAliasing };
+		m_AATiles[tile.tileIndex].contrast = CalculateTileContrast(tile.tileIndex);
+		});
+
+	//2. Hand out stratified sample grids to the highest contrast tiles until the budget runs out
+	std::sort(m_AATiles.begin(), m_AATiles.end(), [](const AATile& a, const AATile& b) { return a.contrast > b.contrast; });
+
+	uint32_t raysLeft{ m_AARayBudget };
+	size_t selectedTiles{};
+	for (AATile& tile : m_AATiles)
+	{
+		if (tile.contrast < AA_CONTRAST_THRESHOLD)
+			break;
+
+		const uint32_t tileX{ tile.tileIndex % tilesX }, tileY{ tile.tileIndex / tilesX };
+		const uint32_t tilePixels{ uint32_t(std::min(AA_TILE_SIZE, m_Width - int(tileX) * AA_TILE_SIZE)
+			* std::min(AA_TILE_SIZE, m_Height - int(tileY) * AA_TILE_SIZE)) };
+
+		//Full contrast gets the 4x4 grid, lower contrast gets a coarser one
+		int samplesPerSide{ std::clamp(int(ceilf(tile.contrast * AA_MAX_SAMPLES_PER_SIDE)), 2, AA_MAX_SAMPLES_PER_SIDE) };
+		while (samplesPerSide >= 2 && uint32_t(samplesPerSide * samplesPerSide) * tilePixels > raysLeft)
+			--samplesPerSide;
+		if (samplesPerSide < 2)
+			break;
+
+		tile.samplesPerSide = samplesPerSide;
+		raysLeft -= uint32_t(samplesPerSide * samplesPerSide) * tilePixels;
+		++selectedTiles;
 	}
-	//Update Color in Buffer
-	finalColor.MaxToOne();
+	m_AATiles.resize(selectedTiles);
+	m_AARaysUsed = m_AARayBudget - raysLeft;
+
+	//3. Trace the extra samples, the original center sample is kept in the average
+	ParallelForEach(m_AATiles, [&](const AATile& tile) {
+		const HardwareCounterScope hardwareCounterScope{ RenderStage::AntiAliasing };
+		const int startX{ int(tile.tileIndex % tilesX) * AA_TILE_SIZE }, startY{ int(tile.tileIndex / tilesX) * AA_TILE_SIZE };
+		const int endX{ std::min(startX + AA_TILE_SIZE, m_Width) }, endY{ std::min(startY + AA_TILE_SIZE, m_Height) };
+		const float strataSize{ 1.f / tile.samplesPerSide };
 
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
+		for (int py{ startY }; py < endY; ++py)
+		{
+			for (int px{ startX }; px < endX; ++px)
+			{
+				const uint32_t pixelIndex{ uint32_t(px + py * m_Width) };
+				uint32_t seed{ PcgHash(pixelIndex ^ PcgHash(m_FrameIndex + 0x85ebca6bu)) };
+
+				ColorRGB color{ m_ColorBuffer[pixelIndex] };
+				MeasurePixelCost(pixelIndex, [&]() {
+					for (int sy{}; sy < tile.samplesPerSide; ++sy)
+					{
+						for (int sx{}; sx < tile.samplesPerSide; ++sx)
+						{
+							const float x{ px + (sx + RandomFloat(seed)) * strataSize };
+							const float y{ py + (sy + RandomFloat(seed)) * strataSize };
+							const Ray viewRay{ cameraOrigin, CalculateViewRayDirection(x, y, fov, aspectRatio, cameraToWorld) };
+							COUNT_RENDER_STAT(PrimaryRays);
+							HitRecord closestHit{};
+							color += ShadeViewRay(pScene, viewRay, closestHit);
+						}
+					}
+					});
+				m_ColorBuffer[pixelIndex] = color / float(tile.samplesPerSide * tile.samplesPerSide + 1);
+			}
+		}
+		});
+}
+
+float Renderer::CalculateTileContrast(uint32_t tileIndex) const
+{
+	const int tilesX{ (m_Width + AA_TILE_SIZE - 1) / AA_TILE_SIZE };
+	const int startX{ int(tileIndex) % tilesX * AA_TILE_SIZE }, startY{ int(tileIndex) / tilesX * AA_TILE_SIZE };
+
+	//Include a one pixel border so edges on tile boundaries are detected on both sides
+	const int minX{ std::max(startX - 1, 0) }, maxX{ std::min(startX + AA_TILE_SIZE + 1, m_Width) };
+	const int minY{ std::max(startY - 1, 0) }, maxY{ std::min(startY + AA_TILE_SIZE + 1, m_Height) };
+
+	float minLuminance{ FLT_MAX }, maxLuminance{ 0.f };
+	for (int py{ minY }; py < maxY; ++py)
+	{
+		for (int px{ minX }; px < maxX; ++px)
+		{
+			ColorRGB color{ m_ColorBuffer[px + py * m_Width] };
+			color.MaxToOne();
+			const float luminance{ color.Luminance() };
+			minLuminance = std::min(minLuminance, luminance);
+			maxLuminance = std::max(maxLuminance, luminance);
+		}
+	}
+
+	//Michelson contrast in [0, 1]
+	return (maxLuminance - minLuminance) / std::max(maxLuminance + minLuminance, 0.01f);
+}
+
+void Renderer::AccumulateHistory(bool cameraMoved)
+{
+	PROFILE_SCOPE("Renderer::AccumulateHistory");
+	const float historyLimit{ cameraMoved ? TEMPORAL_MOVING_HISTORY_LIMIT : TEMPORAL_STATIC_HISTORY_LIMIT };
+
+	ForEachPixel(RenderStage::Accumulation, [&](uint32_t pixelIndex) {
+		const HitRecord& hitRecord{ m_GBuffer[pixelIndex] };
+		ColorRGB& color{ m_ColorBuffer[pixelIndex] };
+
+		//Disocclusion: the reprojected history has to belong to the same surface
+		uint32_t previousPixelIndex{ pixelIndex };
+		bool isHistoryValid{ m_HasHistory };
+		if (isHistoryValid && hitRecord.didHit)
+			isHistoryValid = ReprojectToPreviousFrame(hitRecord.origin, previousPixelIndex)
+				&& IsSimilarSurface(hitRecord, m_PreviousGBuffer[previousPixelIndex]);
+		else if (isHistoryValid)
+			isHistoryValid = !cameraMoved && !m_PreviousGBuffer[pixelIndex].didHit;
+
+		float historyLength{};
+		if (isHistoryValid)
+		{
+			const HistorySample& history{ m_HistoryBuffer[previousPixelIndex] };
+			historyLength = std::min(history.length, historyLimit);
+			color = (history.color * historyLength + color) / (historyLength + 1.f);
+		}
+		m_NextHistoryBuffer[pixelIndex] = { color, historyLength + 1.f };
+		});
+
+	std::swap(m_HistoryBuffer, m_NextHistoryBuffer);
+}
+
+bool Renderer::IsSimilarSurface(const HitRecord& current, const HitRecord& previous) const
+{
+	return previous.didHit && current.materialIndex == previous.materialIndex
+		&& Vector3::Dot(current.normal, previous.normal) > 0.9f
+		&& (current.origin - previous.origin).SqrMagnitude() < Square(0.05f * current.t);
+}
+
+bool Renderer::ReprojectToPreviousFrame(const Vector3& position, uint32_t& previousPixelIndex) const
+{
+	//Inverse of the view ray construction, the camera basis is orthonormal
+	const Vector3 toPosition{ position - m_PreviousCameraToWorld.GetTranslation() };
+	const float depth{ Vector3::Dot(toPosition, m_PreviousCameraToWorld.GetAxisZ()) };
+	if (depth <= 0.f)
+		return false;
+
+	const float aspectRatio{ float(m_Width) / m_Height };
+	const float cx{ Vector3::Dot(toPosition, m_PreviousCameraToWorld.GetAxisX()) / depth };
+	const float cy{ Vector3::Dot(toPosition, m_PreviousCameraToWorld.GetAxisY()) / depth };
+
+	const float px{ (cx / (aspectRatio * m_PreviousFov) + 1.f) * 0.5f * m_Width };
+	const float py{ (1.f - cy / m_PreviousFov) * 0.5f * m_Height };
+	if (px < 0.f || py < 0.f || px >= m_Width || py >= m_Height)
+		return false;
+
+	previousPixelIndex = uint32_t(px) + uint32_t(py) * m_Width;
+	return true;
+}
+
+Vector3 Renderer::CalculateViewRayDirection(float x, float y, float fov, float aspectRatio, const Matrix& cameraToWorld) const
+{
+	//x and y are in pixel space, the pixel center is at (px + 0.5f, py + 0.5f)
+	const float cx{ (2 * (x / m_Width) - 1) * aspectRatio * fov };
+	const float cy{ (1 - (2 * (y / m_Height))) * fov };
+
+	const Vector3 rayDirection{ cx, cy, 1 };
+	return cameraToWorld.TransformVector(rayDirection).Normalized();
+}
+
+ColorRGB Renderer::CalculateLightContribution(Material* pMaterial, const Light& light, const HitRecord& hitRecord, const Vector3& viewDirection) const
+{
+	Vector3 directionToLight{ LightUtils::GetDirectionToLight(light, hitRecord.origin) };
+	directionToLight.Normalize();
+	const Ray lightRay{ hitRecord.origin, directionToLight };
+
+	switch (m_CurrentLightingMode)
+	{
+	case LightingMode::ObservedArea:
+	{
+		const float observedArea{ CalculateObservedArea(lightRay, hitRecord.normal) };
+		return { observedArea, observedArea, observedArea };
+	}
+	case LightingMode::Radiance:
+		return LightUtils::GetRadiance(light, hitRecord.origin);
+	case LightingMode::BRDF:
+		COUNT_RENDER_STAT(ShadeCalls);
+		return pMaterial->Shade(hitRecord, directionToLight, viewDirection);
+	case LightingMode::Combined:
+	case LightingMode::CostHeatmap:
+		COUNT_RENDER_STAT(ShadeCalls);
+		return LightUtils::GetRadiance(light, hitRecord.origin)
+			* pMaterial->Shade(hitRecord, directionToLight, viewDirection)
+			* CalculateObservedArea(lightRay, hitRecord.normal);
+	}
+	return {};
+}
+
+void Renderer::ApplyCostHeatmap()
+{
+	//A percentile instead of the maximum, so a few expensive pixels do not turn the rest of the image blue
+	std::vector<float> sortedCosts{ m_PixelCosts };
+	const auto scaleCost{ sortedCosts.begin() + ptrdiff_t(float(sortedCosts.size() - 1) * HEATMAP_SCALE_PERCENTILE) };
+	std::nth_element(sortedCosts.begin(), scaleCost, sortedCosts.end());
+	m_HeatmapScale = std::max(*scaleCost, FLT_MIN);
+
+	//Blue (cheap) over cyan, green and yellow to red (at or above the scale)
+	static const ColorRGB heatmapColors[]{ { 0.f, 0.f, 0.5f }, { 0.f, 0.5f, 1.f }, { 0.f, 1.f, 0.5f }, { 1.f, 1.f, 0.f }, { 1.f, 0.f, 0.f } };
+	constexpr int lastColor{ int(std::size(heatmapColors)) - 1 };
+
+	ForEachPixel(RenderStage::Present, [&](uint32_t pixelIndex) {
+		const float position{ std::clamp(m_PixelCosts[pixelIndex] / m_HeatmapScale, 0.f, 1.f) * lastColor };
+		const int index{ std::min(int(position), lastColor - 1) };
+		const float factor{ position - float(index) };
+		m_ColorBuffer[pixelIndex] = heatmapColors[index] * (1.f - factor) + heatmapColors[index + 1] * factor;
+		});
+}
+
+void Renderer::Present() const
+{
+	PROFILE_SCOPE("Renderer::Present");
+	//The heatmap is packed as is, exposure and tone mapping would shift its colours
+	if (m_CurrentLightingMode == LightingMode::CostHeatmap)
+	{
+		const PixelFormat& format{ m_pTarget->GetPixelFormat() };
+		ParallelForEach(m_RowIndices, [&](uint32_t row) {
+			const HardwareCounterScope hardwareCounterScope{ RenderStage::Present };
+			uint32_t* pRow{ m_pTarget->GetRow(row) };
+			for (int x{}; x < m_Width; ++x)
+			{
+				const ColorRGB& color{ m_ColorBuffer[row * m_Width + x] };
+				pRow[x] = uint32_t(color.r * 255.f + 0.5f) << format.redShift | uint32_t(color.g * 255.f + 0.5f) << format.greenShift
+					| uint32_t(color.b * 255.f + 0.5f) << format.blueShift | format.alphaMask;
+			}
+			});
+		return;
+	}
+
+	ParallelForEach(m_RowIndices, [&](uint32_t row) {
+		const HardwareCounterScope hardwareCounterScope{ RenderStage::Present };
+		m_pToneMapper->Apply(&m_ColorBuffer[row * m_Width], m_pTarget->GetRow(row), uint32_t(m_Width), m_pTarget->GetPixelFormat());
+		});
 }
 
 float Renderer::CalculateObservedArea(const Ray& ray, const Vector3& normal) const
@@ -128,10 +728,64 @@ float Renderer::CalculateObservedArea(const Ray& ray, const Vector3& normal) con
 
 void Renderer::CycleLightingMode()
 {
-	m_CurrentLightingMode = static_cast<LightingMode>((int(m_CurrentLightingMode) + 1) % 4);
+	//With the counters compiled in, the timed heatmap is followed by the one counting intersection tests
+	if (m_CurrentLightingMode == LightingMode::CostHeatmap && m_HeatmapMetric == HeatmapMetric::Nanoseconds && RenderCounters::IsEnabled())
+		m_HeatmapMetric = HeatmapMetric::IntersectionTests;
+	else
+	{
+		m_CurrentLightingMode = static_cast<LightingMode>((int(m_CurrentLightingMode) + 1) % 5);
+		m_HeatmapMetric = HeatmapMetric::Nanoseconds;
+	}
+	ResetHistory();
+}
+
+void Renderer::ShowCostHeatmap(HeatmapMetric metric)
+{
+	m_CurrentLightingMode = LightingMode::CostHeatmap;
+	m_HeatmapMetric = RenderCounters::IsEnabled() ? metric : HeatmapMetric::Nanoseconds;
+	ResetHistory();
+}
+
+std::string Renderer::GetHeatmapLegend() const
+{
+	if (m_CurrentLightingMode != LightingMode::CostHeatmap)
+		return {};
+	std::ostringstream legend{};
+	legend << "Heatmap: red = " << m_HeatmapScale << (m_HeatmapMetric == HeatmapMetric::Nanoseconds ? " ns" : " intersection tests") << " per pixel";
+	return legend.str();
+}
+
+std::string Renderer::SaveBufferToImage()
+{
+	PROFILE_SCOPE("Renderer::SaveBufferToImage");
+	return m_pImageWriter->Submit(m_ImageFormat, uint32_t(m_Width), uint32_t(m_Height), m_pTarget->GetPixels(),
+		m_pTarget->GetPitch(), m_pTarget->GetPixelFormat(), m_ColorBuffer.data());
+}
+
+void Renderer::ToggleImageSequence()
+{
+	m_IsRecordingSequence = !m_IsRecordingSequence;
+	if (!m_IsRecordingSequence)
+		m_pImageWriter->Flush();
+	std::cout << (m_IsRecordingSequence ? "Recording " : "Stopped recording ") << ImageWriter::GetExtension(m_ImageFormat) << " sequence" << std::endl;
+}
+
+bool Renderer::StartFrameStream(const std::string& destination, FrameStreamFormat format, uint32_t frameRate)
+{
+	delete m_pFrameStream;
+	m_pFrameStream = new FrameStream(destination, format, uint32_t(m_Width), uint32_t(m_Height), frameRate);
+	return m_pFrameStream->IsOpen();
+}
+
+void Renderer::SetImageOutput(const std::string& prefix, ImageFormat format)
+{
+	delete m_pImageWriter;
+	m_pImageWriter = new ImageWriter(prefix);
+	m_ImageFormat = format;
 }
 
-bool Renderer::SaveBufferToImage() const
+void Renderer::CycleImageFormat()
 {
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+	m_ImageFormat = static_cast<ImageFormat>((int(m_ImageFormat) + 1) % 3);
+	std::cout << "Image format: " << ImageWriter::GetExtension(m_ImageFormat) << std::endl;
 }
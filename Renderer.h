@@ -1,53 +1,198 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <vector>
 #include "Vector3.h"
 #include "DataTypes.h"
-
-struct SDL_Window;
-struct SDL_Surface;
+#include "RenderCounters.h"
+#include "HardwareCounters.h"
+#include "ThreadPool.h"
 
 namespace dae
 {
 	class Scene;
+	class RenderTarget;
+	struct Camera;
+	class Material;
+	class Denoiser;
+	class ToneMapper;
+	class ImageWriter;
+	class FrameStream;
+	enum class ImageFormat;
+	enum class FrameStreamFormat;
+
+	//What the cost heatmap shows per pixel
+	enum class HeatmapMetric
+	{
+		Nanoseconds,
+		//Sphere, plane, triangle and AABB tests, needs RENDER_COUNTERS
+		IntersectionTests
+	};
 
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
-		~Renderer() = default;
+		//Presents into the target, which has to outlive the renderer
+		explicit Renderer(RenderTarget* pTarget);
+		~Renderer();
 
 		Renderer(const Renderer&) = delete;
 		Renderer(Renderer&&) noexcept = delete;
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Render(Scene* pScene) const;
+		void Render(Scene* pScene);
+		void Render(Scene* pScene, Camera& camera);
 
-		void RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin)const;
+		void RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin);
 
-		bool SaveBufferToImage() const;
+		//Queues the current frame for writing, returns the file name it will be written to
+		std::string SaveBufferToImage();
+		//Writes every rendered frame until toggled again
+		void ToggleImageSequence();
+		void CycleImageFormat();
+		//Frames saved from now on are written as <prefix>_00000.<format>, ...
+		void SetImageOutput(const std::string& prefix, ImageFormat format);
+		//Streams every rendered frame to an external encoder, see FrameStream for the destinations
+		bool StartFrameStream(const std::string& destination, FrameStreamFormat format, uint32_t frameRate);
 
 		void CycleLightingMode();
-		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; };
+		//Replaces the image by the false-colour cost of every pixel until the lighting mode is cycled
+		void ShowCostHeatmap(HeatmapMetric metric);
+		//Value shown in red by the last heatmap frame, empty when the heatmap is off
+		std::string GetHeatmapLegend() const;
+		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; ResetHistory(); };
+		void ToggleReSTIR() { m_ReSTIREnabled = !m_ReSTIREnabled; ResetHistory(); };
+		void ToggleAdaptiveAA() { m_AdaptiveAAEnabled = !m_AdaptiveAAEnabled; ResetHistory(); };
+		void ToggleAccumulation() { m_AccumulationEnabled = !m_AccumulationEnabled; ResetHistory(); };
+		void ToggleDenoiser() { m_DenoiserEnabled = !m_DenoiserEnabled; };
+		Denoiser* GetDenoiser() const { return m_pDenoiser; };
+		ToneMapper* GetToneMapper() const { return m_pToneMapper; };
+		void ResetHistory() { m_HasHistory = false; };
+		void SetAARayBudget(uint32_t rayBudget) { m_AARayBudget = rayBudget; };
+		uint32_t GetAARaysUsed() const { return m_AARaysUsed; };
+		//Camera rays of the last frame, one per pixel plus the extra anti-aliasing rays
+		uint64_t GetPrimaryRayCount() const { return uint64_t(m_Width) * uint64_t(m_Height) + m_AARaysUsed; };
+		uint32_t GetWidth() const { return uint32_t(m_Width); };
+		uint32_t GetHeight() const { return uint32_t(m_Height); };
+		//Counters of the last frame, all zero unless RENDER_COUNTERS is defined
+		const RenderStats& GetFrameStats() const { return m_FrameStats; };
+		//CPU counters of the last frame per stage, all zero until HardwareCounters::Enable succeeded
+		const HardwareStats& GetHardwareStats() const { return m_HardwareStats; };
+		//Threads rendering a frame, the calling thread included
+		uint32_t GetWorkerCount() const { return m_WorkerCount; };
+		//Restarts the worker threads, 1 renders on the calling thread only. Call it between frames
+		void SetWorkerCount(uint32_t workerCount);
+		//Time the workers spent in the parallel loops of the last frame and how long each of them sat idle
+		const ParallelStats& GetWorkerStats() const { return m_WorkerStats; };
+		//Hardware threads, 1 without PARALLEL_EXECUTION
+		static uint32_t GetDefaultWorkerCount();
 	private:
 		enum class LightingMode
 		{
 			ObservedArea,
 			Radiance,
 			BRDF,
-			Combined
+			Combined,
+			//Shades like Combined, then shows what every pixel cost
+			CostHeatmap
 		};
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
+		HeatmapMetric m_HeatmapMetric{ HeatmapMetric::Nanoseconds };
 		bool m_ShadowsEnabled{ true };
-		SDL_Window* m_pWindow{};
-
-		SDL_Surface* m_pBuffer{};
-		uint32_t* m_pBufferPixels{};
+		bool m_ReSTIREnabled{ false };
+		bool m_AdaptiveAAEnabled{ false };
+		bool m_AccumulationEnabled{ false };
+		bool m_DenoiserEnabled{ false };
+		RenderTarget* m_pTarget{};
 
 		int m_Width{};
 		int m_Height{};
 
+		std::vector<uint32_t> m_PixelIndices{};
+		std::vector<uint32_t> m_RowIndices{};
+		std::vector<uint32_t> m_TileIndices{};
+
+		//Pixels whose rays skipped clusters of out of core meshes that were not resident yet
+		std::vector<uint8_t> m_DeferredPixels{};
+
+		//Linear HDR framebuffer, tone mapped into the surface by Present
+		std::vector<ColorRGB> m_ColorBuffer{};
+
+		//Cost of every pixel summed over all passes of the frame, only filled while the heatmap is shown
+		std::vector<float> m_PixelCosts{};
+		float m_HeatmapScale{};
+
+		//Adaptive anti-aliasing, extra rays per frame are capped by the budget
+		struct AATile
+		{
+			uint32_t tileIndex{};
+			float contrast{};
+			int samplesPerSide{};
+		};
+		std::vector<AATile> m_AATiles{};
+		uint32_t m_AARayBudget{};
+		uint32_t m_AARaysUsed{};
+
+		//Temporal accumulation, HDR history reprojected with the previous camera and G-buffer
+		struct HistorySample
+		{
+			ColorRGB color{};
+			float length{};
+		};
+		std::vector<HistorySample> m_HistoryBuffer{};
+		std::vector<HistorySample> m_NextHistoryBuffer{};
+
+		//Worker count - 1 threads, the thread calling Render is the remaining worker. nullptr with a single worker
+		ThreadPool* m_pThreadPool{};
+		uint32_t m_WorkerCount{ 1 };
+		ParallelStats m_WorkerStats{};
+
+		Denoiser* m_pDenoiser{};
+		ToneMapper* m_pToneMapper{};
+
+		ImageWriter* m_pImageWriter{};
+		ImageFormat m_ImageFormat{};
+		bool m_IsRecordingSequence{ false };
+		FrameStream* m_pFrameStream{};
+
+		//Primary hits of this and the previous frame, reservoirs are only used by ReSTIR
+		std::vector<HitRecord> m_GBuffer{};
+		std::vector<HitRecord> m_PreviousGBuffer{};
+		std::vector<Reservoir> m_Reservoirs{};
+		std::vector<Reservoir> m_PreviousReservoirs{};
+		std::vector<Reservoir> m_SpatialReservoirs{};
+
+		uint32_t m_FrameIndex{};
+		uint32_t m_SceneGeometryVersion{};
+		RenderStats m_FrameStats{};
+		HardwareStats m_HardwareStats{};
+		bool m_HasHistory{ false };
+		Matrix m_PreviousCameraToWorld{};
+		float m_PreviousFov{};
+
+		template<typename Element, typename Function>
+		void ParallelForEach(const std::vector<Element>& elements, const Function& function) const;
+		//The hardware counters of every tile are added to stage
+		template<typename Function>
+		void ForEachPixel(RenderStage stage, const Function& function) const;
+		template<typename Function>
+		void MeasurePixelCost(uint32_t pixelIndex, const Function& function);
+
+		void RenderStreamed(Scene* pScene, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin);
+		void RenderReSTIR(Scene* pScene, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin);
+		void RenderAdaptiveAA(Scene* pScene, float fov, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin);
+		float CalculateTileContrast(uint32_t tileIndex) const;
+		void AccumulateHistory(bool cameraMoved);
+		bool IsSimilarSurface(const HitRecord& current, const HitRecord& previous) const;
+		bool ReprojectToPreviousFrame(const Vector3& position, uint32_t& previousPixelIndex) const;
+		Vector3 CalculateViewRayDirection(float x, float y, float fov, float aspectRatio, const Matrix& cameraToWorld) const;
+		ColorRGB ShadeViewRay(Scene* pScene, const Ray& viewRay, HitRecord& closestHit) const;
+		ColorRGB CalculateLightContribution(Material* pMaterial, const Light& light, const HitRecord& hitRecord, const Vector3& viewDirection) const;
+		void ApplyCostHeatmap();
+		void Present() const;
+
 		float CalculateObservedArea(const Ray& ray, const Vector3& normal) const;
 	};
 }
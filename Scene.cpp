@@ -1,6 +1,19 @@
 #include "Scene.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
 #include "Utils.h"
 #include "Material.h"
+#include "ModelImporter.h"
+#include "Json.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "ClusterCache.h"
+#include "RenderCounters.h"
+#include "Timer.h"
 
 namespace dae {
 
@@ -24,6 +37,14 @@ namespace dae {
 		}
 
 		m_Materials.clear();
+
+		delete m_pClusterCache;
+		m_pClusterCache = nullptr;
+	}
+
+	void Scene::Update(dae::Timer* pTimer)
+	{
+		m_Camera.Update(pTimer->GetElapsed(), m_CameraInput);
 	}
 
 	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
@@ -44,20 +65,30 @@ namespace dae {
 
 	bool Scene::DoesHit(const Ray& ray) const
 	{
+		COUNT_RENDER_STAT(ShadowRays);
 		for (const Plane& plane : m_PlaneGeometries)
 		{
 			if (GeometryUtils::HitTest_Plane(plane, ray))
+			{
+				COUNT_RENDER_STAT(ShadowEarlyExits);
 				return true;
+			}
 		}
 		for (const Sphere& sphere : m_SphereGeometries)
 		{
 			if (GeometryUtils::HitTest_Sphere(sphere, ray))
+			{
+				COUNT_RENDER_STAT(ShadowEarlyExits);
 				return true;
+			}
 		}
 		for (const TriangleMesh& triangleMesh : m_TriangleMeshGeometries)
 		{
 			if (GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray))
+			{
+				COUNT_RENDER_STAT(ShadowEarlyExits);
 				return true;
+			}
 		}
 		return false;
 	}
@@ -95,6 +126,69 @@ namespace dae {
 		return &m_TriangleMeshGeometries.back();
 	}
 
+	std::vector<TriangleMesh*> Scene::AddModel(const std::string& filename, TriangleCullMode cullMode, unsigned char materialIndex)
+	{
+		std::vector<TriangleMesh*> meshes{};
+
+		if (std::filesystem::path{ filename }.extension() != ".glb")
+		{
+			TriangleMesh* pMesh{ AddTriangleMesh(cullMode, materialIndex) };
+			if (!Utils::LoadMesh(filename, *pMesh))
+			{
+				m_TriangleMeshGeometries.pop_back();
+				return meshes;
+			}
+			pMesh->UpdateAABB();
+			pMesh->UpdateTransforms();
+			meshes.push_back(pMesh);
+			return meshes;
+		}
+
+		ImportedModel model{};
+		if (!Utils::ParseGLB(filename, model))
+			return meshes;
+
+		std::vector<unsigned char> materials{};
+		for (const ImportedMaterial& material : model.materials)
+			materials.push_back(AddMaterial(new Material_CookTorrence(material.albedo, material.metalness, material.roughness)));
+
+		const size_t firstMesh{ m_TriangleMeshGeometries.size() };
+		for (size_t meshIndex{}; meshIndex < model.meshes.size(); ++meshIndex)
+		{
+			const int importedMaterial{ model.meshMaterials[meshIndex] };
+
+			TriangleMesh& mesh{ m_TriangleMeshGeometries.emplace_back(std::move(model.meshes[meshIndex])) };
+			mesh.cullMode = cullMode;
+			mesh.materialIndex = importedMaterial >= 0 ? materials[importedMaterial] : materialIndex;
+			Utils::OptimizeMesh(filename + "#" + std::to_string(meshIndex), mesh);
+			mesh.UpdateAABB();
+			mesh.BuildBVH();
+			mesh.UpdateTransforms();
+		}
+
+		//Only take addresses once the vector stopped growing
+		for (size_t meshIndex{ firstMesh }; meshIndex < m_TriangleMeshGeometries.size(); ++meshIndex)
+			meshes.push_back(&m_TriangleMeshGeometries[meshIndex]);
+		return meshes;
+	}
+
+	size_t Scene::GetMeshMemoryUsage() const
+	{
+		size_t bytes{};
+		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
+			bytes += mesh.GetMemoryUsage();
+		return bytes;
+	}
+
+	size_t Scene::GetTriangleCount() const
+	{
+		//Out of core meshes only count the triangles that are resident
+		size_t triangles{};
+		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
+			triangles += std::max(mesh.indices.size(), mesh.compactIndices.size()) / 3;
+		return triangles;
+	}
+
 	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
 	{
 		Light l;
@@ -303,18 +397,15 @@ namespace dae {
 		//OBJ
 		//===
 		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		//Utils::ParseOBJ("Resources/simple_cube.obj",
-		Utils::ParseOBJ("Resources/lowpoly_bunny2.obj",
-			pMesh->positions,
-			pMesh->normals,
-			pMesh->indices);
+		//Utils::LoadMesh("Resources/simple_cube.obj", *pMesh);
+		Utils::LoadMesh("Resources/lowpoly_bunny2.obj", *pMesh);
 
 		pMesh->Scale({ 2.f,2.f,2.f });
 		//pMesh->Translate({ .0f,1.f,0.f });
 
 		pMesh->UpdateAABB();
 
-		//No need to Calculate the normals, these are calculated inside the ParseOBJ function
+		//No need to Calculate the normals, these are calculated inside the LoadMesh function
 		pMesh->UpdateTransforms();
 
 
@@ -333,4 +424,513 @@ namespace dae {
 		//pMesh->RotateY(PI_DIV_2 * pTimer->GetTotal());
 		pMesh->UpdateTransforms();
 	}
+
+#pragma region SCENE STRESS
+	bool StressSceneSettings::Parse(const std::string& description, StressSceneSettings& settings)
+	{
+		std::stringstream parts{ description };
+		std::string part{};
+		if (!std::getline(parts, part, ':') || part != "Stress")
+			return false;
+
+		while (std::getline(parts, part, ':'))
+		{
+			const size_t separator{ part.find('=') };
+			if (separator == std::string::npos)
+				return false;
+
+			const std::string key{ part.substr(0, separator) };
+			const std::string value{ part.substr(separator + 1) };
+			const uint32_t count{ uint32_t(std::max(0, std::atoi(value.c_str()))) };
+			if (key == "spheres")
+				settings.sphereCount = count;
+			else if (key == "meshes")
+				settings.meshInstanceCount = count;
+			else if (key == "segments")
+				settings.meshSegments = std::max(count, 4u);
+			else if (key == "lights")
+				settings.lightCount = count;
+			else if (key == "triangles")
+				settings.soupTriangleCount = count;
+			else if (key == "seed")
+				settings.seed = count;
+			else if (key == "extent")
+				settings.extent = std::max(float(std::atof(value.c_str())), 1.f);
+			else if (key == "distribution" && value == "uniform")
+				settings.distribution = StressDistribution::Uniform;
+			else if (key == "distribution" && value == "clustered")
+				settings.distribution = StressDistribution::Clustered;
+			else if (key == "distribution" && value == "nested")
+				settings.distribution = StressDistribution::Nested;
+			else
+				return false;
+		}
+		return true;
+	}
+
+	Scene_Stress::Scene_Stress(const StressSceneSettings& settings) :
+		m_Settings{ settings }
+	{
+	}
+
+	void Scene_Stress::Initialize()
+	{
+		const float extent{ m_Settings.extent };
+		sceneName = "Stress Scene";
+		m_Camera.origin = { 0.f, 0.f, -2.5f * extent };
+		m_Camera.fovAngle = 60.f;
+
+		//Every object draws from the same stream, so adding lights does not move the geometry
+		uint32_t seed{ PcgHash(m_Settings.seed) };
+		const uint32_t objectCount{ std::max(m_Settings.sphereCount + m_Settings.meshInstanceCount + m_Settings.soupTriangleCount, 1u) };
+		const uint32_t clusterCount{ std::clamp(objectCount / 64, 1u, 32u) };
+		for (uint32_t cluster{}; cluster < clusterCount; ++cluster)
+			m_ClusterCenters.push_back(Vector3{ RandomFloat(seed), RandomFloat(seed), RandomFloat(seed) } * (1.6f * extent) - Vector3{ .8f, .8f, .8f } * extent);
+
+		//A small palette, materials are indexed by an unsigned char
+		std::vector<unsigned char> materials{};
+		materials.push_back(AddMaterial(new Material_Lambert({ .49f, .57f, .57f }, 1.f)));
+		materials.push_back(AddMaterial(new Material_Lambert({ .8f, .3f, .2f }, 1.f)));
+		materials.push_back(AddMaterial(new Material_Lambert({ .3f, .6f, .25f }, 1.f)));
+		materials.push_back(AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .3f)));
+		materials.push_back(AddMaterial(new Material_CookTorrence({ .955f, .638f, .538f }, 1.f, .6f)));
+		materials.push_back(AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, 0.f, .2f)));
+		const auto matLambert_Floor = AddMaterial(new Material_Lambert(colors::White, 1.f));
+
+		AddPlane(Vector3{ 0.f, -1.1f * extent, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_Floor);
+
+		//Sizes shrink with the cube root of the count, so the volume stays about as full at any count
+		m_SphereGeometries.reserve(m_Settings.sphereCount);
+		const float sphereRadius{ .35f * extent / std::cbrt(float(std::max(m_Settings.sphereCount, 1u))) };
+		for (uint32_t sphere{}; sphere < m_Settings.sphereCount; ++sphere)
+		{
+			float sizeFactor{};
+			const Vector3 position{ NextPosition(seed, sizeFactor) };
+			AddSphere(position, sphereRadius * sizeFactor * (.5f + RandomFloat(seed)), materials[std::min(size_t(RandomFloat(seed) * float(materials.size())), materials.size() - 1)]);
+		}
+
+		AddMeshInstances(materials, seed);
+		AddTriangleSoup(materials[0], seed);
+
+		//The total intensity grows with the lit volume and is shared by the lights, more lights only cost more shadow rays
+		const float lightIntensity{ 12.f * extent * extent / float(std::max(m_Settings.lightCount, 1u)) };
+		for (uint32_t light{}; light < m_Settings.lightCount; ++light)
+		{
+			const Vector3 position{ (RandomFloat(seed) * 2.f - 1.f) * extent, (1.2f + RandomFloat(seed) * .5f) * extent, (RandomFloat(seed) * 2.f - 1.5f) * extent };
+			const ColorRGB color{ .7f + .3f * RandomFloat(seed), .7f + .3f * RandomFloat(seed), .7f + .3f * RandomFloat(seed) };
+			AddPointLight(position, lightIntensity, color);
+		}
+	}
+
+	Vector3 Scene_Stress::NextPosition(uint32_t& seed, float& sizeFactor) const
+	{
+		const float extent{ m_Settings.extent };
+		switch (m_Settings.distribution)
+		{
+		case StressDistribution::Clustered:
+		{
+			//Sum of three uniforms, close enough to a normal distribution and the same on every platform
+			const Vector3& center{ m_ClusterCenters[std::min(size_t(RandomFloat(seed) * float(m_ClusterCenters.size())), m_ClusterCenters.size() - 1)] };
+			auto offset = [&seed]() { return RandomFloat(seed) + RandomFloat(seed) + RandomFloat(seed) - 1.5f; };
+			const Vector3 position{ center + Vector3{ offset(), offset(), offset() } * (.15f * extent) };
+			sizeFactor = .5f;
+			return Vector3::Min(Vector3::Max(position, Vector3{ -extent, -extent, -extent }), Vector3{ extent, extent, extent });
+		}
+		case StressDistribution::Nested:
+		{
+			//The shell radius is uniform, so inner shells are far denser than outer ones
+			const float shell{ .05f + .95f * RandomFloat(seed) };
+			const float z{ RandomFloat(seed) * 2.f - 1.f };
+			const float angle{ RandomFloat(seed) * PI_2 };
+			const float ring{ sqrtf(std::max(0.f, 1.f - z * z)) };
+			sizeFactor = 2.f * shell;
+			return Vector3{ ring * cosf(angle), ring * sinf(angle), z } * (shell * extent);
+		}
+		case StressDistribution::Uniform:
+		default:
+			sizeFactor = 1.f;
+			return Vector3{ RandomFloat(seed) * 2.f - 1.f, RandomFloat(seed) * 2.f - 1.f, RandomFloat(seed) * 2.f - 1.f } * extent;
+		}
+	}
+
+	void Scene_Stress::AddMeshInstances(const std::vector<unsigned char>& materials, uint32_t& seed)
+	{
+		if (m_Settings.meshInstanceCount == 0)
+			return;
+
+		//Torus around the Y axis, built and BVH'd once. Every instance is a full copy with its own buffers and BVH,
+		//there is no instancing, so memory and UpdateTransforms grow with meshes * segments^2
+		TriangleMesh torus{};
+		torus.cullMode = TriangleCullMode::BackFaceCulling;
+		const int rings{ int(m_Settings.meshSegments) }, sides{ std::max(int(m_Settings.meshSegments) / 2, 3) };
+		for (int ring{}; ring < rings; ++ring)
+		{
+			const float ringAngle{ PI_2 * float(ring) / float(rings) };
+			for (int side{}; side < sides; ++side)
+			{
+				const float sideAngle{ PI_2 * float(side) / float(sides) };
+				const float distance{ 1.f + .4f * cosf(sideAngle) };
+				torus.positions.push_back({ distance * cosf(ringAngle), .4f * sinf(sideAngle), distance * sinf(ringAngle) });
+			}
+		}
+		for (int ring{}; ring < rings; ++ring)
+		{
+			for (int side{}; side < sides; ++side)
+			{
+				const int v0{ ring * sides + side }, v1{ (ring + 1) % rings * sides + side };
+				const int v2{ ring * sides + (side + 1) % sides }, v3{ (ring + 1) % rings * sides + (side + 1) % sides };
+				//CW Winding Order!
+				torus.indices.insert(torus.indices.end(), { v0, v2, v1, v1, v2, v3 });
+			}
+		}
+		torus.CalculateNormals();
+		torus.UpdateAABB();
+		torus.BuildBVH();
+
+		//AddTriangleMesh hands out pointers into the vector, it must not grow while they are used
+		m_TriangleMeshGeometries.reserve(m_TriangleMeshGeometries.size() + m_Settings.meshInstanceCount + 1);
+		const float meshScale{ .5f * m_Settings.extent / std::cbrt(float(m_Settings.meshInstanceCount)) };
+		for (uint32_t instance{}; instance < m_Settings.meshInstanceCount; ++instance)
+		{
+			float sizeFactor{};
+			const Vector3 position{ NextPosition(seed, sizeFactor) };
+			const float scale{ meshScale * sizeFactor * (.5f + RandomFloat(seed)) };
+
+			TriangleMesh& mesh{ m_TriangleMeshGeometries.emplace_back(torus) };
+			mesh.materialIndex = materials[std::min(size_t(RandomFloat(seed) * float(materials.size())), materials.size() - 1)];
+			mesh.Scale({ scale, scale, scale });
+			mesh.RotateY(RandomFloat(seed) * PI_2);
+			mesh.Translate(position);
+			mesh.UpdateTransforms();
+		}
+	}
+
+	void Scene_Stress::AddTriangleSoup(unsigned char materialIndex, uint32_t& seed)
+	{
+		if (m_Settings.soupTriangleCount == 0)
+			return;
+
+		TriangleMesh* pSoup{ AddTriangleMesh(TriangleCullMode::NoCulling, materialIndex) };
+		pSoup->positions.reserve(size_t(m_Settings.soupTriangleCount) * 3);
+		pSoup->indices.reserve(size_t(m_Settings.soupTriangleCount) * 3);
+
+		//Unconnected triangles with random orientations, about as large as the gaps between them
+		const float triangleSize{ 1.5f * m_Settings.extent / std::cbrt(float(m_Settings.soupTriangleCount)) };
+		for (uint32_t triangle{}; triangle < m_Settings.soupTriangleCount; ++triangle)
+		{
+			float sizeFactor{};
+			const Vector3 center{ NextPosition(seed, sizeFactor) };
+			for (int vertex{}; vertex < 3; ++vertex)
+			{
+				const Vector3 offset{ RandomFloat(seed) - .5f, RandomFloat(seed) - .5f, RandomFloat(seed) - .5f };
+				pSoup->indices.push_back(int(pSoup->positions.size()));
+				pSoup->positions.push_back(center + offset * (triangleSize * sizeFactor));
+			}
+		}
+		pSoup->CalculateNormals();
+		pSoup->UpdateAABB();
+		pSoup->BuildBVH();
+		pSoup->UpdateTransforms();
+	}
+#pragma endregion
+
+#pragma region SCENE FILE
+	static Vector3 ReadVector3(const JsonValue& value, const Vector3& fallback)
+	{
+		if (value.GetSize() != 3)
+			return fallback;
+		return { value[0].AsFloat(), value[1].AsFloat(), value[2].AsFloat() };
+	}
+
+	static ColorRGB ReadColor(const JsonValue& value, const ColorRGB& fallback)
+	{
+		const Vector3 color{ ReadVector3(value, { fallback.r, fallback.g, fallback.b }) };
+		return { color.x, color.y, color.z };
+	}
+
+	static TriangleCullMode ReadCullMode(const JsonValue& value)
+	{
+		if (value.AsString() == "front")
+			return TriangleCullMode::FrontFaceCulling;
+		if (value.AsString() == "none")
+			return TriangleCullMode::NoCulling;
+		return TriangleCullMode::BackFaceCulling;
+	}
+
+	//Scale, rotation in degrees (pitch, yaw, roll) and translation
+	static Matrix ReadTransform(const JsonValue& value)
+	{
+		return Matrix::CreateScale(ReadVector3(value["scale"], { 1.f, 1.f, 1.f }))
+			* Matrix::CreateRotation(ReadVector3(value["rotation"], Vector3::Zero) * TO_RADIANS)
+			* Matrix::CreateTranslation(ReadVector3(value["translation"], Vector3::Zero));
+	}
+
+	static Material* CreateMaterial(const JsonValue& value)
+	{
+		const std::string& type{ value["type"].AsString() };
+		const ColorRGB color{ ReadColor(value["color"], colors::White) };
+		if (type == "solid")
+			return new Material_SolidColor(color);
+		if (type == "phong")
+			return new Material_LambertPhong(color, value["kd"].AsFloat(1.f), value["ks"].AsFloat(.5f), value["exponent"].AsFloat(60.f));
+		if (type == "cooktorrance")
+			return new Material_CookTorrence(color, value["metalness"].AsFloat(0.f), value["roughness"].AsFloat(.5f));
+		return new Material_Lambert(color, value["reflectance"].AsFloat(1.f));
+	}
+
+	//Axis aligned box with outward normals, shown while a mesh is loading
+	static TriangleMesh CreateBoxProxy(const Vector3& minAABB, const Vector3& maxAABB)
+	{
+		TriangleMesh box{};
+		for (int axis{}; axis < 3; ++axis)
+		{
+			const int axisU{ (axis + 1) % 3 };
+			const int axisV{ (axis + 2) % 3 };
+			for (const float side : { -1.f, 1.f })
+			{
+				const int firstIndex{ static_cast<int>(box.positions.size()) };
+				for (int corner{}; corner < 4; ++corner)
+				{
+					Vector3 position{};
+					position[axis] = side < 0.f ? minAABB[axis] : maxAABB[axis];
+					position[axisU] = (corner == 1 || corner == 2) ? maxAABB[axisU] : minAABB[axisU];
+					position[axisV] = corner >= 2 ? maxAABB[axisV] : minAABB[axisV];
+					box.positions.push_back(position);
+				}
+
+				Vector3 normal{};
+				normal[axis] = side;
+				box.indices.insert(box.indices.end(), { firstIndex, firstIndex + 1, firstIndex + 2, firstIndex, firstIndex + 2, firstIndex + 3 });
+				box.normals.insert(box.normals.end(), { normal, normal });
+			}
+		}
+		box.cullMode = TriangleCullMode::NoCulling;
+		return box;
+	}
+
+	//Out of core loading (pClusterCache set) supports OBJ and PLY, glTF models are loaded into memory
+	static ImportedModel LoadModel(const std::string& filename, bool isCompact, ClusterCache* pClusterCache)
+	{
+		ImportedModel model{};
+		const bool isGLB{ std::filesystem::path{ filename }.extension() == ".glb" };
+		if (pClusterCache && !isGLB)
+		{
+			TriangleMesh mesh{};
+			if (pClusterCache->OpenMesh(filename, mesh))
+			{
+				model.meshes.emplace_back(std::move(mesh));
+				model.meshMaterials.push_back(-1);
+			}
+			return model;
+		}
+
+		if (isGLB)
+		{
+			if (Utils::ParseGLB(filename, model))
+			{
+				for (size_t meshIndex{}; meshIndex < model.meshes.size(); ++meshIndex)
+				{
+					TriangleMesh& mesh{ model.meshes[meshIndex] };
+					Utils::OptimizeMesh(filename + "#" + std::to_string(meshIndex), mesh);
+					mesh.UpdateAABB();
+					mesh.BuildBVH();
+				}
+			}
+		}
+		else
+		{
+			TriangleMesh mesh{};
+			if (Utils::LoadMesh(filename, mesh))
+			{
+				model.meshes.emplace_back(std::move(mesh));
+				model.meshMaterials.push_back(-1);
+			}
+		}
+
+		if (isCompact)
+		{
+			for (size_t meshIndex{}; meshIndex < model.meshes.size(); ++meshIndex)
+				Utils::CompactMesh(filename + "#" + std::to_string(meshIndex), model.meshes[meshIndex]);
+		}
+		return model;
+	}
+
+	Scene_File::Scene_File(const std::string& filename) :
+		m_Filename{ filename }
+	{
+	}
+
+	Scene_File::~Scene_File()
+	{
+		//Waits for models that are still loading
+		delete m_pThreadPool;
+		m_pThreadPool = nullptr;
+	}
+
+	void Scene_File::Initialize()
+	{
+		sceneName = m_Filename;
+
+		const MappedFile file{ m_Filename };
+		JsonValue scene{};
+		if (!file.IsOpen() || !JsonValue::Parse(file.GetData(), file.GetData() + file.GetSize(), scene) || scene.GetType() != JsonType::Object)
+		{
+			std::cout << "Failed to load scene " << m_Filename << std::endl;
+			return;
+		}
+
+		//Camera
+		const JsonValue& camera{ scene["camera"] };
+		m_Camera.origin = ReadVector3(camera["origin"], m_Camera.origin);
+		m_Camera.fovAngle = camera["fov"].AsFloat(m_Camera.fovAngle);
+
+		//Materials, referenced by name or by index (0 is the default material)
+		std::vector<std::pair<std::string, unsigned char>> materialNames{};
+		const JsonValue& materials{ scene["materials"] };
+		for (size_t index{}; index < materials.GetSize(); ++index)
+			materialNames.emplace_back(materials[index]["name"].AsString(), AddMaterial(CreateMaterial(materials[index])));
+
+		auto readMaterial = [&](const JsonValue& value) -> unsigned char
+		{
+			if (value.GetType() == JsonType::Number)
+				return static_cast<unsigned char>(std::clamp(value.AsInt(), 0, int(m_Materials.size()) - 1));
+			for (const auto& material : materialNames)
+			{
+				if (material.first == value.AsString())
+					return material.second;
+			}
+			return 0;
+		};
+
+		//Geometry
+		const JsonValue& planes{ scene["planes"] };
+		for (size_t index{}; index < planes.GetSize(); ++index)
+			AddPlane(ReadVector3(planes[index]["origin"], Vector3::Zero), ReadVector3(planes[index]["normal"], Vector3::UnitY).Normalized(), readMaterial(planes[index]["material"]));
+
+		const JsonValue& spheres{ scene["spheres"] };
+		for (size_t index{}; index < spheres.GetSize(); ++index)
+			AddSphere(ReadVector3(spheres[index]["origin"], Vector3::Zero), spheres[index]["radius"].AsFloat(1.f), readMaterial(spheres[index]["material"]));
+
+		//Meshes get a slot right away, filled with a proxy when the bounds are known (scene file or mesh cache)
+		const JsonValue& meshes{ scene["meshes"] };
+		const std::filesystem::path sceneDirectory{ std::filesystem::path{ m_Filename }.parent_path() };
+		m_TriangleMeshGeometries.reserve(m_TriangleMeshGeometries.size() + meshes.GetSize());
+		if (meshes.GetSize() > 0)
+			m_pThreadPool = new ThreadPool();
+
+		for (size_t index{}; index < meshes.GetSize(); ++index)
+		{
+			const JsonValue& mesh{ meshes[index] };
+
+			PendingModel pendingModel{};
+			pendingModel.filename = (sceneDirectory / mesh["file"].AsString()).string();
+			pendingModel.meshIndex = m_TriangleMeshGeometries.size();
+			pendingModel.transform = ReadTransform(mesh);
+			pendingModel.cullMode = ReadCullMode(mesh["cull"]);
+			pendingModel.materialIndex = readMaterial(mesh["material"]);
+			pendingModel.isCompact = mesh["compact"].AsBool(false);
+			pendingModel.isOutOfCore = mesh["outOfCore"].AsBool(false);
+			if (pendingModel.isOutOfCore && !m_pClusterCache)
+				m_pClusterCache = new ClusterCache(size_t(std::max(scene["clusterCacheMB"].AsFloat(256.f), 0.f) * 1024.f * 1024.f));
+
+			Vector3 minAABB{}, maxAABB{};
+			const JsonValue& bounds{ mesh["bounds"] };
+			bool hasBounds{ bounds.GetSize() == 2 };
+			if (hasBounds)
+			{
+				minAABB = ReadVector3(bounds[0], Vector3::Zero);
+				maxAABB = ReadVector3(bounds[1], Vector3::Zero);
+			}
+			else
+			{
+				hasBounds = Utils::PeekMeshBounds(pendingModel.filename, minAABB, maxAABB);
+			}
+
+			TriangleMesh& proxy{ m_TriangleMeshGeometries.emplace_back(hasBounds ? CreateBoxProxy(minAABB, maxAABB) : TriangleMesh{}) };
+			proxy.materialIndex = pendingModel.materialIndex;
+			proxy.SetTransform(pendingModel.transform);
+			proxy.UpdateAABB();
+			proxy.UpdateTransforms();
+
+			const std::string filename{ pendingModel.filename };
+			const bool isCompact{ pendingModel.isCompact };
+			ClusterCache* pClusterCache{ pendingModel.isOutOfCore ? m_pClusterCache : nullptr };
+			pendingModel.model = m_pThreadPool->Enqueue([filename, isCompact, pClusterCache]() { return LoadModel(filename, isCompact, pClusterCache); });
+			m_PendingModels.emplace_back(std::move(pendingModel));
+		}
+
+		//Lights
+		const JsonValue& lights{ scene["lights"] };
+		for (size_t index{}; index < lights.GetSize(); ++index)
+		{
+			const JsonValue& light{ lights[index] };
+			const float intensity{ light["intensity"].AsFloat(1.f) };
+			const ColorRGB color{ ReadColor(light["color"], colors::White) };
+			if (light["type"].AsString() == "directional")
+				AddDirectionalLight(ReadVector3(light["direction"], -Vector3::UnitY).Normalized(), intensity, color);
+			else
+				AddPointLight(ReadVector3(light["origin"], Vector3::Zero), intensity, color);
+		}
+	}
+
+	void Scene_File::Update(Timer* pTimer)
+	{
+		Scene::Update(pTimer);
+		SwapInFinishedModels();
+	}
+
+	void Scene_File::FinishLoading()
+	{
+		for (PendingModel& pendingModel : m_PendingModels)
+			pendingModel.model.wait();
+		SwapInFinishedModels();
+	}
+
+	void Scene_File::SwapInFinishedModels()
+	{
+		//Finished models replace their proxies between frames, never while rendering
+		for (auto pendingModel{ m_PendingModels.begin() }; pendingModel != m_PendingModels.end();)
+		{
+			if (pendingModel->model.wait_for(std::chrono::seconds::zero()) != std::future_status::ready)
+			{
+				++pendingModel;
+				continue;
+			}
+			SwapInModel(*pendingModel);
+			pendingModel = m_PendingModels.erase(pendingModel);
+
+			if (m_PendingModels.empty())
+				std::cout << "All meshes loaded, " << GetMeshMemoryUsage() / (1024.f * 1024.f) << " MB of mesh data" << std::endl;
+		}
+	}
+
+	void Scene_File::SwapInModel(PendingModel& pendingModel)
+	{
+		ImportedModel model{ pendingModel.model.get() };
+		if (model.meshes.empty())
+			std::cout << "Failed to load mesh " << pendingModel.filename << std::endl;
+
+		std::vector<unsigned char> materials{};
+		for (const ImportedMaterial& material : model.materials)
+			materials.push_back(AddMaterial(new Material_CookTorrence(material.albedo, material.metalness, material.roughness)));
+
+		//The proxy slot keeps its index (other pending models refer to theirs), extra meshes are appended
+		m_TriangleMeshGeometries[pendingModel.meshIndex] = {};
+		for (size_t meshIndex{}; meshIndex < model.meshes.size(); ++meshIndex)
+		{
+			TriangleMesh& mesh{ model.meshes[meshIndex] };
+			const int importedMaterial{ model.meshMaterials[meshIndex] };
+			mesh.cullMode = pendingModel.cullMode;
+			mesh.materialIndex = importedMaterial >= 0 ? materials[importedMaterial] : pendingModel.materialIndex;
+			mesh.SetTransform(mesh.GetTransform() * pendingModel.transform);
+			mesh.UpdateTransforms();
+
+			if (meshIndex == 0)
+				m_TriangleMeshGeometries[pendingModel.meshIndex] = std::move(mesh);
+			else
+				m_TriangleMeshGeometries.emplace_back(std::move(mesh));
+		}
+		++m_GeometryVersion;
+	}
+#pragma endregion
 }
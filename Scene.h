@@ -1,16 +1,20 @@
 #pragma once
+#include <future>
 #include <string>
 #include <vector>
 
 #include "Math.h"
 #include "DataTypes.h"
 #include "Camera.h"
+#include "ModelImporter.h"
 
 namespace dae
 {
 	//Forward Declarations
 	class Timer;
 	class Material;
+	class ThreadPool;
+	class ClusterCache;
 	struct Plane;
 	struct Sphere;
 	struct Light;
@@ -28,12 +32,13 @@ namespace dae
 		Scene& operator=(Scene&&) noexcept = delete;
 
 		virtual void Initialize() = 0;
-		virtual void Update(dae::Timer* pTimer)
-		{
-			m_Camera.Update(pTimer);
-		}
+		virtual void Update(dae::Timer* pTimer);
+		//Blocks until everything the scene streams in is part of it
+		virtual void FinishLoading() {}
 
 		Camera& GetCamera() { return m_Camera; }
+		//Applied to the camera on the next Update, a scene without input keeps its camera still
+		void SetCameraInput(const CameraInput& input) { m_CameraInput = input; }
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
 		bool DoesHit(const Ray& ray) const;
 
@@ -41,9 +46,19 @@ namespace dae
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
 		const std::vector<Light>& GetLights() const { return m_Lights; }
 		const std::vector<Material*> GetMaterials() const { return m_Materials; }
+		//Bytes held by all triangle meshes
+		size_t GetMeshMemoryUsage() const;
+		size_t GetTriangleMeshCount() const { return m_TriangleMeshGeometries.size(); }
+		size_t GetTriangleCount() const;
+		//Changes whenever geometry is swapped in, so accumulated history can be discarded
+		uint32_t GetGeometryVersion() const { return m_GeometryVersion; }
+		//Set once an out of core mesh was added, shared by all of them
+		ClusterCache* GetClusterCache() const { return m_pClusterCache; }
 
 	protected:
 		std::string	sceneName;
+		uint32_t m_GeometryVersion{};
+		ClusterCache* m_pClusterCache{ nullptr };
 
 		std::vector<Plane> m_PlaneGeometries{};
 		std::vector<Sphere> m_SphereGeometries{};
@@ -52,10 +67,13 @@ namespace dae
 		std::vector<Material*> m_Materials{};
 
 		Camera m_Camera{};
+		CameraInput m_CameraInput{};
 
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
 		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		//Loads .obj, .ply or .glb, glTF materials become Cook-Torrance materials, everything else uses materialIndex
+		std::vector<TriangleMesh*> AddModel(const std::string& filename, TriangleCullMode cullMode, unsigned char materialIndex = 0);
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
@@ -147,6 +165,101 @@ namespace dae
 	private:
 		TriangleMesh* pMesh{ nullptr };
 	};
-}
 
+	//+++++++++++++++++++++++++++++++++++++++++
+	//Procedural Stress Scene
+	enum class StressDistribution
+	{
+		//Evenly spread over the whole volume
+		Uniform,
+		//Dense groups around a few random centers, most of the volume stays empty
+		Clustered,
+		//Concentric shells, objects grow towards the outside so large bounds enclose smaller ones
+		Nested
+	};
+
+	struct StressSceneSettings
+	{
+		uint32_t sphereCount{ 256 };
+		//Full copies of one tessellated torus, each with its own transform, buffers and BVH (nothing is shared)
+		uint32_t meshInstanceCount{ 16 };
+		//The torus has meshSegments rings of meshSegments / 2 quads
+		uint32_t meshSegments{ 24 };
+		uint32_t lightCount{ 4 };
+		//Independent small triangles in a single mesh, 0 for none
+		uint32_t soupTriangleCount{ 0 };
+		StressDistribution distribution{ StressDistribution::Uniform };
+		uint32_t seed{ 1337 };
+		//Half the size of the cube everything is placed in, the camera backs off to keep it in view
+		float extent{ 10.f };
+
+		/**
+		 * \brief Reads "Stress:key=value:key=value...", keys left out keep their default
+		 * Keys: spheres, meshes, segments, lights, triangles, distribution (uniform|clustered|nested), seed, extent
+		 * \return false when description is not a stress scene or holds an unknown key
+		 */
+		static bool Parse(const std::string& description, StressSceneSettings& settings);
+	};
+
+	//Generated from a seed, the same settings always give the same scene. Meant for scaling studies, see StressSceneSettings
+	class Scene_Stress final : public Scene
+	{
+	public:
+		explicit Scene_Stress(const StressSceneSettings& settings);
+		~Scene_Stress() override = default;
+
+		Scene_Stress(const Scene_Stress&) = delete;
+		Scene_Stress(Scene_Stress&&) noexcept = delete;
+		Scene_Stress& operator=(const Scene_Stress&) = delete;
+		Scene_Stress& operator=(Scene_Stress&&) noexcept = delete;
+
+		void Initialize() override;
+	private:
+		StressSceneSettings m_Settings{};
+		//Cluster centers of the clustered distribution
+		std::vector<Vector3> m_ClusterCenters{};
 
+		//Position and size factor (1 is the average size) of the next object
+		Vector3 NextPosition(uint32_t& seed, float& sizeFactor) const;
+		void AddMeshInstances(const std::vector<unsigned char>& materials, uint32_t& seed);
+		void AddTriangleSoup(unsigned char materialIndex, uint32_t& seed);
+	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//Scene described by a JSON scene file, referenced meshes load on worker threads
+	class Scene_File final : public Scene
+	{
+	public:
+		explicit Scene_File(const std::string& filename);
+		~Scene_File() override;
+
+		Scene_File(const Scene_File&) = delete;
+		Scene_File(Scene_File&&) noexcept = delete;
+		Scene_File& operator=(const Scene_File&) = delete;
+		Scene_File& operator=(Scene_File&&) noexcept = delete;
+
+		void Initialize() override;
+		void Update(Timer* pTimer) override;
+		void FinishLoading() override;
+	private:
+		//Mesh slot showing a bounding box proxy (or nothing) until its model finished loading
+		struct PendingModel
+		{
+			std::string filename{};
+			size_t meshIndex{};
+			Matrix transform{};
+			TriangleCullMode cullMode{};
+			unsigned char materialIndex{};
+			bool isCompact{};
+			bool isOutOfCore{};
+			std::future<ImportedModel> model{};
+		};
+
+		std::string m_Filename{};
+		ThreadPool* m_pThreadPool{ nullptr };
+		std::vector<PendingModel> m_PendingModels{};
+
+		void SwapInFinishedModels();
+		void SwapInModel(PendingModel& pendingModel);
+	};
+}
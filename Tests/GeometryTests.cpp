@@ -0,0 +1,68 @@
+//Standard includes
+#include <iostream>
+
+//Project includes
+#include "MathHelpers.h"
+#include "Utils.h"
+
+using namespace dae;
+
+//Plain checks without a framework, the exit code tells ctest whether every check passed
+namespace
+{
+	int g_FailureCount{};
+
+	void Check(bool condition, const char* description)
+	{
+		if (condition)
+			return;
+		std::cout << "FAIL " << description << std::endl;
+		++g_FailureCount;
+	}
+
+	void TestAreEqual()
+	{
+		Check(AreEqual(1.f, 1.f), "AreEqual of equal floats");
+		Check(!AreEqual(.5f, 0.f), "AreEqual of floats less than 1 apart");
+		Check(!AreEqual(1e-3f, 0.f), "AreEqual of a small difference");
+		Check(AreEqual(1e-3f, 0.f, 1e-2f), "AreEqual within a custom epsilon");
+	}
+
+	void TestTriangleHits()
+	{
+		Triangle triangle{ { -1.f, -1.f, 0.f }, { 0.f, 1.f, 0.f }, { 1.f, -1.f, 0.f } };
+		triangle.cullMode = TriangleCullMode::NoCulling;
+
+		//Head on and at a grazing angle, |dot| well below 1 has to hit as well
+		const Vector3 directions[]{ { 0.f, 0.f, 1.f }, Vector3{ .8f, 0.f, .6f }.Normalized(), Vector3{ 0.f, -.9f, .2f }.Normalized() };
+		for (const Vector3& direction : directions)
+		{
+			const Ray ray{ -direction * 2.f, direction };
+			HitRecord hitRecord{};
+			Check(GeometryUtils::HitTest_Triangle(triangle, ray, hitRecord) && hitRecord.didHit, "triangle hit through its centre");
+			Check(AreEqual(hitRecord.t, 2.f, 1e-4f), "distance to the triangle");
+		}
+
+		HitRecord missRecord{};
+		const Ray missRay{ { 5.f, 5.f, -1.f }, { 0.f, 0.f, 1.f } };
+		Check(!GeometryUtils::HitTest_Triangle(triangle, missRay, missRecord), "ray beside the triangle misses");
+
+		HitRecord parallelRecord{};
+		const Ray parallelRay{ { -2.f, 0.f, 0.f }, { 1.f, 0.f, 0.f } };
+		Check(!GeometryUtils::HitTest_Triangle(triangle, parallelRay, parallelRecord), "ray in the plane of the triangle misses");
+	}
+}
+
+int main()
+{
+	TestAreEqual();
+	TestTriangleHits();
+
+	if (g_FailureCount > 0)
+	{
+		std::cout << g_FailureCount << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All geometry checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,106 @@
+//Standard includes
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "Utils.h"
+
+using namespace dae;
+
+//Plain checks without a framework, the exit code tells ctest whether every check passed
+namespace
+{
+	int g_FailureCount{};
+
+	//Matches OBJ_MIN_CHUNK_SIZE in Utils.cpp, files smaller than this are parsed as a single chunk
+	constexpr size_t CHUNK_SIZE{ 1 << 20 };
+
+	void Check(bool condition, const char* description)
+	{
+		if (condition)
+			return;
+		std::cout << "FAIL " << description << std::endl;
+		++g_FailureCount;
+	}
+
+	std::string GetTemporaryPath(const char* filename)
+	{
+		return (std::filesystem::temp_directory_path() / filename).string();
+	}
+
+	void WriteFile(const std::string& filename, const std::string& contents)
+	{
+		std::ofstream file{ filename, std::ios::binary | std::ios::trunc };
+		file << contents;
+	}
+
+	//Four corners of a unit quad at height y and its normal
+	std::string WriteQuadVertices(float y)
+	{
+		const std::string height{ std::to_string(y) };
+		return "v 0 " + height + " 0\nv 0 " + height + " 1\nv 1 " + height + " 1\nv 1 " + height + " 0\nvn 0 1 0\n";
+	}
+
+	void TestRelativeIndicesAcrossChunks()
+	{
+		//The first quad is defined in the first chunk, a comment pads that chunk until its last line ends on the boundary
+		std::string contents{ WriteQuadVertices(0.f) };
+		const size_t paddingSize{ CHUNK_SIZE + 1 - contents.size() - 3 };
+		contents += "# " + std::string(paddingSize, 'x') + "\n";
+		Check(contents.size() == CHUNK_SIZE + 1, "padding ends the first chunk on a line");
+
+		//The first face of the second chunk refers back to the first quad, the second quad stays within its chunk
+		contents += "f -4//-1 -3//-1 -2//-1 -1//-1\n";
+		contents += WriteQuadVertices(1.f);
+		contents += "f -4//-1 -3//-1 -2//-1 -1//-1\n";
+
+		const std::string filename{ GetTemporaryPath("RayTracerObjParserTests.obj") };
+		WriteFile(filename, contents);
+
+		std::vector<Vector3> positions{}, normals{}, cornerNormals{};
+		std::vector<int> indices{};
+		Check(Utils::ParseOBJ(filename, positions, normals, indices, &cornerNormals), "OBJ with relative indices across chunks loads");
+		std::filesystem::remove(filename);
+
+		Check(positions.size() == 8, "vertex count of two quads");
+		Check(normals.size() == 4 && indices.size() == 12, "triangle count of two fan triangulated quads");
+		Check(cornerNormals.size() == indices.size(), "one corner normal per index");
+		if (indices.size() != 12)
+			return;
+
+		const int expectedIndices[12]{ 0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7 };
+		bool areIndicesResolved{ true };
+		for (size_t index{}; index < indices.size(); ++index)
+			areIndicesResolved = areIndicesResolved && indices[index] == expectedIndices[index];
+		Check(areIndicesResolved, "relative indices resolve to the quad defined before each face");
+		Check(positions[indices[0]].y == 0.f && positions[indices[6]].y == 1.f, "faces use the positions of their own quad");
+	}
+
+	void TestRelativeIndexBeforeFirstVertex()
+	{
+		const std::string filename{ GetTemporaryPath("RayTracerObjParserTestsInvalid.obj") };
+		WriteFile(filename, WriteQuadVertices(0.f) + "f -5 -2 -1\n");
+
+		std::vector<Vector3> positions{}, normals{};
+		std::vector<int> indices{};
+		Check(!Utils::ParseOBJ(filename, positions, normals, indices), "relative index before the first vertex is rejected");
+		std::filesystem::remove(filename);
+	}
+}
+
+int main()
+{
+	TestRelativeIndicesAcrossChunks();
+	TestRelativeIndexBeforeFirstVertex();
+
+	if (g_FailureCount > 0)
+	{
+		std::cout << g_FailureCount << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All OBJ parser checks passed" << std::endl;
+	return 0;
+}
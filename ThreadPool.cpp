@@ -0,0 +1,65 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+using namespace dae;
+
+namespace
+{
+	//Set by WorkerLoop, a thread only ever belongs to one pool
+	thread_local const ThreadPool* t_pPool{ nullptr };
+	thread_local uint32_t t_ThreadIndex{};
+}
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	threadCount = std::max(threadCount, 1u);
+	m_Threads.reserve(threadCount);
+	for (uint32_t index{}; index < threadCount; ++index)
+		m_Threads.emplace_back(&ThreadPool::WorkerLoop, this, index);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_TaskAvailable.notify_all();
+
+	//Queued tasks still run, so no future is left without a result
+	for (std::thread& thread : m_Threads)
+		thread.join();
+}
+
+void ThreadPool::WorkerLoop(uint32_t threadIndex)
+{
+	t_pPool = this;
+	t_ThreadIndex = threadIndex;
+	while (true)
+	{
+		std::function<void()> task{};
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_TaskAvailable.wait(lock, [this]() { return m_IsStopping || !m_Tasks.empty(); });
+			if (m_Tasks.empty())
+				return;
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop();
+		}
+		task();
+	}
+}
+
+uint32_t ThreadPool::GetThreadSlot() const
+{
+	return t_pPool == this ? t_ThreadIndex + 1 : 0;
+}
+
+ParallelStats ThreadPool::CollectParallelStats()
+{
+	ParallelStats stats{ m_ParallelStats };
+	m_ParallelStats = {};
+	return stats;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//Nanoseconds spent in ThreadPool::ParallelFor
+	struct ParallelStats
+	{
+		int64_t wallTime{};
+		//Time a thread waited for the others or for work, index 0 is the calling thread, pool thread i is at i + 1
+		std::vector<int64_t> idleTimes{};
+	};
+
+	//Fixed set of worker threads executing queued tasks in FIFO order
+	class ThreadPool final
+	{
+	public:
+		explicit ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		/**
+		 * \brief Queues a task
+		 * \param function callable without parameters
+		 * \return future receiving the result of the task
+		 */
+		template<typename Function>
+		auto Enqueue(Function&& function) -> std::future<decltype(function())>;
+
+		/**
+		 * \brief Calls function(index) for every index below count on the calling thread and every pool thread, returns once all are done
+		 * Indices are handed out one at a time, so uneven work balances itself. Only one thread may call it at a time,
+		 * tasks that were queued before it run first
+		 */
+		template<typename Function>
+		void ParallelFor(uint32_t count, const Function& function);
+
+		//Time spent in ParallelFor since the previous call
+		ParallelStats CollectParallelStats();
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Threads.size()); };
+
+	private:
+		std::vector<std::thread> m_Threads{};
+		std::queue<std::function<void()>> m_Tasks{};
+		std::mutex m_Mutex{};
+		std::condition_variable m_TaskAvailable{};
+		bool m_IsStopping{ false };
+		ParallelStats m_ParallelStats{};
+
+		void WorkerLoop(uint32_t threadIndex);
+		//0 for threads outside the pool, pool thread i is slot i + 1
+		uint32_t GetThreadSlot() const;
+	};
+
+	template<typename Function>
+	auto ThreadPool::Enqueue(Function&& function) -> std::future<decltype(function())>
+	{
+		//std::function needs a copyable target, packaged_task is move-only
+		const auto pTask{ std::make_shared<std::packaged_task<decltype(function())()>>(std::forward<Function>(function)) };
+		auto future{ pTask->get_future() };
+		{
+			const std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_Tasks.emplace([pTask]() { (*pTask)(); });
+		}
+		m_TaskAvailable.notify_one();
+		return future;
+	}
+
+	template<typename Function>
+	void ThreadPool::ParallelFor(uint32_t count, const Function& function)
+	{
+		using Clock = std::chrono::steady_clock;
+		const uint32_t participantCount{ std::min(GetThreadCount() + 1, std::max(count, 1u)) };
+		std::atomic<uint32_t> nextIndex{};
+		//Per thread slot rather than per participant, any pool thread can pick up any participant task
+		std::vector<Clock::duration> busyTimes(GetThreadCount() + 1);
+
+		//A thread is busy from picking up the loop until it finds no index left
+		auto participate = [&]()
+		{
+			const Clock::time_point start{ Clock::now() };
+			for (uint32_t index{ nextIndex.fetch_add(1, std::memory_order_relaxed) }; index < count; index = nextIndex.fetch_add(1, std::memory_order_relaxed))
+				function(index);
+			busyTimes[GetThreadSlot()] += Clock::now() - start;
+		};
+
+		const Clock::time_point start{ Clock::now() };
+		std::vector<std::future<void>> participants{};
+		participants.reserve(participantCount - 1);
+		for (uint32_t participant{ 1 }; participant < participantCount; ++participant)
+			participants.push_back(Enqueue([&participate]() { participate(); }));
+		participate();
+		for (std::future<void>& participant : participants)
+			participant.get();
+
+		//Threads that got no index at all were idle for the whole loop
+		const Clock::duration wallTime{ Clock::now() - start };
+		m_ParallelStats.wallTime += std::chrono::duration_cast<std::chrono::nanoseconds>(wallTime).count();
+		m_ParallelStats.idleTimes.resize(busyTimes.size());
+		for (size_t thread{}; thread < busyTimes.size(); ++thread)
+		{
+			const Clock::duration idleTime{ std::max(wallTime - busyTimes[thread], Clock::duration::zero()) };
+			m_ParallelStats.idleTimes[thread] += std::chrono::duration_cast<std::chrono::nanoseconds>(idleTime).count();
+		}
+	}
+}
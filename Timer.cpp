@@ -1,23 +1,33 @@
 #include "Timer.h"
 
-#include <iostream>
-#include <numeric>
+#include <chrono>
 
-#include <iostream>
-#include <fstream>
-
-#include "SDL.h"
 using namespace dae;
 
+namespace
+{
+	uint64_t GetPerformanceCounter()
+	{
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	}
+}
+
 Timer::Timer()
 {
-	const uint64_t countsPerSecond = SDL_GetPerformanceFrequency();
+	const uint64_t countsPerSecond = std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
 	m_SecondsPerCount = 1.0f / static_cast<float>(countsPerSecond);
 }
 
+void Timer::SetFixedTimeStep(float timeStep, float startTime)
+{
+	m_FixedTimeStep = timeStep;
+	m_TotalTime = startTime;
+	m_ElapsedTime = 0.0f;
+}
+
 void Timer::Reset()
 {
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	const uint64_t currentTime = GetPerformanceCounter();
 
 	m_BaseTime = currentTime;
 	m_PreviousTime = currentTime;
@@ -29,7 +39,7 @@ void Timer::Reset()
 
 void Timer::Start()
 {
-	const uint64_t startTime = SDL_GetPerformanceCounter();
+	const uint64_t startTime = GetPerformanceCounter();
 
 	if (m_IsStopped)
 	{
@@ -41,29 +51,6 @@ void Timer::Start()
 	}
 }
 
-void Timer::StartBenchmark(int numFrames)
-{
-	if (m_BenchmarkActive)
-	{
-		std::cout << "(Benchmark already running)";
-		return;
-	}
-
-	m_BenchmarkActive = true;
-
-	m_BenchmarkAvg = 0.f;
-	m_BenchmarkHigh = FLT_MIN;
-	m_BenchmarkLow = FLT_MAX;
-
-	m_BenchmarkFrames = numFrames;
-	m_BenchmarkCurrFrame = 0;
-
-	m_Benchmarks.clear();
-	m_Benchmarks.resize(m_BenchmarkFrames);
-
-	std::cout << "**BENCHMARK STARTED**\n";
-}
-
 void Timer::Update()
 {
 	if (m_IsStopped)
@@ -74,7 +61,15 @@ void Timer::Update()
 		return;
 	}
 
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	//Simulated time, the wall clock is ignored so every run animates the same
+	if (m_FixedTimeStep > 0.0f)
+	{
+		m_ElapsedTime = m_FixedTimeStep;
+		m_TotalTime += m_FixedTimeStep;
+		return;
+	}
+
+	const uint64_t currentTime = GetPerformanceCounter();
 	m_CurrentTime = currentTime;
 
 	m_ElapsedTime = (float)((m_CurrentTime - m_PreviousTime) * m_SecondsPerCount);
@@ -99,35 +94,6 @@ void Timer::Update()
 		m_FPS = m_FPSCount;
 		m_FPSCount = 0;
 		m_FPSTimer = 0.0f;
-
-		if (m_BenchmarkActive)
-		{
-			m_Benchmarks[m_BenchmarkCurrFrame] = m_dFPS;
-
-			m_BenchmarkLow = std::min(m_BenchmarkLow, m_dFPS);
-			m_BenchmarkHigh = std::max(m_BenchmarkHigh, m_dFPS);
-
-			++m_BenchmarkCurrFrame;
-			if (m_BenchmarkCurrFrame >= m_BenchmarkFrames)
-			{
-				m_BenchmarkActive = false;
-				m_BenchmarkAvg = std::accumulate(m_Benchmarks.begin(), m_Benchmarks.end(), 0.f) / float(m_BenchmarkFrames);
-
-				//print
-				std::cout << "**BENCHMARK FINISHED**\n";
-				std::cout << ">> HIGH = " << m_BenchmarkHigh << std::endl;
-				std::cout << ">> LOW = " << m_BenchmarkLow << std::endl;
-				std::cout << ">> AVG = " << m_BenchmarkAvg << std::endl;
-
-				//file save
-				std::ofstream fileStream("benchmark.txt");
-				fileStream << "FRAMES = " << m_BenchmarkCurrFrame << std::endl;
-				fileStream << "HIGH = " << m_BenchmarkHigh << std::endl;
-				fileStream << "LOW = " << m_BenchmarkLow << std::endl;
-				fileStream << "AVG = " << m_BenchmarkAvg << std::endl;
-				fileStream.close();
-			}
-		}
 	}
 }
 
@@ -135,7 +101,7 @@ void Timer::Stop()
 {
 	if (!m_IsStopped)
 	{
-		const uint64_t currentTime = SDL_GetPerformanceCounter();
+		const uint64_t currentTime = GetPerformanceCounter();
 
 		m_StopTime = currentTime;
 		m_IsStopped = true;
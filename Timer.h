@@ -2,7 +2,6 @@
 
 //Standard includes
 #include <cstdint>
-#include <vector>
 
 namespace dae
 {
@@ -17,7 +16,10 @@ namespace dae
 		Timer& operator=(const Timer&) = delete;
 		Timer& operator=(Timer&&) noexcept = delete;
 
-		void StartBenchmark(int numFrames = 10);
+		//Every Update advances the time by timeStep instead of the wall clock, 0 switches back to the wall clock
+		void SetFixedTimeStep(float timeStep, float startTime = 0.0f);
+		//Overrides the times of the current frame until the next Update, replays use it to repeat recorded frames exactly
+		void SetFrameTime(float elapsedTime, float totalTime) { m_ElapsedTime = elapsedTime; m_TotalTime = totalTime; };
 
 		void Reset();
 		void Start();
@@ -46,16 +48,9 @@ namespace dae
 		float m_SecondsPerCount = 0.0f;
 		float m_ElapsedUpperBound = 0.03f;
 		float m_FPSTimer = 0.0f;
+		float m_FixedTimeStep = 0.0f;
 
 		bool m_IsStopped = true;
 		bool m_ForceElapsedUpperBound = false;
-
-		bool m_BenchmarkActive = false;
-		float m_BenchmarkHigh{ 0.f };
-		float m_BenchmarkLow{ 0.f };
-		float m_BenchmarkAvg{ 0.f };
-		int m_BenchmarkFrames{ 0 };
-		int m_BenchmarkCurrFrame{ 0 };
-		std::vector<float> m_Benchmarks{};
 	};
 }
@@ -0,0 +1,159 @@
+#include "ToneMapper.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TONEMAPPER_SSE
+#endif
+
+using namespace dae;
+
+ToneMapper::ToneMapper()
+{
+	for (uint32_t index{}; index < m_SRGBTableSize; ++index)
+	{
+		const float linear{ float(index) / (m_SRGBTableSize - 1) };
+		const float encoded{ linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.f / 2.4f) - 0.055f };
+		m_SRGBTable[index] = static_cast<uint8_t>(std::clamp(encoded, 0.f, 1.f) * 255.f + 0.5f);
+	}
+}
+
+void ToneMapper::CycleOperator()
+{
+	m_Operator = static_cast<ToneMappingOperator>((int(m_Operator) + 1) % 3);
+}
+
+ColorRGB ToneMapper::ToneMap(ColorRGB color) const
+{
+	color *= exp2f(m_ExposureStops);
+
+	switch (m_Operator)
+	{
+	case ToneMappingOperator::MaxToOne:
+		color.MaxToOne();
+		break;
+	case ToneMappingOperator::Reinhard:
+		color = { color.r / (1.f + color.r), color.g / (1.f + color.g), color.b / (1.f + color.b) };
+		break;
+	case ToneMappingOperator::ACES:
+	{
+		//Narkowicz fit of the ACES filmic curve
+		auto aces = [](float x) { return (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f); };
+		color = { aces(color.r), aces(color.g), aces(color.b) };
+		break;
+	}
+	}
+
+	//NaN goes to 0 like _mm_max_ps does in the SSE path, Pack indexes the sRGB table with the result
+	auto saturate = [](float value) { return value >= 0.f ? std::min(value, 1.f) : 0.f; };
+	return { saturate(color.r), saturate(color.g), saturate(color.b) };
+}
+
+uint32_t ToneMapper::Pack(const ColorRGB& color, const PixelFormat& format) const
+{
+	uint32_t r{}, g{}, b{};
+	if (m_SRGBEnabled)
+	{
+		r = m_SRGBTable[uint32_t(color.r * (m_SRGBTableSize - 1) + 0.5f)];
+		g = m_SRGBTable[uint32_t(color.g * (m_SRGBTableSize - 1) + 0.5f)];
+		b = m_SRGBTable[uint32_t(color.b * (m_SRGBTableSize - 1) + 0.5f)];
+	}
+	else
+	{
+		r = static_cast<uint8_t>(color.r * 255);
+		g = static_cast<uint8_t>(color.g * 255);
+		b = static_cast<uint8_t>(color.b * 255);
+	}
+	return (r << format.redShift) | (g << format.greenShift) | (b << format.blueShift) | format.alphaMask;
+}
+
+void ToneMapper::Apply(const ColorRGB* pSource, uint32_t* pDestination, uint32_t count, const PixelFormat& format) const
+{
+	uint32_t index{};
+
+#if defined(TONEMAPPER_SSE)
+	//Four pixels per iteration: deinterleave rgb into one register per channel
+	const __m128 exposure{ _mm_set1_ps(exp2f(m_ExposureStops)) };
+	const __m128 zero{ _mm_setzero_ps() };
+	const __m128 one{ _mm_set1_ps(1.f) };
+	const __m128 scale{ _mm_set1_ps(m_SRGBEnabled ? float(m_SRGBTableSize - 1) : 255.f) };
+	const __m128 rounding{ _mm_set1_ps(m_SRGBEnabled ? 0.5f : 0.f) };
+	const __m128i redShift{ _mm_cvtsi32_si128(int(format.redShift)) };
+	const __m128i greenShift{ _mm_cvtsi32_si128(int(format.greenShift)) };
+	const __m128i blueShift{ _mm_cvtsi32_si128(int(format.blueShift)) };
+	const __m128i alphaMask{ _mm_set1_epi32(int(format.alphaMask)) };
+
+	const float* pFloats{ reinterpret_cast<const float*>(pSource) };
+	for (; index + 4 <= count; index += 4)
+	{
+		const __m128 a{ _mm_loadu_ps(pFloats + index * 3) };
+		const __m128 b{ _mm_loadu_ps(pFloats + index * 3 + 4) };
+		const __m128 c{ _mm_loadu_ps(pFloats + index * 3 + 8) };
+
+		__m128 red{ _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 2, 3, 0)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 1, 0)) };
+		__m128 green{ _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)) };
+		__m128 blue{ _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)) };
+
+		red = _mm_mul_ps(red, exposure);
+		green = _mm_mul_ps(green, exposure);
+		blue = _mm_mul_ps(blue, exposure);
+
+		switch (m_Operator)
+		{
+		case ToneMappingOperator::MaxToOne:
+		{
+			const __m128 divisor{ _mm_max_ps(_mm_max_ps(red, _mm_max_ps(green, blue)), one) };
+			red = _mm_div_ps(red, divisor);
+			green = _mm_div_ps(green, divisor);
+			blue = _mm_div_ps(blue, divisor);
+			break;
+		}
+		case ToneMappingOperator::Reinhard:
+			red = _mm_div_ps(red, _mm_add_ps(one, red));
+			green = _mm_div_ps(green, _mm_add_ps(one, green));
+			blue = _mm_div_ps(blue, _mm_add_ps(one, blue));
+			break;
+		case ToneMappingOperator::ACES:
+		{
+			auto aces = [](__m128 x)
+			{
+				const __m128 numerator{ _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.51f), x), _mm_set1_ps(0.03f))) };
+				const __m128 denominator{ _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.43f), x), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f)) };
+				return _mm_div_ps(numerator, denominator);
+			};
+			red = aces(red);
+			green = aces(green);
+			blue = aces(blue);
+			break;
+		}
+		}
+
+		__m128i redBits{ _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(red, zero), one), scale), rounding)) };
+		__m128i greenBits{ _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(green, zero), one), scale), rounding)) };
+		__m128i blueBits{ _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(blue, zero), one), scale), rounding)) };
+
+		if (m_SRGBEnabled)
+		{
+			alignas(16) int32_t lookup[3][4]{};
+			_mm_store_si128(reinterpret_cast<__m128i*>(lookup[0]), redBits);
+			_mm_store_si128(reinterpret_cast<__m128i*>(lookup[1]), greenBits);
+			_mm_store_si128(reinterpret_cast<__m128i*>(lookup[2]), blueBits);
+			for (auto& channel : lookup)
+				for (int32_t& value : channel)
+					value = m_SRGBTable[value];
+			redBits = _mm_load_si128(reinterpret_cast<const __m128i*>(lookup[0]));
+			greenBits = _mm_load_si128(reinterpret_cast<const __m128i*>(lookup[1]));
+			blueBits = _mm_load_si128(reinterpret_cast<const __m128i*>(lookup[2]));
+		}
+
+		const __m128i packed{ _mm_or_si128(_mm_or_si128(_mm_sll_epi32(redBits, redShift), _mm_sll_epi32(greenBits, greenShift)),
+			_mm_or_si128(_mm_sll_epi32(blueBits, blueShift), alphaMask)) };
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + index), packed);
+	}
+#endif
+
+	for (; index < count; ++index)
+		pDestination[index] = Pack(ToneMap(pSource[index]), format);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+
+#include "ColorRGB.h"
+
+namespace dae
+{
+	//Bit layout of a 32-bit output pixel, queried from the surface once per frame
+	struct PixelFormat
+	{
+		uint32_t redShift{ 16 };
+		uint32_t greenShift{ 8 };
+		uint32_t blueShift{ 0 };
+		uint32_t alphaMask{ 0 };
+	};
+
+	enum class ToneMappingOperator
+	{
+		MaxToOne,
+		Reinhard,
+		ACES
+	};
+
+	//Converts the linear HDR framebuffer to packed 8-bit pixels: exposure, tone mapping, optional sRGB encoding
+	class ToneMapper final
+	{
+	public:
+		ToneMapper();
+		~ToneMapper() = default;
+
+		ToneMapper(const ToneMapper&) = delete;
+		ToneMapper(ToneMapper&&) noexcept = delete;
+		ToneMapper& operator=(const ToneMapper&) = delete;
+		ToneMapper& operator=(ToneMapper&&) noexcept = delete;
+
+		/**
+		 * \brief Tone maps and packs a run of pixels
+		 * \param pSource linear colors
+		 * \param pDestination packed pixels
+		 * \param count amount of pixels
+		 * \param format bit layout of the destination
+		 */
+		void Apply(const ColorRGB* pSource, uint32_t* pDestination, uint32_t count, const PixelFormat& format) const;
+
+		void CycleOperator();
+		void ToggleSRGB() { m_SRGBEnabled = !m_SRGBEnabled; };
+		void SetExposure(float stops) { m_ExposureStops = stops; };
+		float GetExposure() const { return m_ExposureStops; };
+		ToneMappingOperator GetOperator() const { return m_Operator; };
+
+	private:
+		ToneMappingOperator m_Operator{ ToneMappingOperator::MaxToOne };
+		bool m_SRGBEnabled{ false };
+		float m_ExposureStops{ 0.f };
+
+		//Linear [0, 1] to 8-bit sRGB, 12-bit precision
+		static constexpr uint32_t m_SRGBTableSize{ 4096 };
+		uint8_t m_SRGBTable[m_SRGBTableSize]{};
+
+		ColorRGB ToneMap(ColorRGB color) const;
+		uint32_t Pack(const ColorRGB& color, const PixelFormat& format) const;
+	};
+}
@@ -0,0 +1,566 @@
+#include "Utils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include "MappedFile.h"
+#include "ModelImporter.h"
+
+#define PARALLEL_EXECUTION
+
+namespace dae
+{
+	namespace Utils
+	{
+#pragma region OBJ
+		//Marks a face corner without a vn reference
+		constexpr int OBJ_NO_INDEX{ INT_MIN };
+		constexpr size_t OBJ_MIN_CHUNK_SIZE{ 1 << 20 };
+
+		//Everything one thread parsed from its part of the file. Indices are stored as written, relative (negative) ones
+		//can point into earlier chunks and are resolved against the counts before their face once the chunk offsets are known
+		struct OBJChunk
+		{
+			const char* pBegin{};
+			const char* pEnd{};
+
+			std::vector<Vector3> positions{};
+			std::vector<Vector3> vertexNormals{};
+			std::vector<int> faceSizes{};
+			//Positions and vertex normals this chunk defined before each face
+			std::vector<int> facePositionCounts{};
+			std::vector<int> faceVertexNormalCounts{};
+			std::vector<int> cornerPositions{};
+			std::vector<int> cornerNormals{};
+
+			size_t positionOffset{};
+			size_t vertexNormalOffset{};
+			size_t triangleOffset{};
+			size_t triangleCount{};
+
+			bool isValid{ true };
+		};
+
+		template<typename Function>
+		static void ForEachChunk(std::vector<OBJChunk>& chunks, const Function& function)
+		{
+#if defined(PARALLEL_EXECUTION)
+			std::for_each(std::execution::par, chunks.begin(), chunks.end(), function);
+#else
+			std::for_each(chunks.begin(), chunks.end(), function);
+#endif
+		}
+
+		static const char* SkipSpaces(const char* pCurrent, const char* pEnd)
+		{
+			while (pCurrent < pEnd && (*pCurrent == ' ' || *pCurrent == '\t'))
+				++pCurrent;
+			return pCurrent;
+		}
+
+		static const char* ParseFloat(const char* pCurrent, const char* pEnd, float& value)
+		{
+			pCurrent = SkipSpaces(pCurrent, pEnd);
+			if (pCurrent < pEnd && *pCurrent == '+')
+				++pCurrent;
+			const auto result{ std::from_chars(pCurrent, pEnd, value) };
+			return result.ec == std::errc{} ? result.ptr : nullptr;
+		}
+
+		//OBJ indices are 1-based, negative indices count back from the last element defined before the face.
+		//The result is negative when a relative index reaches before the first element
+		static int ResolveIndex(int index, size_t definedCount)
+		{
+			return index > 0 ? index - 1 : int(definedCount) + index;
+		}
+
+		static bool ParseFace(const char* pCurrent, const char* pEnd, OBJChunk& chunk)
+		{
+			int cornerCount{};
+			while (true)
+			{
+				pCurrent = SkipSpaces(pCurrent, pEnd);
+				if (pCurrent >= pEnd || *pCurrent == '\r' || *pCurrent == '#')
+					break;
+
+				int positionIndex{}, normalIndex{ OBJ_NO_INDEX };
+				auto result{ std::from_chars(pCurrent, pEnd, positionIndex) };
+				if (result.ec != std::errc{} || positionIndex == 0)
+					return false;
+				pCurrent = result.ptr;
+
+				//Optional /vt and /vn, texture coordinates are skipped
+				if (pCurrent < pEnd && *pCurrent == '/')
+				{
+					++pCurrent;
+					int ignoredIndex{};
+					result = std::from_chars(pCurrent, pEnd, ignoredIndex);
+					if (result.ec == std::errc{})
+						pCurrent = result.ptr;
+
+					if (pCurrent < pEnd && *pCurrent == '/')
+					{
+						++pCurrent;
+						result = std::from_chars(pCurrent, pEnd, normalIndex);
+						if (result.ec != std::errc{} || normalIndex == 0 || normalIndex == OBJ_NO_INDEX)
+							return false;
+						pCurrent = result.ptr;
+					}
+				}
+
+				chunk.cornerPositions.push_back(positionIndex);
+				chunk.cornerNormals.push_back(normalIndex);
+				++cornerCount;
+			}
+
+			if (cornerCount < 3)
+			{
+				chunk.cornerPositions.resize(chunk.cornerPositions.size() - cornerCount);
+				chunk.cornerNormals.resize(chunk.cornerNormals.size() - cornerCount);
+				return cornerCount == 0;
+			}
+
+			chunk.faceSizes.push_back(cornerCount);
+			chunk.facePositionCounts.push_back(int(chunk.positions.size()));
+			chunk.faceVertexNormalCounts.push_back(int(chunk.vertexNormals.size()));
+			chunk.triangleCount += cornerCount - 2;
+			return true;
+		}
+
+		static void ParseChunk(OBJChunk& chunk)
+		{
+			const char* pCurrent{ chunk.pBegin };
+			while (pCurrent < chunk.pEnd && chunk.isValid)
+			{
+				const char* pLineEnd{ static_cast<const char*>(std::memchr(pCurrent, '\n', chunk.pEnd - pCurrent)) };
+				if (!pLineEnd)
+					pLineEnd = chunk.pEnd;
+
+				pCurrent = SkipSpaces(pCurrent, pLineEnd);
+				if (pLineEnd - pCurrent >= 2 && pCurrent[0] == 'v' && (pCurrent[1] == ' ' || pCurrent[1] == '\t'))
+				{
+					Vector3 position{};
+					const char* pNext{ ParseFloat(pCurrent + 2, pLineEnd, position.x) };
+					if (pNext) pNext = ParseFloat(pNext, pLineEnd, position.y);
+					if (pNext) pNext = ParseFloat(pNext, pLineEnd, position.z);
+					chunk.isValid = pNext != nullptr;
+					chunk.positions.push_back(position);
+				}
+				else if (pLineEnd - pCurrent >= 3 && pCurrent[0] == 'v' && pCurrent[1] == 'n' && (pCurrent[2] == ' ' || pCurrent[2] == '\t'))
+				{
+					Vector3 normal{};
+					const char* pNext{ ParseFloat(pCurrent + 3, pLineEnd, normal.x) };
+					if (pNext) pNext = ParseFloat(pNext, pLineEnd, normal.y);
+					if (pNext) pNext = ParseFloat(pNext, pLineEnd, normal.z);
+					chunk.isValid = pNext != nullptr;
+					chunk.vertexNormals.push_back(normal);
+				}
+				else if (pLineEnd - pCurrent >= 2 && pCurrent[0] == 'f' && (pCurrent[1] == ' ' || pCurrent[1] == '\t'))
+				{
+					chunk.isValid = ParseFace(pCurrent + 2, pLineEnd, chunk);
+				}
+				//Comments, vt, groups, objects, smoothing groups and materials are ignored
+
+				pCurrent = pLineEnd + 1;
+			}
+		}
+
+		bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices,
+			std::vector<Vector3>* pCornerNormals)
+		{
+			const auto startTime{ std::chrono::steady_clock::now() };
+
+			const MappedFile file{ filename };
+			if (!file.IsOpen())
+				return false;
+
+			//1. Split the file at line boundaries, a few chunks per hardware thread for load balancing
+			const char* pData{ file.GetData() };
+			const size_t fileSize{ file.GetSize() };
+			const size_t threadCount{ std::max(1u, std::thread::hardware_concurrency()) };
+			const size_t chunkSize{ std::max(OBJ_MIN_CHUNK_SIZE, fileSize / (threadCount * 4) + 1) };
+
+			std::vector<OBJChunk> chunks{};
+			for (size_t begin{}; begin < fileSize;)
+			{
+				size_t end{ std::min(begin + chunkSize, fileSize) };
+				const char* pNewLine{ static_cast<const char*>(std::memchr(pData + end, '\n', fileSize - end)) };
+				end = pNewLine ? size_t(pNewLine - pData) + 1 : fileSize;
+
+				OBJChunk chunk{};
+				chunk.pBegin = pData + begin;
+				chunk.pEnd = pData + end;
+				chunks.emplace_back(std::move(chunk));
+				begin = end;
+			}
+
+			//2. Parse all chunks in parallel
+			ForEachChunk(chunks, ParseChunk);
+
+			size_t positionCount{}, vertexNormalCount{}, triangleCount{};
+			for (OBJChunk& chunk : chunks)
+			{
+				if (!chunk.isValid)
+				{
+					std::cout << "Failed to parse " << filename << std::endl;
+					return false;
+				}
+				chunk.positionOffset = positionCount;
+				chunk.vertexNormalOffset = vertexNormalCount;
+				chunk.triangleOffset = triangleCount;
+				positionCount += chunk.positions.size();
+				vertexNormalCount += chunk.vertexNormals.size();
+				triangleCount += chunk.triangleCount;
+			}
+
+			//3. Merge, resolve relative indices and fan triangulate
+			const bool hasCornerNormals{ pCornerNormals && vertexNormalCount > 0 };
+			std::vector<Vector3> vertexNormals(hasCornerNormals ? vertexNormalCount : 0);
+			positions.resize(positionCount);
+			indices.resize(triangleCount * 3);
+			normals.resize(triangleCount);
+
+			ForEachChunk(chunks, [&](OBJChunk& chunk) {
+				std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionOffset);
+				if (hasCornerNormals)
+					std::copy(chunk.vertexNormals.begin(), chunk.vertexNormals.end(), vertexNormals.begin() + chunk.vertexNormalOffset);
+
+				size_t corner{}, index{ chunk.triangleOffset * 3 };
+				for (size_t face{}; face < chunk.faceSizes.size(); ++face)
+				{
+					//Resolved in place, the corner normals are looked up by global index below
+					const int faceSize{ chunk.faceSizes[face] };
+					const size_t definedPositionCount{ chunk.positionOffset + chunk.facePositionCounts[face] };
+					const size_t definedVertexNormalCount{ chunk.vertexNormalOffset + chunk.faceVertexNormalCounts[face] };
+					for (int faceCorner{}; faceCorner < faceSize; ++faceCorner)
+					{
+						int& positionIndex{ chunk.cornerPositions[corner + faceCorner] };
+						positionIndex = ResolveIndex(positionIndex, definedPositionCount);
+						int& normalIndex{ chunk.cornerNormals[corner + faceCorner] };
+						if (normalIndex == OBJ_NO_INDEX)
+							continue;
+						normalIndex = ResolveIndex(normalIndex, definedVertexNormalCount);
+						if (normalIndex < 0 || size_t(normalIndex) >= vertexNormalCount)
+							chunk.isValid = false;
+					}
+
+					const int first{ chunk.cornerPositions[corner] };
+					for (int triangle{}; triangle < faceSize - 2; ++triangle)
+					{
+						indices[index++] = first;
+						indices[index++] = chunk.cornerPositions[corner + triangle + 1];
+						indices[index++] = chunk.cornerPositions[corner + triangle + 2];
+					}
+					corner += faceSize;
+				}
+				});
+
+			const bool hasInvalidIndex{ std::any_of(indices.begin(), indices.end(), [&](int index) { return index < 0 || size_t(index) >= positionCount; }) };
+			if (hasInvalidIndex)
+			{
+				std::cout << "Failed to parse " << filename << ": vertex index out of range" << std::endl;
+				return false;
+			}
+			const bool hasInvalidNormalIndex{ std::any_of(chunks.begin(), chunks.end(), [](const OBJChunk& chunk) { return !chunk.isValid; }) };
+			if (hasInvalidNormalIndex)
+			{
+				std::cout << "Failed to parse " << filename << ": vertex normal index out of range" << std::endl;
+				return false;
+			}
+
+			//4. Per face data, needs all positions
+			ForEachChunk(chunks, [&](OBJChunk& chunk) {
+				for (size_t triangle{ chunk.triangleOffset }; triangle < chunk.triangleOffset + chunk.triangleCount; ++triangle)
+				{
+					const Vector3& v0{ positions[indices[triangle * 3]] };
+					const Vector3 edgeV0V1{ positions[indices[triangle * 3 + 1]] - v0 };
+					const Vector3 edgeV0V2{ positions[indices[triangle * 3 + 2]] - v0 };
+					const Vector3 normal{ Vector3::Cross(edgeV0V1, edgeV0V2) };
+
+					//Degenerate triangles keep a zero normal, they can never be hit
+					const float length{ normal.Magnitude() };
+					normals[triangle] = length > 0.f ? normal / length : Vector3::Zero;
+				}
+				});
+
+			if (hasCornerNormals)
+			{
+				pCornerNormals->assign(indices.size(), Vector3::Zero);
+				ForEachChunk(chunks, [&](OBJChunk& chunk) {
+					size_t corner{}, index{ chunk.triangleOffset * 3 };
+					for (const int faceSize : chunk.faceSizes)
+					{
+						auto cornerNormal = [&](size_t faceCorner)
+						{
+							const int normalIndex{ chunk.cornerNormals[corner + faceCorner] };
+							if (normalIndex == OBJ_NO_INDEX)
+								return Vector3::Zero;
+							return vertexNormals[normalIndex];
+						};
+
+						for (int triangle{}; triangle < faceSize - 2; ++triangle)
+						{
+							(*pCornerNormals)[index++] = cornerNormal(0);
+							(*pCornerNormals)[index++] = cornerNormal(triangle + 1);
+							(*pCornerNormals)[index++] = cornerNormal(triangle + 2);
+						}
+						corner += faceSize;
+					}
+					});
+			}
+			else if (pCornerNormals)
+			{
+				pCornerNormals->clear();
+			}
+
+			const float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count() };
+			std::cout << "Loaded " << filename << ": " << positionCount << " vertices, " << triangleCount << " triangles in "
+				<< seconds * 1000.f << " ms (" << (fileSize / (1024.f * 1024.f)) / std::max(seconds, 1e-6f) << " MB/s)" << std::endl;
+
+			return true;
+		}
+#pragma endregion
+#pragma region Mesh Cache
+		constexpr char MESH_CACHE_MAGIC[8]{ 'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0' };
+		//Bump whenever the layout of the header, Vector3 or BVHNode or the mesh preprocessing changes
+		constexpr uint32_t MESH_CACHE_VERSION{ 3 };
+		constexpr uint64_t MESH_CACHE_ALIGNMENT{ 64 };
+
+		//Blocks are stored at aligned offsets behind the header, in the order of the counts
+		struct MeshCacheHeader
+		{
+			char magic[8]{};
+			uint32_t version{};
+			uint32_t reserved{};
+			uint64_t sourceSize{};
+			int64_t sourceWriteTime{};
+
+			//Object space bounds, readable without touching the blocks
+			float minAABB[3]{};
+			float maxAABB[3]{};
+
+			uint64_t positionCount{};
+			uint64_t normalCount{};
+			uint64_t indexCount{};
+			uint64_t nodeCount{};
+
+			uint64_t positionOffset{};
+			uint64_t normalOffset{};
+			uint64_t indexOffset{};
+			uint64_t nodeOffset{};
+		};
+
+		static std::string GetMeshCachePath(const std::string& filename)
+		{
+			return filename + ".meshcache";
+		}
+
+		bool GetSourceStamp(const std::string& filename, uint64_t& size, int64_t& writeTime)
+		{
+			std::error_code error{};
+			size = std::filesystem::file_size(filename, error);
+			if (error)
+				return false;
+			writeTime = std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+			return !error;
+		}
+
+		static uint64_t AlignOffset(uint64_t offset)
+		{
+			return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+		}
+
+		template<typename T>
+		static bool CopyBlock(const MappedFile& file, uint64_t offset, uint64_t count, std::vector<T>& destination)
+		{
+			if (offset > file.GetSize() || count > (file.GetSize() - offset) / sizeof(T))
+				return false;
+			destination.resize(count);
+			std::memcpy(destination.data(), file.GetData() + offset, count * sizeof(T));
+			return true;
+		}
+
+		//Reads the header and checks that it belongs to the current version of the source
+		static bool ReadMeshCacheHeader(const std::string& filename, const MappedFile& file, MeshCacheHeader& header)
+		{
+			uint64_t sourceSize{};
+			int64_t sourceWriteTime{};
+			if (!file.IsOpen() || file.GetSize() < sizeof(MeshCacheHeader) || !GetSourceStamp(filename, sourceSize, sourceWriteTime))
+				return false;
+
+			std::memcpy(&header, file.GetData(), sizeof(MeshCacheHeader));
+			return std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0 && header.version == MESH_CACHE_VERSION
+				&& header.sourceSize == sourceSize && header.sourceWriteTime == sourceWriteTime
+				&& header.indexCount == header.normalCount * 3;
+		}
+
+		static bool LoadMeshCache(const std::string& filename, TriangleMesh& mesh)
+		{
+			const MappedFile file{ GetMeshCachePath(filename) };
+			MeshCacheHeader header{};
+			if (!ReadMeshCacheHeader(filename, file, header))
+				return false;
+
+			bool isValid{ CopyBlock(file, header.positionOffset, header.positionCount, mesh.positions)
+				&& CopyBlock(file, header.normalOffset, header.normalCount, mesh.normals)
+				&& CopyBlock(file, header.indexOffset, header.indexCount, mesh.indices)
+				&& CopyBlock(file, header.nodeOffset, header.nodeCount, mesh.bvhNodes) };
+
+			//A damaged cache must not cause out of bounds reads during traversal
+			const int positionCount{ static_cast<int>(header.positionCount) };
+			const int triangleCount{ static_cast<int>(header.normalCount) };
+			const int nodeCount{ static_cast<int>(header.nodeCount) };
+			isValid = isValid && std::all_of(mesh.indices.begin(), mesh.indices.end(), [&](int index) { return index >= 0 && index < positionCount; });
+			for (int nodeIndex{}; nodeIndex < nodeCount && isValid; ++nodeIndex)
+			{
+				const BVHNode& node{ mesh.bvhNodes[nodeIndex] };
+				isValid = node.IsLeaf() ? node.leftFirst >= 0 && node.leftFirst + node.triangleCount <= triangleCount
+					: node.leftFirst > nodeIndex && node.leftFirst + 1 < nodeCount;
+			}
+
+			//Children come after their parent, so one pass finds every depth. Traversal holds at most one pending
+			//sibling per level plus the two children it pushes, a deeper tree would overflow its stack
+			std::vector<int> nodeDepths(isValid ? nodeCount : 0);
+			for (int nodeIndex{}; nodeIndex < int(nodeDepths.size()) && isValid; ++nodeIndex)
+			{
+				const BVHNode& node{ mesh.bvhNodes[nodeIndex] };
+				if (node.IsLeaf())
+					continue;
+				const int childDepth{ nodeDepths[nodeIndex] + 1 };
+				nodeDepths[node.leftFirst] = std::max(nodeDepths[node.leftFirst], childDepth);
+				nodeDepths[node.leftFirst + 1] = std::max(nodeDepths[node.leftFirst + 1], childDepth);
+				isValid = childDepth + 1 <= TriangleMesh::bvhStackSize;
+			}
+			if (!isValid)
+			{
+				mesh.positions.clear();
+				mesh.normals.clear();
+				mesh.indices.clear();
+				mesh.bvhNodes.clear();
+			}
+			return isValid;
+		}
+
+		static bool SaveMeshCache(const std::string& filename, const TriangleMesh& mesh)
+		{
+			MeshCacheHeader header{};
+			std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+			header.version = MESH_CACHE_VERSION;
+			if (!GetSourceStamp(filename, header.sourceSize, header.sourceWriteTime))
+				return false;
+
+			for (int axis{}; axis < 3; ++axis)
+			{
+				header.minAABB[axis] = mesh.minAABB[axis];
+				header.maxAABB[axis] = mesh.maxAABB[axis];
+			}
+
+			header.positionCount = mesh.positions.size();
+			header.normalCount = mesh.normals.size();
+			header.indexCount = mesh.indices.size();
+			header.nodeCount = mesh.bvhNodes.size();
+			header.positionOffset = AlignOffset(sizeof(MeshCacheHeader));
+			header.normalOffset = AlignOffset(header.positionOffset + header.positionCount * sizeof(Vector3));
+			header.indexOffset = AlignOffset(header.normalOffset + header.normalCount * sizeof(Vector3));
+			header.nodeOffset = AlignOffset(header.indexOffset + header.indexCount * sizeof(int));
+
+			//Written under a temporary name so a crash never leaves a truncated cache behind
+			const std::string cachePath{ GetMeshCachePath(filename) };
+			const std::string temporaryPath{ cachePath + ".tmp" };
+			{
+				std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+				if (!file)
+					return false;
+
+				auto writeBlock = [&](uint64_t offset, const void* pData, uint64_t size)
+				{
+					const char padding[MESH_CACHE_ALIGNMENT]{};
+					file.write(padding, std::streamsize(offset - uint64_t(file.tellp())));
+					file.write(static_cast<const char*>(pData), std::streamsize(size));
+				};
+				file.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheHeader));
+				writeBlock(header.positionOffset, mesh.positions.data(), header.positionCount * sizeof(Vector3));
+				writeBlock(header.normalOffset, mesh.normals.data(), header.normalCount * sizeof(Vector3));
+				writeBlock(header.indexOffset, mesh.indices.data(), header.indexCount * sizeof(int));
+				writeBlock(header.nodeOffset, mesh.bvhNodes.data(), header.nodeCount * sizeof(BVHNode));
+				if (!file)
+					return false;
+			}
+
+			std::error_code error{};
+			std::filesystem::rename(temporaryPath, cachePath, error);
+			return !error;
+		}
+
+		void OptimizeMesh(const std::string& name, TriangleMesh& mesh)
+		{
+			const auto startTime{ std::chrono::steady_clock::now() };
+			const MeshOptimizationStats stats{ mesh.Optimize() };
+			const float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count() };
+
+			const float savedKB{ (static_cast<float>(stats.bytesBefore) - static_cast<float>(stats.bytesAfter)) / 1024.f };
+			std::cout << "Optimized " << name << ": " << stats.vertexCountBefore << " -> " << stats.vertexCountAfter << " vertices, "
+				<< stats.triangleCountBefore << " -> " << stats.triangleCountAfter << " triangles, " << savedKB << " KB saved in "
+				<< seconds * 1000.f << " ms" << std::endl;
+		}
+
+		void CompactMesh(const std::string& name, TriangleMesh& mesh)
+		{
+			//Count the transformed copies a regular mesh allocates on its first UpdateTransforms, even if it did not run yet
+			size_t bytesBefore{ mesh.GetMemoryUsage() };
+			if (mesh.transformedPositions.empty())
+				bytesBefore += (mesh.positions.size() + mesh.normals.size()) * sizeof(Vector3) + mesh.bvhNodes.size() * sizeof(BVHNode);
+			mesh.Compact();
+			const size_t bytesAfter{ mesh.GetMemoryUsage() };
+
+			std::cout << "Compacted " << name << ": " << bytesBefore / 1024.f << " KB -> " << bytesAfter / 1024.f << " KB ("
+				<< mesh.overflowIndices.size() / 3 << " triangles kept 32 bit indices)" << std::endl;
+		}
+
+		bool LoadMesh(const std::string& filename, TriangleMesh& mesh)
+		{
+			const auto startTime{ std::chrono::steady_clock::now() };
+			if (LoadMeshCache(filename, mesh))
+			{
+				mesh.UpdateAABB();
+				const float seconds{ std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count() };
+				std::cout << "Loaded " << GetMeshCachePath(filename) << ": " << mesh.positions.size() << " vertices, " << mesh.normals.size()
+					<< " triangles, " << mesh.bvhNodes.size() << " BVH nodes in " << seconds * 1000.f << " ms" << std::endl;
+				return true;
+			}
+
+			const bool isPLY{ std::filesystem::path{ filename }.extension() == ".ply" };
+			const bool isParsed{ isPLY ? ParsePLY(filename, mesh.positions, mesh.normals, mesh.indices)
+				: ParseOBJ(filename, mesh.positions, mesh.normals, mesh.indices) };
+			if (!isParsed)
+				return false;
+			OptimizeMesh(filename, mesh);
+			mesh.UpdateAABB();
+			mesh.BuildBVH();
+
+			if (!SaveMeshCache(filename, mesh))
+				std::cout << "Failed to write " << GetMeshCachePath(filename) << std::endl;
+			return true;
+		}
+		bool PeekMeshBounds(const std::string& filename, Vector3& minAABB, Vector3& maxAABB)
+		{
+			const MappedFile file{ GetMeshCachePath(filename) };
+			MeshCacheHeader header{};
+			if (!ReadMeshCacheHeader(filename, file, header))
+				return false;
+
+			minAABB = { header.minAABB[0], header.minAABB[1], header.minAABB[2] };
+			maxAABB = { header.maxAABB[0], header.maxAABB[1], header.maxAABB[2] };
+			return true;
+		}
+#pragma endregion
+	}
+}
@@ -1,8 +1,11 @@
 #pragma once
 #include <cassert>
-#include <fstream>
+#include <string>
+#include <vector>
 #include "Math.h"
 #include "DataTypes.h"
+#include "ClusterCache.h"
+#include "RenderCounters.h"
 
 namespace dae
 {
@@ -12,6 +15,7 @@ namespace dae
 		//SPHERE HIT-TESTS
 		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
+			COUNT_RENDER_STAT(SphereTests);
 			const Vector3& rayToSphere{ sphere.origin - ray.origin };
 			const float tCa{ Vector3::Dot(rayToSphere, ray.direction) };
 			const float odSqr{ rayToSphere.SqrMagnitude() - Square(tCa) };
@@ -39,6 +43,7 @@ namespace dae
 
 		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray)
 		{
+			COUNT_RENDER_STAT(SphereTests);
 			const Vector3& rayToSphere{ sphere.origin - ray.origin };
 			const float tCa{ Vector3::Dot(rayToSphere, ray.direction) };
 			const float odSqr{ rayToSphere.SqrMagnitude() - Square(tCa) };
@@ -57,6 +62,7 @@ namespace dae
 		//PLANE HIT-TESTS
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
+			COUNT_RENDER_STAT(PlaneTests);
 			const float t{ Vector3::Dot(plane.origin - ray.origin, plane.normal) / Vector3::Dot(ray.direction, plane.normal) };
 			
 			if (t > ray.min && t < ray.max)
@@ -76,6 +82,7 @@ namespace dae
 
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
 		{
+			COUNT_RENDER_STAT(PlaneTests);
 			const float t{ Vector3::Dot(plane.origin - ray.origin, plane.normal) / Vector3::Dot(ray.direction, plane.normal) };
 			return (t > ray.min && t < ray.max);
 		}
@@ -84,6 +91,7 @@ namespace dae
 		//TRIANGLE HIT-TESTS
 		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
+			COUNT_RENDER_STAT(TriangleTests);
 			const float dot{ Vector3::Dot(triangle.normal, ray.direction) };
 			switch (triangle.cullMode)
 			{
@@ -131,6 +139,7 @@ namespace dae
 
 		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray)
 		{
+			COUNT_RENDER_STAT(TriangleTests);
 			const float dot{ Vector3::Dot(triangle.normal, ray.direction) };
 			switch (triangle.cullMode)
 			{
@@ -171,6 +180,7 @@ namespace dae
 #pragma region TriangleMesh HitTest
 		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
 		{
+			COUNT_RENDER_STAT(AABBTests);
 			float t1 = (mesh.transformedMinAABB.x - ray.origin.x) / ray.direction.x;
 			float t2 = (mesh.transformedMaxAABB.x - ray.origin.x) / ray.direction.x;
 
@@ -198,20 +208,226 @@ namespace dae
 			return tmax > 0 && tmax >= tmin;
 		}
 
+		//Slab test against precomputed reciprocal ray directions, only accepts boxes entered before maxDistance
+		inline bool SlabTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, const Ray& ray, const Vector3& inverseDirection, float maxDistance)
+		{
+			COUNT_RENDER_STAT(AABBTests);
+			float tmin{ -FLT_MAX };
+			float tmax{ FLT_MAX };
+			for (int axis{}; axis < 3; ++axis)
+			{
+				const float t1{ (minAABB[axis] - ray.origin[axis]) * inverseDirection[axis] };
+				const float t2{ (maxAABB[axis] - ray.origin[axis]) * inverseDirection[axis] };
+				tmin = std::max(tmin, std::min(t1, t2));
+				tmax = std::min(tmax, std::max(t1, t2));
+			}
+			return tmax > 0 && tmax >= tmin && tmin < maxDistance;
+		}
+
+		//Compact meshes are hit tested in object space, the direction is not normalized so t stays a world space distance
+		inline Ray GetObjectSpaceRay(const TriangleMesh& mesh, const Ray& ray)
+		{
+			Ray objectRay{ ray };
+			objectRay.origin = mesh.inverseTransform.TransformPoint(ray.origin);
+			objectRay.direction = mesh.inverseTransform.TransformVector(ray.direction);
+			return objectRay;
+		}
+
+		//Closest hit against the object space hierarchy of a compact mesh or cluster, clusters take the cull mode of their mesh
+		inline void HitTest_CompactBVH(const TriangleMesh& mesh, TriangleCullMode cullMode, const Ray& objectRay, const Vector3& inverseDirection, HitRecord& objectHit, bool ignoreHitRecord)
+		{
+			if (mesh.bvhNodes.empty())
+				return;
+
+			Triangle currTriangle{};
+			currTriangle.cullMode = cullMode;
+
+			int nodeStack[TriangleMesh::bvhStackSize]{};
+			int stackSize{ 1 };
+			while (stackSize > 0)
+			{
+				const int nodeIndex{ nodeStack[--stackSize] };
+				const BVHNode& node{ mesh.bvhNodes[nodeIndex] };
+				if (!SlabTest_AABB(node.minAABB, node.maxAABB, objectRay, inverseDirection, ignoreHitRecord ? objectRay.max : objectHit.t))
+					continue;
+
+				if (node.IsLeaf())
+				{
+					for (int triangleIndex{ node.leftFirst }; triangleIndex < node.leftFirst + node.triangleCount; ++triangleIndex)
+					{
+						mesh.GetCompactTriangle(nodeIndex, triangleIndex, currTriangle);
+						HitTest_Triangle(currTriangle, objectRay, objectHit, ignoreHitRecord);
+					}
+					continue;
+				}
+				nodeStack[stackSize++] = node.leftFirst + 1;
+				nodeStack[stackSize++] = node.leftFirst;
+			}
+		}
+
+		inline bool HitTest_CompactBVH(const TriangleMesh& mesh, TriangleCullMode cullMode, const Ray& objectRay, const Vector3& inverseDirection)
+		{
+			if (mesh.bvhNodes.empty())
+				return false;
+
+			Triangle currTriangle{};
+			currTriangle.cullMode = cullMode;
+
+			int nodeStack[TriangleMesh::bvhStackSize]{};
+			int stackSize{ 1 };
+			while (stackSize > 0)
+			{
+				const int nodeIndex{ nodeStack[--stackSize] };
+				const BVHNode& node{ mesh.bvhNodes[nodeIndex] };
+				if (!SlabTest_AABB(node.minAABB, node.maxAABB, objectRay, inverseDirection, objectRay.max))
+					continue;
+
+				if (node.IsLeaf())
+				{
+					for (int triangleIndex{ node.leftFirst }; triangleIndex < node.leftFirst + node.triangleCount; ++triangleIndex)
+					{
+						mesh.GetCompactTriangle(nodeIndex, triangleIndex, currTriangle);
+						if (HitTest_Triangle(currTriangle, objectRay))
+							return true;
+					}
+					continue;
+				}
+				nodeStack[stackSize++] = node.leftFirst + 1;
+				nodeStack[stackSize++] = node.leftFirst;
+			}
+			return false;
+		}
+
+		//Moves an object space hit of a compact or out of core mesh back to world space
+		inline bool ResolveObjectSpaceHit(const TriangleMesh& mesh, const Ray& ray, const HitRecord& objectHit, HitRecord& hitRecord)
+		{
+			if (objectHit.didHit)
+			{
+				hitRecord = objectHit;
+				hitRecord.materialIndex = mesh.materialIndex;
+				hitRecord.origin = ray.origin + ray.direction * objectHit.t;
+				hitRecord.normal = mesh.GetTransform().TransformVector(objectHit.normal).Normalized();
+			}
+			return hitRecord.didHit;
+		}
+
+		inline bool HitTest_CompactTriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord)
+		{
+			const Ray objectRay{ GetObjectSpaceRay(mesh, ray) };
+			const Vector3 inverseDirection{ 1.f / objectRay.direction.x, 1.f / objectRay.direction.y, 1.f / objectRay.direction.z };
+
+			HitRecord objectHit{};
+			objectHit.t = hitRecord.t;
+			HitTest_CompactBVH(mesh, mesh.cullMode, objectRay, inverseDirection, objectHit, ignoreHitRecord);
+			return ResolveObjectSpaceHit(mesh, ray, objectHit, hitRecord);
+		}
+
+		inline bool HitTest_CompactTriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		{
+			const Ray objectRay{ GetObjectSpaceRay(mesh, ray) };
+			const Vector3 inverseDirection{ 1.f / objectRay.direction.x, 1.f / objectRay.direction.y, 1.f / objectRay.direction.z };
+			return HitTest_CompactBVH(mesh, mesh.cullMode, objectRay, inverseDirection);
+		}
+
+		//Out of core meshes traverse their resident top levels, clusters are paged in through the cache (or skipped while deferring)
+		inline bool HitTest_ClusteredTriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord)
+		{
+			const Ray objectRay{ GetObjectSpaceRay(mesh, ray) };
+			const Vector3 inverseDirection{ 1.f / objectRay.direction.x, 1.f / objectRay.direction.y, 1.f / objectRay.direction.z };
+
+			HitRecord objectHit{};
+			objectHit.t = hitRecord.t;
+
+			int nodeStack[TriangleMesh::bvhStackSize]{};
+			int stackSize{ 1 };
+			while (stackSize > 0)
+			{
+				const BVHNode& node{ mesh.bvhNodes[nodeStack[--stackSize]] };
+				if (!SlabTest_AABB(node.minAABB, node.maxAABB, objectRay, inverseDirection, ignoreHitRecord ? objectRay.max : objectHit.t))
+					continue;
+
+				if (node.IsLeaf())
+				{
+					const std::shared_ptr<const TriangleMesh> pCluster{ mesh.pClusterCache->Acquire(mesh.clusterFileIndex, node.leftFirst) };
+					if (pCluster)
+						HitTest_CompactBVH(*pCluster, mesh.cullMode, objectRay, inverseDirection, objectHit, ignoreHitRecord);
+					continue;
+				}
+				nodeStack[stackSize++] = node.leftFirst + 1;
+				nodeStack[stackSize++] = node.leftFirst;
+			}
+			return ResolveObjectSpaceHit(mesh, ray, objectHit, hitRecord);
+		}
+
+		inline bool HitTest_ClusteredTriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		{
+			const Ray objectRay{ GetObjectSpaceRay(mesh, ray) };
+			const Vector3 inverseDirection{ 1.f / objectRay.direction.x, 1.f / objectRay.direction.y, 1.f / objectRay.direction.z };
+
+			int nodeStack[TriangleMesh::bvhStackSize]{};
+			int stackSize{ 1 };
+			while (stackSize > 0)
+			{
+				const BVHNode& node{ mesh.bvhNodes[nodeStack[--stackSize]] };
+				if (!SlabTest_AABB(node.minAABB, node.maxAABB, objectRay, inverseDirection, objectRay.max))
+					continue;
+
+				if (node.IsLeaf())
+				{
+					const std::shared_ptr<const TriangleMesh> pCluster{ mesh.pClusterCache->Acquire(mesh.clusterFileIndex, node.leftFirst) };
+					if (pCluster && HitTest_CompactBVH(*pCluster, mesh.cullMode, objectRay, inverseDirection))
+						return true;
+					continue;
+				}
+				nodeStack[stackSize++] = node.leftFirst + 1;
+				nodeStack[stackSize++] = node.leftFirst;
+			}
+			return false;
+		}
+
 		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
 			if (!SlabTest_TriangleMesh(mesh,ray)) return false;
+			if (mesh.pClusterCache) return HitTest_ClusteredTriangleMesh(mesh, ray, hitRecord, ignoreHitRecord);
+			if (mesh.isCompact) return HitTest_CompactTriangleMesh(mesh, ray, hitRecord, ignoreHitRecord);
 			Triangle currTriangle{};
 			currTriangle.cullMode = mesh.cullMode;
 			currTriangle.materialIndex = mesh.materialIndex;
 
-			for (int i{}; i < mesh.indices.size(); i += 3)
+			auto hitTestTriangles = [&](int firstIndex, int lastIndex)
+			{
+				for (int i{ firstIndex }; i < lastIndex; i += 3)
+				{
+					currTriangle.v0 = mesh.transformedPositions[mesh.indices[i]];
+					currTriangle.v1 = mesh.transformedPositions[mesh.indices[i + 1]];
+					currTriangle.v2 = mesh.transformedPositions[mesh.indices[i + 2]];
+					currTriangle.normal = mesh.transformedNormals[i / 3];
+					HitTest_Triangle(currTriangle, ray, hitRecord, ignoreHitRecord);
+				}
+			};
+
+			if (mesh.transformedBVHNodes.empty())
 			{
-				currTriangle.v0 = mesh.transformedPositions[mesh.indices[i]];
-				currTriangle.v1 = mesh.transformedPositions[mesh.indices[i + 1]];
-				currTriangle.v2 = mesh.transformedPositions[mesh.indices[i + 2]];
-				currTriangle.normal = mesh.transformedNormals[i / 3];
-				HitTest_Triangle(currTriangle, ray, hitRecord, ignoreHitRecord);
+				hitTestTriangles(0, static_cast<int>(mesh.indices.size()));
+				return hitRecord.didHit;
+			}
+
+			const Vector3 inverseDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+			int nodeStack[TriangleMesh::bvhStackSize]{};
+			int stackSize{ 1 };
+			while (stackSize > 0)
+			{
+				const BVHNode& node{ mesh.transformedBVHNodes[nodeStack[--stackSize]] };
+				if (!SlabTest_AABB(node.minAABB, node.maxAABB, ray, inverseDirection, ignoreHitRecord ? ray.max : hitRecord.t))
+					continue;
+
+				if (node.IsLeaf())
+				{
+					hitTestTriangles(node.leftFirst * 3, (node.leftFirst + node.triangleCount) * 3);
+					continue;
+				}
+				nodeStack[stackSize++] = node.leftFirst + 1;
+				nodeStack[stackSize++] = node.leftFirst;
 			}
 			return hitRecord.didHit;
 		}
@@ -219,17 +435,45 @@ namespace dae
 		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
 		{
 			if (!SlabTest_TriangleMesh(mesh, ray)) return false;
+			if (mesh.pClusterCache) return HitTest_ClusteredTriangleMesh(mesh, ray);
+			if (mesh.isCompact) return HitTest_CompactTriangleMesh(mesh, ray);
 			Triangle currTriangle{};
 			currTriangle.cullMode = mesh.cullMode;
 
-			for (int i{}; i < mesh.indices.size(); i += 3)
+			auto hitTestTriangles = [&](int firstIndex, int lastIndex)
 			{
-				currTriangle.v0 = mesh.transformedPositions[mesh.indices[i]];
-				currTriangle.v1 = mesh.transformedPositions[mesh.indices[i + 1]];
-				currTriangle.v2 = mesh.transformedPositions[mesh.indices[i + 2]];
-				currTriangle.normal = mesh.transformedNormals[i / 3];
-				if (HitTest_Triangle(currTriangle, ray))
-					return true;
+				for (int i{ firstIndex }; i < lastIndex; i += 3)
+				{
+					currTriangle.v0 = mesh.transformedPositions[mesh.indices[i]];
+					currTriangle.v1 = mesh.transformedPositions[mesh.indices[i + 1]];
+					currTriangle.v2 = mesh.transformedPositions[mesh.indices[i + 2]];
+					currTriangle.normal = mesh.transformedNormals[i / 3];
+					if (HitTest_Triangle(currTriangle, ray))
+						return true;
+				}
+				return false;
+			};
+
+			if (mesh.transformedBVHNodes.empty())
+				return hitTestTriangles(0, static_cast<int>(mesh.indices.size()));
+
+			const Vector3 inverseDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+			int nodeStack[TriangleMesh::bvhStackSize]{};
+			int stackSize{ 1 };
+			while (stackSize > 0)
+			{
+				const BVHNode& node{ mesh.transformedBVHNodes[nodeStack[--stackSize]] };
+				if (!SlabTest_AABB(node.minAABB, node.maxAABB, ray, inverseDirection, ray.max))
+					continue;
+
+				if (node.IsLeaf())
+				{
+					if (hitTestTriangles(node.leftFirst * 3, (node.leftFirst + node.triangleCount) * 3))
+						return true;
+					continue;
+				}
+				nodeStack[stackSize++] = node.leftFirst + 1;
+				nodeStack[stackSize++] = node.leftFirst;
 			}
 			return false;
 		}
@@ -256,76 +500,51 @@ namespace dae
 
 	namespace Utils
 	{
-		//Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
-		{
-			std::ifstream file(filename);
-			if (!file)
-				return false;
-
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
-			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
-				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
-				}
-				else if (sCommand == "f")
-				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
-
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
-				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
-
-				if (file.eof()) 
-					break;
-			}
-
-			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
-			{
-				uint32_t i0 = indices[index];
-				uint32_t i1 = indices[index + 1];
-				uint32_t i2 = indices[index + 2];
-
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
-
-				if(isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normal.Normalize();
-				if (isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normals.push_back(normal);
-			}
-
-			return true;
-		}
-#pragma warning(pop)
+		/**
+		 * \brief Parses an OBJ file through a memory mapping, in parallel chunks
+		 * Supports v, vn and all f forms (v, v/vt, v//vn, v/vt/vn, negative indices), polygons are fan triangulated
+		 * \param filename path to the OBJ file
+		 * \param positions vertex positions
+		 * \param normals one geometric normal per triangle
+		 * \param indices three vertex indices per triangle
+		 * \param pCornerNormals optional, one vn per index (left empty when the file has no vn)
+		 * \return true when the file was parsed successfully
+		 */
+		bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices,
+			std::vector<Vector3>* pCornerNormals = nullptr);
+
+		/**
+		 * \brief Runs TriangleMesh::Optimize and prints the vertices, triangles and memory it saved
+		 * \param name shown in the report
+		 */
+		void OptimizeMesh(const std::string& name, TriangleMesh& mesh);
+
+		/**
+		 * \brief Runs TriangleMesh::Compact and prints the memory footprint before and after
+		 * \param name shown in the report
+		 */
+		void CompactMesh(const std::string& name, TriangleMesh& mesh);
+
+		/**
+		 * \brief Loads a mesh with a prebuilt BVH from the binary cache next to the OBJ or PLY file
+		 * When the cache is missing or older than the source, the source is parsed, optimized and the cache is rewritten
+		 * \param filename path to the OBJ or PLY file
+		 * \param mesh receives positions, normals, indices, the object space AABB and BVH
+		 * \return true when the mesh was loaded
+		 */
+		bool LoadMesh(const std::string& filename, TriangleMesh& mesh);
+
+		/**
+		 * \brief Size and last write time of a file, stored by caches to detect an outdated source
+		 * \return false when the file does not exist
+		 */
+		bool GetSourceStamp(const std::string& filename, uint64_t& size, int64_t& writeTime);
+
+		/**
+		 * \brief Reads the object space bounds of a mesh from its cache without loading the mesh
+		 * \param filename path to the OBJ or PLY file
+		 * \return false when there is no up to date cache
+		 */
+		bool PeekMeshBounds(const std::string& filename, Vector3& minAABB, Vector3& maxAABB);
 	}
 }
\ No newline at end of file
@@ -5,12 +5,24 @@
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <string>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
+#include "RenderTarget.h"
 #include "Scene.h"
+#include "ToneMapper.h"
+#include "FrameStream.h"
+#include "Benchmark.h"
+#include "RenderCounters.h"
+#include "HardwareCounters.h"
+#include "Profiler.h"
+#include "InputRecording.h"
 
 using namespace dae;
 
@@ -20,11 +32,68 @@ void ShutDown(SDL_Window* pWindow)
 	SDL_Quit();
 }
 
+CameraInput ReadCameraInput()
+{
+	const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
+	int mouseX{}, mouseY{};
+	const uint32_t mouseState = SDL_GetRelativeMouseState(&mouseX, &mouseY);
+
+	CameraInput input{};
+	input.moveForward = pKeyboardState[SDL_SCANCODE_W] || pKeyboardState[SDL_SCANCODE_UP];
+	input.moveBackward = pKeyboardState[SDL_SCANCODE_S] || pKeyboardState[SDL_SCANCODE_DOWN];
+	input.moveRight = pKeyboardState[SDL_SCANCODE_D] || pKeyboardState[SDL_SCANCODE_RIGHT];
+	input.moveLeft = pKeyboardState[SDL_SCANCODE_A] || pKeyboardState[SDL_SCANCODE_LEFT];
+	input.narrowFov = pKeyboardState[SDL_SCANCODE_LEFT];
+	input.widenFov = pKeyboardState[SDL_SCANCODE_RIGHT];
+	input.sprint = pKeyboardState[SDL_SCANCODE_LSHIFT];
+	input.mouseX = mouseX;
+	input.mouseY = mouseY;
+	input.leftMouseButton = (mouseState & SDL_BUTTON(1)) != 0;
+	input.rightMouseButton = (mouseState & SDL_BUTTON(3)) != 0;
+	return input;
+}
+
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	//[scene.json] [--stream <destination>] [--stream-format raw|y4m] [--stream-fps <rate>] [--stats <file.csv>] [--trace <file.json>] [--trace-frames <count>] [--perf-counters] [--threads <count>] [--record <file.rtin>]
+	std::string sceneFilename{};
+	std::string statsFilename{};
+	std::string traceFilename{};
+	uint32_t traceFrameCount{ 60 };
+	bool usePerfCounters{ false };
+	uint32_t workerCount{ 0 };
+	std::string recordFilename{};
+	std::string streamDestination{};
+	FrameStreamFormat streamFormat{ FrameStreamFormat::Y4M };
+	uint32_t streamFrameRate{ 30 };
+	for (int index{ 1 }; index < argc; ++index)
+	{
+		const std::string argument{ args[index] };
+		if (argument == "--stream" && index + 1 < argc)
+			streamDestination = args[++index];
+		else if (argument == "--stream-format" && index + 1 < argc)
+			streamFormat = std::string(args[++index]) == "raw" ? FrameStreamFormat::RawRGB : FrameStreamFormat::Y4M;
+		else if (argument == "--stream-fps" && index + 1 < argc)
+			streamFrameRate = uint32_t(std::max(1, std::atoi(args[++index])));
+		else if (argument == "--stats" && index + 1 < argc)
+			statsFilename = args[++index];
+		else if (argument == "--trace" && index + 1 < argc)
+			traceFilename = args[++index];
+		else if (argument == "--trace-frames" && index + 1 < argc)
+			traceFrameCount = uint32_t(std::max(1, std::atoi(args[++index])));
+		else if (argument == "--perf-counters")
+			usePerfCounters = true;
+		else if (argument == "--threads" && index + 1 < argc)
+			workerCount = uint32_t(std::max(1, std::atoi(args[++index])));
+		else if (argument == "--record" && index + 1 < argc)
+			recordFilename = args[++index];
+		else
+			sceneFilename = argument;
+	}
+
+	//Frames streamed to stdout would be corrupted by the log
+	if (streamDestination == "-")
+		std::cout.rdbuf(std::cerr.rdbuf());
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -43,27 +112,82 @@ int main(int argc, char* args[])
 
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	//The renderer presents straight into the window surface
+	SDL_Surface* pSurface = SDL_GetWindowSurface(pWindow);
+	const auto pTarget = new RenderTarget(static_cast<uint32_t*>(pSurface->pixels), uint32_t(pSurface->w), uint32_t(pSurface->h), uint32_t(pSurface->pitch),
+		PixelFormat{ pSurface->format->Rshift, pSurface->format->Gshift, pSurface->format->Bshift, pSurface->format->Amask });
+	const auto pRenderer = new Renderer(pTarget);
+	if (workerCount > 0)
+		pRenderer->SetWorkerCount(workerCount);
+	if (!streamDestination.empty())
+		pRenderer->StartFrameStream(streamDestination, streamFormat, streamFrameRate);
 
-	//const auto pScene = new Scene_W1();
-	//const auto pScene = new Scene_W2();
-	//const auto pScene = new Scene_W3();
-	const auto pScene = new Scene_W4();
-	//const auto pScene = new Scene_W4_BunnyScene();
+	//A scene file on the command line replaces the built-in scene
+	Scene* pScene{ nullptr };
+	std::string sceneName{ sceneFilename };
+	if (!sceneFilename.empty())
+		pScene = new Scene_File(sceneFilename);
+	else
+	{
+		//The name is the RayTracerHeadless --scene of the same scene, recordings and benchmarks are labelled with it
+		//pScene = new Scene_W1(); sceneName = "W1";
+		//pScene = new Scene_W2(); sceneName = "W2";
+		//pScene = new Scene_W3(); sceneName = "W3";
+		pScene = new Scene_W4(); sceneName = "W4";
+		//pScene = new Scene_W4_BunnyScene(); sceneName = "Bunny";
+		//pScene = new Scene_Stress({}); sceneName = "Stress";
+	}
 	pScene->Initialize();
 
+	//Render counters of every frame, only written when they are compiled in
+	std::ofstream statsFile{};
+	if (!statsFilename.empty() && RenderCounters::IsEnabled())
+	{
+		statsFile.open(statsFilename, std::ios::trunc);
+		RenderCounters::WriteCsvHeader(statsFile);
+	}
+	else if (!statsFilename.empty())
+		std::cout << "Render counters are compiled out, define RENDER_COUNTERS to write " << statsFilename << std::endl;
+	RenderStats printStats{};
+	//--perf-counters adds CPU counters per render stage to the periodic print, when the kernel allows them
+	HardwareStats printHardwareStats{};
+	if (usePerfCounters)
+		HardwareCounters::Enable();
+	uint32_t printFrameCount{};
+	uint32_t frameIndex{};
+
+	//--trace records the first frames, F1 starts and stops a capture into trace.json
+	Profiler::SetThreadName("Main");
+	if (!traceFilename.empty())
+		Profiler::BeginCapture();
+	else
+		traceFilename = "trace.json";
+	uint32_t traceStartFrame{};
+
+	//--record saves the input and timing of every frame, RayTracerHeadless --replay renders the session again
+	InputRecorder* pInputRecorder{ nullptr };
+	if (!recordFilename.empty())
+	{
+		//A replay starts with every mesh loaded, meshes swapped in mid-session would render differently
+		pScene->FinishLoading();
+		pInputRecorder = new InputRecorder(recordFilename, sceneName, width, height);
+	}
+
 	//Start loop
 	pTimer->Start();
 
-	// Start Benchmark
-	// pTimer->StartBenchmark();
-
 	float printTimer = 0.f;
 	bool isLooping = true;
 	bool takeScreenshot = false;
+	//F6 benchmarks the current scene into benchmark.json, RayTracerHeadless --benchmark covers every scene
+	bool runBenchmark = false;
 	while (isLooping)
 	{
+		PROFILE_SCOPE("Frame");
+
 		//--------- Get input events ---------
+		//Render settings go through the actions, so a recording sees the same changes the renderer does
+		uint16_t inputActions{};
 		SDL_Event e;
 		while (SDL_PollEvent(&e))
 		{
@@ -76,45 +200,128 @@ int main(int argc, char* args[])
 				if (e.key.keysym.scancode == SDL_SCANCODE_X)
 					takeScreenshot = true;
 				if (e.key.keysym.scancode == SDL_SCANCODE_F2)
-					pRenderer->ToggleShadows();
+					inputActions |= InputAction::ToggleShadows;
 				if (e.key.keysym.scancode == SDL_SCANCODE_F3)
-					pRenderer->CycleLightingMode();
-				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
-					pTimer->StartBenchmark();
+					inputActions |= InputAction::CycleLightingMode;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+					inputActions |= InputAction::ToggleReSTIR;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+					inputActions |= InputAction::ToggleAdaptiveAA;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+					inputActions |= InputAction::ToggleAccumulation;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+					inputActions |= InputAction::ToggleDenoiser;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+					inputActions |= InputAction::CycleToneMapOperator;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+					inputActions |= InputAction::ToggleSRGB;
+				if (e.key.keysym.scancode == SDL_SCANCODE_PAGEUP)
+					inputActions |= InputAction::IncreaseExposure;
+				if (e.key.keysym.scancode == SDL_SCANCODE_PAGEDOWN)
+					inputActions |= InputAction::DecreaseExposure;
+				//The benchmark moves the camera and renders frames a replay would not
+				if (e.key.keysym.scancode == SDL_SCANCODE_F6 && pInputRecorder)
+					std::cout << "Benchmarks are disabled while recording input" << std::endl;
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F6)
+					runBenchmark = true;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F1)
+				{
+					if (Profiler::IsCapturing())
+						Profiler::EndCapture(traceFilename);
+					else
+					{
+						std::cout << "Profiling, press F1 again to save " << traceFilename << std::endl;
+						Profiler::BeginCapture();
+						traceStartFrame = frameIndex;
+						traceFrameCount = UINT32_MAX;
+					}
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+					pRenderer->CycleImageFormat();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F12)
+					pRenderer->ToggleImageSequence();
 				break;
 			}
 		}
 
 		//--------- Update ---------
-		pScene->Update(pTimer);
+		ApplyInputActions(pRenderer, inputActions);
+		const CameraInput cameraInput{ ReadCameraInput() };
+		if (pInputRecorder)
+			pInputRecorder->Record(InputFrame{ pTimer->GetElapsed(), pTimer->GetTotal(), cameraInput, inputActions });
+		pScene->SetCameraInput(cameraInput);
+		{
+			PROFILE_SCOPE("Scene::Update");
+			pScene->Update(pTimer);
+		}
 
 		//--------- Render ---------
 		pRenderer->Render(pScene);
+		{
+			PROFILE_SCOPE("SDL_UpdateWindowSurface");
+			SDL_UpdateWindowSurface(pWindow);
+		}
 
 		//--------- Timer ---------
 		pTimer->Update();
+		printStats += pRenderer->GetFrameStats();
+		printHardwareStats += pRenderer->GetHardwareStats();
+		++printFrameCount;
+		if (statsFile.is_open())
+			RenderCounters::WriteCsvRow(statsFile, frameIndex, pTimer->GetElapsed() * 1000.0, pRenderer->GetFrameStats());
+		++frameIndex;
+
 		printTimer += pTimer->GetElapsed();
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			if (RenderCounters::IsEnabled())
+				RenderCounters::Print(std::cout, printStats, printFrameCount);
+			if (HardwareCounters::IsEnabled())
+				HardwareCounters::Print(std::cout, printHardwareStats, printFrameCount);
+			const std::string heatmapLegend{ pRenderer->GetHeatmapLegend() };
+			if (!heatmapLegend.empty())
+				std::cout << heatmapLegend << std::endl;
+			printStats = {};
+			printHardwareStats = {};
+			printFrameCount = 0;
 		}
 
 		//Save screenshot after full render
 		if (takeScreenshot)
 		{
-			if (!pRenderer->SaveBufferToImage())
-				std::cout << "Screenshot saved!" << std::endl;
-			else
-				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
+			std::cout << "Saving screenshot to " << pRenderer->SaveBufferToImage() << std::endl;
 			takeScreenshot = false;
 		}
+
+		if (Profiler::IsCapturing() && frameIndex - traceStartFrame >= traceFrameCount)
+			Profiler::EndCapture(traceFilename);
+
+		if (runBenchmark)
+		{
+			pTimer->Stop();
+			const Benchmark benchmark{ BenchmarkSettings{} };
+			const BenchmarkResult result{ benchmark.Run(sceneName, pScene, pRenderer, 0.0, [pWindow]() { SDL_UpdateWindowSurface(pWindow); }) };
+			Benchmark::PrintResult(result);
+			if (benchmark.WriteJson("benchmark.json", { result }))
+				std::cout << "Saved benchmark.json" << std::endl;
+			pTimer->Start();
+			runBenchmark = false;
+		}
 	}
 	pTimer->Stop();
 
+	if (pInputRecorder)
+	{
+		std::cout << "Recorded " << pInputRecorder->GetFrameCount() << " frames to " << recordFilename << std::endl;
+		delete pInputRecorder;
+	}
+
 	//Shutdown "framework"
 	delete pScene;
 	delete pRenderer;
+	delete pTarget;
 	delete pTimer;
 
 	ShutDown(pWindow);